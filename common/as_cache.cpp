@@ -0,0 +1,344 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#include "as_cache.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <fstream>
+
+#include <fmt/format.h>
+
+#include "nvutils/file_mapping.hpp"
+#include "nvutils/file_operations.hpp"
+#include "nvutils/logger.hpp"
+#include "nvvk/barriers.hpp"
+#include "nvvk/check_error.hpp"
+#include "nvvk/debug_util.hpp"
+
+#include "utils.hpp"
+
+namespace {
+
+// Layout of a cache file:
+// - AsCacheHeader
+// - uint64_t blasKeys[numBlas], uint64_t serializedSizes[numBlas]
+// - serialized BLAS, from blobOffset, each one aligned to kSerializedAlignment
+struct AsCacheHeader
+{
+  uint32_t magic         = 0;
+  uint32_t formatVersion = 0;
+  uint32_t numBlas       = 0;
+  uint32_t _pad          = 0;
+  uint64_t blobOffset    = 0;
+  uint64_t blobSize      = 0;
+  uint8_t  deviceUUID[VK_UUID_SIZE]{};
+  uint8_t  driverUUID[VK_UUID_SIZE]{};
+};
+
+constexpr uint32_t     kAsCacheMagic         = 0x48434152;  // "RACH"
+constexpr uint32_t     kAsCacheFormatVersion = 1;
+constexpr VkDeviceSize kSerializedAlignment  = 256;  // Required for the device addresses of the (de)serialization
+
+// Offsets of the serialized BLAS in the blob, returns the blob size
+VkDeviceSize computeSerializedOffsets(std::span<const VkDeviceSize> sizes, std::vector<VkDeviceSize>& offsets)
+{
+  offsets.resize(sizes.size());
+  VkDeviceSize offset = 0;
+  for(size_t i = 0; i < sizes.size(); i++)
+  {
+    offsets[i] = offset;
+    offset     = (offset + sizes[i] + kSerializedAlignment - 1) & ~(kSerializedAlignment - 1);
+  }
+  return offset;
+}
+
+}  // namespace
+
+void nvsamples::AccelerationStructureCache::init(nvvk::ResourceAllocator*     allocator,
+                                                 VkPhysicalDevice             physicalDevice,
+                                                 const std::filesystem::path& cacheDirectory)
+{
+  m_allocator      = allocator;
+  m_device         = allocator->getDevice();
+  m_cacheDirectory = cacheDirectory;
+
+  VkPhysicalDeviceIDProperties idProperties{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES};
+  VkPhysicalDeviceProperties2  properties{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, .pNext = &idProperties};
+  vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+  std::memcpy(m_deviceUUID, idProperties.deviceUUID, VK_UUID_SIZE);
+  std::memcpy(m_driverUUID, idProperties.driverUUID, VK_UUID_SIZE);
+}
+
+void nvsamples::AccelerationStructureCache::deinit()
+{
+  releaseBuffers();
+  if(m_queryPool)
+  {
+    vkDestroyQueryPool(m_device, m_queryPool, nullptr);
+  }
+  m_queryPool = VK_NULL_HANDLE;
+  m_allocator = nullptr;
+}
+
+void nvsamples::AccelerationStructureCache::releaseBuffers()
+{
+  if(m_allocator)
+  {
+    m_allocator->destroyBuffer(m_buffer);
+  }
+}
+
+uint64_t nvsamples::AccelerationStructureCache::makeBlasKey(uint64_t                                  geometryHash,
+                                                            VkBuildAccelerationStructureFlagsKHR      flags,
+                                                            const VkAccelerationStructureGeometryKHR& geometry,
+                                                            const VkAccelerationStructureBuildRangeInfoKHR& rangeInfo)
+{
+  // Only the layout of the geometry, the device addresses change from run to run
+  const VkAccelerationStructureGeometryTrianglesDataKHR& triangles = geometry.geometry.triangles;
+  const uint64_t                                         layout[]  = {
+      flags,
+      uint64_t(geometry.geometryType),
+      geometry.flags,
+      uint64_t(triangles.vertexFormat),
+      triangles.vertexStride,
+      triangles.maxVertex,
+      uint64_t(triangles.indexType),
+      triangles.transformData.deviceAddress != 0,
+      rangeInfo.primitiveCount,
+      rangeInfo.primitiveOffset,
+      rangeInfo.firstVertex,
+  };
+  return hashBytes({reinterpret_cast<const uint8_t*>(layout), sizeof(layout)}, geometryHash);
+}
+
+std::filesystem::path nvsamples::AccelerationStructureCache::getCacheFilename(std::span<const uint64_t> blasKeys) const
+{
+  uint64_t key = hashBytes({reinterpret_cast<const uint8_t*>(blasKeys.data()), blasKeys.size_bytes()});
+  key          = hashBytes({m_deviceUUID, VK_UUID_SIZE}, key);
+  key          = hashBytes({m_driverUUID, VK_UUID_SIZE}, key);
+  return m_cacheDirectory / fmt::format("blas_{:016x}.ascache", key);
+}
+
+bool nvsamples::AccelerationStructureCache::cmdLoad(VkCommandBuffer                        cmd,
+                                                    std::span<const uint64_t>              blasKeys,
+                                                    std::span<nvvk::AccelerationStructure> blasSet)
+{
+  assert(blasKeys.size() == blasSet.size());
+  const std::filesystem::path cacheFilename = getCacheFilename(blasKeys);
+  nvutils::FileReadMapping    mapping;
+  if(blasKeys.empty() || !mapping.open(cacheFilename) || mapping.size() < sizeof(AsCacheHeader))
+  {
+    return false;
+  }
+
+  const uint8_t* data = static_cast<const uint8_t*>(mapping.data());
+  AsCacheHeader  header;
+  std::memcpy(&header, data, sizeof(header));
+  const size_t tableSize = sizeof(AsCacheHeader) + 2 * blasKeys.size_bytes();
+  if(header.magic != kAsCacheMagic || header.formatVersion != kAsCacheFormatVersion || header.numBlas != blasKeys.size()
+     || std::memcmp(header.deviceUUID, m_deviceUUID, VK_UUID_SIZE) != 0
+     || std::memcmp(header.driverUUID, m_driverUUID, VK_UUID_SIZE) != 0 || mapping.size() < tableSize
+     || std::memcmp(data + sizeof(AsCacheHeader), blasKeys.data(), blasKeys.size_bytes()) != 0
+     || header.blobOffset + header.blobSize > mapping.size())
+  {
+    return false;
+  }
+
+  m_serializedSizes.resize(blasKeys.size());
+  std::memcpy(m_serializedSizes.data(), data + sizeof(AsCacheHeader) + blasKeys.size_bytes(), blasKeys.size_bytes());
+  if(computeSerializedOffsets(m_serializedSizes, m_serializedOffsets) != header.blobSize)
+  {
+    return false;
+  }
+
+  // Each serialized BLAS holds at least its header: driver UUID, compatibility, serialized and deserialized sizes
+  constexpr VkDeviceSize kSerializedHeaderSize = 2 * VK_UUID_SIZE + 2 * sizeof(uint64_t);
+  for(VkDeviceSize offset : m_serializedOffsets)
+  {
+    if(offset + kSerializedHeaderSize > header.blobSize)
+    {
+      return false;
+    }
+  }
+
+  // The serialized data starts with the driver UUID and the compatibility identifier of the driver which wrote it
+  const uint8_t*                          blob = data + header.blobOffset;
+  const VkAccelerationStructureVersionInfoKHR versionInfo{.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_VERSION_INFO_KHR,
+                                                          .pVersionData = blob};
+  VkAccelerationStructureCompatibilityKHR compatibility = VK_ACCELERATION_STRUCTURE_COMPATIBILITY_INCOMPATIBLE_KHR;
+  vkGetDeviceAccelerationStructureCompatibilityKHR(m_device, &versionInfo, &compatibility);
+  if(compatibility != VK_ACCELERATION_STRUCTURE_COMPATIBILITY_COMPATIBLE_KHR)
+  {
+    LOGI("Acceleration structure cache not compatible with the driver: %s\n", nvutils::utf8FromPath(cacheFilename).c_str());
+    return false;
+  }
+
+  // The whole blob is copied in one go to memory the device reads directly
+  releaseBuffers();
+  NVVK_CHECK(m_allocator->createBuffer(m_buffer, header.blobSize,
+                                       VK_BUFFER_USAGE_2_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_2_SHADER_DEVICE_ADDRESS_BIT,
+                                       VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+                                       VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+                                       kSerializedAlignment));
+  NVVK_DBG_NAME(m_buffer.buffer);
+  std::memcpy(m_buffer.mapping, blob, header.blobSize);
+  NVVK_CHECK(vmaFlushAllocation(*m_allocator, m_buffer.allocation, 0, VK_WHOLE_SIZE));
+
+  for(size_t i = 0; i < blasSet.size(); i++)
+  {
+    // Serialized header: driver UUID, compatibility, serialized size, deserialized size, ...
+    uint64_t deserializedSize = 0;
+    std::memcpy(&deserializedSize, blob + m_serializedOffsets[i] + 2 * VK_UUID_SIZE + sizeof(uint64_t), sizeof(uint64_t));
+
+    const VkAccelerationStructureCreateInfoKHR createInfo{
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR,
+        .size  = deserializedSize,
+        .type  = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+    };
+    NVVK_CHECK(m_allocator->createAcceleration(blasSet[i], createInfo));
+    NVVK_DBG_NAME(blasSet[i].accel);
+
+    const VkCopyMemoryToAccelerationStructureInfoKHR copyInfo{
+        .sType = VK_STRUCTURE_TYPE_COPY_MEMORY_TO_ACCELERATION_STRUCTURE_INFO_KHR,
+        .src   = {.deviceAddress = m_buffer.address + m_serializedOffsets[i]},
+        .dst   = blasSet[i].accel,
+        .mode  = VK_COPY_ACCELERATION_STRUCTURE_MODE_DESERIALIZE_KHR,
+    };
+    vkCmdCopyMemoryToAccelerationStructureKHR(cmd, &copyInfo);
+  }
+
+  nvvk::accelerationStructureBarrier(cmd, VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR);
+  LOGI("Loaded %zu BLAS from the cache: %s\n", blasSet.size(), nvutils::utf8FromPath(cacheFilename).c_str());
+  return true;
+}
+
+void nvsamples::AccelerationStructureCache::cmdQuerySizes(VkCommandBuffer cmd, std::span<const nvvk::AccelerationStructure> blasSet)
+{
+  if(m_queryPool)
+  {
+    vkDestroyQueryPool(m_device, m_queryPool, nullptr);
+    m_queryPool = VK_NULL_HANDLE;
+  }
+  m_queryCount = uint32_t(blasSet.size());
+  if(m_queryCount == 0)
+    return;
+
+  const VkQueryPoolCreateInfo queryPoolInfo{
+      .sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+      .queryType  = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_SERIALIZATION_SIZE_KHR,
+      .queryCount = m_queryCount,
+  };
+  NVVK_CHECK(vkCreateQueryPool(m_device, &queryPoolInfo, nullptr, &m_queryPool));
+  NVVK_DBG_NAME(m_queryPool);
+
+  std::vector<VkAccelerationStructureKHR> accels(blasSet.size());
+  for(size_t i = 0; i < blasSet.size(); i++)
+  {
+    accels[i] = blasSet[i].accel;
+  }
+
+  nvvk::accelerationStructureBarrier(cmd, VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR);
+  vkCmdResetQueryPool(cmd, m_queryPool, 0, m_queryCount);
+  vkCmdWriteAccelerationStructuresPropertiesKHR(cmd, m_queryCount, accels.data(),
+                                                VK_QUERY_TYPE_ACCELERATION_STRUCTURE_SERIALIZATION_SIZE_KHR, m_queryPool, 0);
+}
+
+void nvsamples::AccelerationStructureCache::cmdSerialize(VkCommandBuffer cmd, std::span<const nvvk::AccelerationStructure> blasSet)
+{
+  assert(blasSet.size() == m_queryCount);
+  if(m_queryCount == 0)
+    return;
+
+  m_serializedSizes.resize(m_queryCount);
+  NVVK_CHECK(vkGetQueryPoolResults(m_device, m_queryPool, 0, m_queryCount, m_queryCount * sizeof(VkDeviceSize),
+                                   m_serializedSizes.data(), sizeof(VkDeviceSize), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+  const VkDeviceSize blobSize = computeSerializedOffsets(m_serializedSizes, m_serializedOffsets);
+
+  // Read back by the host
+  releaseBuffers();
+  NVVK_CHECK(m_allocator->createBuffer(m_buffer, blobSize,
+                                       VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_SHADER_DEVICE_ADDRESS_BIT,
+                                       VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+                                       VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT, kSerializedAlignment));
+  NVVK_DBG_NAME(m_buffer.buffer);
+
+  for(size_t i = 0; i < blasSet.size(); i++)
+  {
+    const VkCopyAccelerationStructureToMemoryInfoKHR copyInfo{
+        .sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_TO_MEMORY_INFO_KHR,
+        .src   = blasSet[i].accel,
+        .dst   = {.deviceAddress = m_buffer.address + m_serializedOffsets[i]},
+        .mode  = VK_COPY_ACCELERATION_STRUCTURE_MODE_SERIALIZE_KHR,
+    };
+    vkCmdCopyAccelerationStructureToMemoryKHR(cmd, &copyInfo);
+  }
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_PIPELINE_STAGE_2_HOST_BIT);
+}
+
+bool nvsamples::AccelerationStructureCache::save(std::span<const uint64_t> blasKeys)
+{
+  assert(blasKeys.size() == m_serializedSizes.size());
+  if(blasKeys.empty() || m_buffer.mapping == nullptr)
+  {
+    return false;
+  }
+  vmaInvalidateAllocation(*m_allocator, m_buffer.allocation, 0, VK_WHOLE_SIZE);
+
+  AsCacheHeader header{
+      .magic         = kAsCacheMagic,
+      .formatVersion = kAsCacheFormatVersion,
+      .numBlas       = uint32_t(blasKeys.size()),
+  };
+  std::memcpy(header.deviceUUID, m_deviceUUID, VK_UUID_SIZE);
+  std::memcpy(header.driverUUID, m_driverUUID, VK_UUID_SIZE);
+  const size_t tableSize = sizeof(AsCacheHeader) + 2 * blasKeys.size_bytes();
+  header.blobOffset      = (tableSize + kSerializedAlignment - 1) & ~(kSerializedAlignment - 1);
+  header.blobSize        = computeSerializedOffsets(m_serializedSizes, m_serializedOffsets);
+
+  // Write to a temporary file first, so that concurrent processes never see a partial cache
+  const std::filesystem::path cacheFilename = getCacheFilename(blasKeys);
+  std::error_code             ec;
+  const std::filesystem::path tempFilename = getTempFilename(cacheFilename);
+  std::filesystem::create_directories(cacheFilename.parent_path(), ec);
+  {
+    std::ofstream file(tempFilename, std::ios::binary | std::ios::trunc);
+    auto write = [&](const void* data, size_t size) { file.write(static_cast<const char*>(data), std::streamsize(size)); };
+    write(&header, sizeof(header));
+    write(blasKeys.data(), blasKeys.size_bytes());
+    write(m_serializedSizes.data(), std::span(m_serializedSizes).size_bytes());
+    const uint8_t padding[kSerializedAlignment]{};
+    write(padding, header.blobOffset - tableSize);
+    write(m_buffer.mapping, header.blobSize);
+    if(!file)
+    {
+      LOGW("Could not write the acceleration structure cache: %s\n", nvutils::utf8FromPath(tempFilename).c_str());
+      return false;
+    }
+  }
+  std::filesystem::rename(tempFilename, cacheFilename, ec);
+  if(ec)
+  {
+    std::filesystem::remove(tempFilename, ec);
+    return false;
+  }
+  LOGI("Saved %zu BLAS to the cache: %s\n", blasKeys.size(), nvutils::utf8FromPath(cacheFilename).c_str());
+  return true;
+}
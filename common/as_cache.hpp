@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include <nvvk/acceleration_structures.hpp>
+#include <nvvk/resource_allocator.hpp>
+
+namespace nvsamples {
+
+//--------------------------------------------------------------------------------------------------
+// On-disk cache of bottom-level acceleration structures, stored in their serialized form.
+//
+// A cache file holds all the BLAS of a scene and is named after the hash of their keys (see makeBlasKey) and of the
+// device and driver UUIDs. It is only used if the driver reports the serialized data as compatible, the BLAS are then
+// deserialized from a host-visible copy of the file instead of being built.
+//
+// Loading:  cmdLoad() creates the BLAS and records their deserialization, or returns false on a cache miss.
+// Saving:   once the BLAS are built (and compacted), cmdQuerySizes() then cmdSerialize() then save(), each step after the
+//           GPU has executed the previous one.
+//
+class AccelerationStructureCache
+{
+public:
+  void init(nvvk::ResourceAllocator* allocator, VkPhysicalDevice physicalDevice, const std::filesystem::path& cacheDirectory);
+  void deinit();
+
+  // Key of a BLAS built from the geometry of hash `geometryHash` (see GltfSceneResource::meshHashes) with `flags`
+  static uint64_t makeBlasKey(uint64_t                                        geometryHash,
+                              VkBuildAccelerationStructureFlagsKHR            flags,
+                              const VkAccelerationStructureGeometryKHR&       geometry,
+                              const VkAccelerationStructureBuildRangeInfoKHR& rangeInfo);
+
+  bool cmdLoad(VkCommandBuffer cmd, std::span<const uint64_t> blasKeys, std::span<nvvk::AccelerationStructure> blasSet);
+
+  void cmdQuerySizes(VkCommandBuffer cmd, std::span<const nvvk::AccelerationStructure> blasSet);
+  void cmdSerialize(VkCommandBuffer cmd, std::span<const nvvk::AccelerationStructure> blasSet);
+  bool save(std::span<const uint64_t> blasKeys);
+
+  // Host-visible buffers used by the last load or save, to release once the GPU is done with them
+  void releaseBuffers();
+
+private:
+  std::filesystem::path getCacheFilename(std::span<const uint64_t> blasKeys) const;
+
+  nvvk::ResourceAllocator*  m_allocator{};
+  VkDevice                  m_device{};
+  std::filesystem::path     m_cacheDirectory;
+  uint8_t                   m_deviceUUID[VK_UUID_SIZE]{};
+  uint8_t                   m_driverUUID[VK_UUID_SIZE]{};
+  VkQueryPool               m_queryPool{};
+  uint32_t                  m_queryCount = 0;
+  std::vector<VkDeviceSize> m_serializedSizes;
+  std::vector<VkDeviceSize> m_serializedOffsets;
+  nvvk::Buffer              m_buffer{};  // Serialized BLAS, read back when saving or deserialized when loading
+};
+
+}  // namespace nvsamples
@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "async_uploader.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "nvvk/check_error.hpp"
+#include "nvvk/debug_util.hpp"
+
+namespace {
+constexpr VkDeviceSize kChunkAlignment = 16;
+}
+
+void nvsamples::AsyncUploader::init(nvvk::ResourceAllocator* allocator,
+                                    const nvvk::QueueInfo&   transferQueue,
+                                    uint32_t                 consumerQueueFamily,
+                                    VkDeviceSize             ringSize /*= 64 MB*/,
+                                    uint32_t                 numSegments /*= 4*/)
+{
+  assert(numSegments > 0 && ringSize >= numSegments * kChunkAlignment);
+  m_allocator      = allocator;
+  m_device         = allocator->getDevice();
+  m_queue          = transferQueue;
+  m_consumerFamily = consumerQueueFamily;
+  m_segmentSize    = (ringSize / numSegments) & ~(kChunkAlignment - 1);
+
+  NVVK_CHECK(m_allocator->createBuffer(m_ring, m_segmentSize * numSegments, VK_BUFFER_USAGE_2_TRANSFER_SRC_BIT,
+                                       VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+                                       VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT));
+  NVVK_DBG_NAME(m_ring.buffer);
+
+  VkSemaphoreTypeCreateInfo semaphoreType{
+      .sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+      .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+      .initialValue  = 0,
+  };
+  const VkSemaphoreCreateInfo semaphoreInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO, .pNext = &semaphoreType};
+  NVVK_CHECK(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_semaphore));
+  NVVK_DBG_NAME(m_semaphore);
+
+  m_segments.resize(numSegments);
+  for(uint32_t i = 0; i < numSegments; i++)
+  {
+    Segment&                      segment = m_segments[i];
+    const VkCommandPoolCreateInfo poolInfo{
+        .sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = m_queue.familyIndex,
+    };
+    NVVK_CHECK(vkCreateCommandPool(m_device, &poolInfo, nullptr, &segment.cmdPool));
+    const VkCommandBufferAllocateInfo allocInfo{
+        .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool        = segment.cmdPool,
+        .level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+    NVVK_CHECK(vkAllocateCommandBuffers(m_device, &allocInfo, &segment.cmd));
+    segment.ringOffset = i * m_segmentSize;
+  }
+
+  // The first segment is open, its copies will signal 1
+  m_current           = 0;
+  m_nextSubmit        = 0;
+  m_lastValue         = 1;
+  m_segments[0].state = SegmentState::eOpen;
+  m_segments[0].value = m_lastValue;
+}
+
+void nvsamples::AsyncUploader::deinit()
+{
+  if(!isInitialized())
+    return;
+
+  wait(flush());
+  for(Segment& segment : m_segments)
+  {
+    vkDestroyCommandPool(m_device, segment.cmdPool, nullptr);
+  }
+  vkDestroySemaphore(m_device, m_semaphore, nullptr);
+  m_allocator->destroyBuffer(m_ring);
+  m_segments.clear();
+  m_releases.clear();
+  m_semaphore = VK_NULL_HANDLE;
+}
+
+uint64_t nvsamples::AsyncUploader::appendBuffer(const nvvk::Buffer& buffer, VkDeviceSize bufferOffset, VkDeviceSize size, const FillCallback& fill)
+{
+  uint64_t     value      = 0;
+  VkDeviceSize dataOffset = 0;
+  while(dataOffset < size)
+  {
+    // The chunks are filled without holding the lock, other threads keep appending meanwhile
+    const Chunk chunk = allocateChunk(buffer.buffer, bufferOffset + dataOffset, size - dataOffset);
+    fill(std::span<uint8_t>(chunk.data, size_t(chunk.size)), dataOffset);
+    finishChunk(chunk);
+    dataOffset += chunk.size;
+    value = chunk.value;
+  }
+  return value;
+}
+
+uint64_t nvsamples::AsyncUploader::appendBuffer(const nvvk::Buffer& buffer, VkDeviceSize bufferOffset, std::span<const uint8_t> data)
+{
+  return appendBuffer(buffer, bufferOffset, data.size(), [&](std::span<uint8_t> chunk, VkDeviceSize dataOffset) {
+    std::memcpy(chunk.data(), data.data() + dataOffset, chunk.size());
+  });
+}
+
+uint64_t nvsamples::AsyncUploader::flush()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Segment&                    segment = m_segments[m_current];
+  if(segment.state != SegmentState::eOpen)
+  {
+    return segment.value;  // Already closed, submitted when its last chunk is filled
+  }
+  if(segment.used == 0)
+  {
+    return segment.value - 1;  // Nothing appended since the previous segment
+  }
+  segment.state = SegmentState::eClosed;
+  submitReadySegments();
+  return segment.value;
+}
+
+bool nvsamples::AsyncUploader::isComplete(uint64_t value) const
+{
+  uint64_t completed = 0;
+  NVVK_CHECK(vkGetSemaphoreCounterValue(m_device, m_semaphore, &completed));
+  return completed >= value;
+}
+
+void nvsamples::AsyncUploader::wait(uint64_t value) const
+{
+  const VkSemaphoreWaitInfo waitInfo{
+      .sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+      .semaphoreCount = 1,
+      .pSemaphores    = &m_semaphore,
+      .pValues        = &value,
+  };
+  NVVK_CHECK(vkWaitSemaphores(m_device, &waitInfo, UINT64_MAX));
+}
+
+void nvsamples::AsyncUploader::cmdAcquire(VkCommandBuffer cmd, uint64_t value)
+{
+  std::vector<VkBufferMemoryBarrier2> barriers;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto                        acquired = std::stable_partition(m_releases.begin(), m_releases.end(),
+                                                                 [&](const auto& release) { return release.first <= value; });
+    for(auto it = m_releases.begin(); it != acquired; ++it)
+    {
+      VkBufferMemoryBarrier2 barrier = it->second;
+      barrier.srcStageMask           = VK_PIPELINE_STAGE_2_NONE;
+      barrier.srcAccessMask          = VK_ACCESS_2_NONE;
+      barrier.dstStageMask           = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+      barrier.dstAccessMask          = VK_ACCESS_2_MEMORY_READ_BIT;
+      barriers.push_back(barrier);
+    }
+    m_releases.erase(m_releases.begin(), acquired);
+  }
+
+  if(!barriers.empty())
+  {
+    const VkDependencyInfo depInfo{
+        .sType                    = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .bufferMemoryBarrierCount = uint32_t(barriers.size()),
+        .pBufferMemoryBarriers    = barriers.data(),
+    };
+    vkCmdPipelineBarrier2(cmd, &depInfo);
+  }
+}
+
+nvsamples::AsyncUploader::Chunk nvsamples::AsyncUploader::allocateChunk(VkBuffer buffer, VkDeviceSize bufferOffset, VkDeviceSize size)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for(;;)
+  {
+    Segment& segment = m_segments[m_current];
+    if(segment.state == SegmentState::eOpen && segment.used < m_segmentSize)
+    {
+      const VkDeviceSize chunkSize = std::min(size, m_segmentSize - segment.used);
+      const VkDeviceSize srcOffset = segment.ringOffset + segment.used;
+      segment.copies.push_back({buffer, VkBufferCopy{.srcOffset = srcOffset, .dstOffset = bufferOffset, .size = chunkSize}});
+      segment.used = std::min(m_segmentSize, (segment.used + chunkSize + kChunkAlignment - 1) & ~(kChunkAlignment - 1));
+      segment.pendingFills++;
+      return {m_current, chunkSize, static_cast<uint8_t*>(m_ring.mapping) + srcOffset, segment.value};
+    }
+
+    // The segment is full: close it and move to the next one, once the GPU is done with it
+    if(segment.state == SegmentState::eOpen)
+    {
+      segment.state = SegmentState::eClosed;
+      submitReadySegments();
+    }
+    const uint32_t nextIndex = (m_current + 1) % uint32_t(m_segments.size());
+    Segment&       next      = m_segments[nextIndex];
+    if(next.state == SegmentState::eFree)
+    {
+      next.state = SegmentState::eOpen;
+      next.used  = 0;
+      next.value = ++m_lastValue;
+      m_current  = nextIndex;
+    }
+    else if(next.state == SegmentState::eSubmitted)
+    {
+      const uint64_t value = next.value;
+      lock.unlock();
+      wait(value);
+      lock.lock();
+      if(next.state == SegmentState::eSubmitted && next.value == value)
+      {
+        next.state = SegmentState::eFree;
+      }
+    }
+    else
+    {
+      // The oldest segment is still being filled by another thread
+      m_segmentSubmitted.wait(lock);
+    }
+  }
+}
+
+void nvsamples::AsyncUploader::finishChunk(const Chunk& chunk)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Segment&                    segment = m_segments[chunk.segment];
+  assert(segment.pendingFills > 0);
+  segment.pendingFills--;
+  if(segment.state == SegmentState::eClosed && segment.pendingFills == 0)
+  {
+    submitReadySegments();
+  }
+}
+
+void nvsamples::AsyncUploader::submitReadySegments()
+{
+  bool submitted = false;
+  for(;;)
+  {
+    Segment& segment = m_segments[m_nextSubmit];
+    if(segment.state != SegmentState::eClosed || segment.pendingFills > 0)
+      break;
+    submitSegment(segment);
+    m_nextSubmit = (m_nextSubmit + 1) % uint32_t(m_segments.size());
+    submitted    = true;
+  }
+  if(submitted)
+  {
+    m_segmentSubmitted.notify_all();
+  }
+}
+
+void nvsamples::AsyncUploader::submitSegment(Segment& segment)
+{
+  // The ring is not necessarily in coherent memory: the chunks written on the host are flushed before the copies
+  NVVK_CHECK(vmaFlushAllocation(*m_allocator, m_ring.allocation, segment.ringOffset, segment.used));
+
+  NVVK_CHECK(vkResetCommandPool(m_device, segment.cmdPool, 0));
+  const VkCommandBufferBeginInfo beginInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                           .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+  NVVK_CHECK(vkBeginCommandBuffer(segment.cmd, &beginInfo));
+
+  std::vector<VkBufferMemoryBarrier2> releases;
+  for(const auto& [buffer, region] : segment.copies)
+  {
+    vkCmdCopyBuffer(segment.cmd, m_ring.buffer, buffer, 1, &region);
+
+    // Ownership of the written range goes to the consumer family, see cmdAcquire()
+    if(m_queue.familyIndex != m_consumerFamily)
+    {
+      const VkBufferMemoryBarrier2 release{
+          .sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+          .srcStageMask        = VK_PIPELINE_STAGE_2_COPY_BIT,
+          .srcAccessMask       = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+          .srcQueueFamilyIndex = m_queue.familyIndex,
+          .dstQueueFamilyIndex = m_consumerFamily,
+          .buffer              = buffer,
+          .offset              = region.dstOffset,
+          .size                = region.size,
+      };
+      releases.push_back(release);
+      m_releases.push_back({segment.value, release});
+    }
+  }
+  if(!releases.empty())
+  {
+    const VkDependencyInfo depInfo{
+        .sType                    = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .bufferMemoryBarrierCount = uint32_t(releases.size()),
+        .pBufferMemoryBarriers    = releases.data(),
+    };
+    vkCmdPipelineBarrier2(segment.cmd, &depInfo);
+  }
+  NVVK_CHECK(vkEndCommandBuffer(segment.cmd));
+
+  const VkCommandBufferSubmitInfo cmdInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO, .commandBuffer = segment.cmd};
+  const VkSemaphoreSubmitInfo     signalInfo{
+      .sType     = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+      .semaphore = m_semaphore,
+      .value     = segment.value,
+      .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+  };
+  const VkSubmitInfo2 submitInfo{
+      .sType                    = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+      .commandBufferInfoCount   = 1,
+      .pCommandBufferInfos      = &cmdInfo,
+      .signalSemaphoreInfoCount = 1,
+      .pSignalSemaphoreInfos    = &signalInfo,
+  };
+  NVVK_CHECK(vkQueueSubmit2(m_queue.queue, 1, &submitInfo, VK_NULL_HANDLE));
+
+  segment.copies.clear();
+  segment.state = SegmentState::eSubmitted;
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#include <nvvk/context.hpp>
+#include <nvvk/resource_allocator.hpp>
+#include <nvvk/resources.hpp>
+
+namespace nvsamples {
+
+//--------------------------------------------------------------------------------------------------
+// Uploads buffer data on a dedicated transfer queue, through a fixed-size staging ring.
+//
+// The ring is split in segments, recorded and submitted one after the other; a timeline semaphore is signaled with
+// the value of each segment when its copies are done. Producers (worker threads reading or decoding files) write
+// into the ring while the transfer queue copies the previous segments, and wait for the oldest segment when the ring
+// is full: the upload takes max(I/O, transfer) instead of their sum.
+//
+// Each append returns the timeline value at which its data is on the device. When the transfer queue is not in the
+// family of the queue using the buffers, the copied ranges are released by the transfer queue and must be acquired
+// with cmdAcquire(), in a submission waiting for that value on getSemaphore(). As the ownership applies to the whole
+// buffer, the destination buffers must not be used by other queues before the acquisition (e.g. no other data in them).
+//
+// All the append functions are thread safe.
+//
+class AsyncUploader
+{
+public:
+  // Writes `chunk.size()` bytes of the data, starting at `dataOffset`, into the staging memory
+  using FillCallback = std::function<void(std::span<uint8_t> chunk, VkDeviceSize dataOffset)>;
+
+  void init(nvvk::ResourceAllocator* allocator,
+            const nvvk::QueueInfo&   transferQueue,
+            uint32_t                 consumerQueueFamily,
+            VkDeviceSize             ringSize    = VkDeviceSize(64) << 20,
+            uint32_t                 numSegments = 4);
+  void deinit();
+
+  // Copies `size` bytes to the buffer, the data is written by `fill`, called on the calling thread for each chunk of
+  // the ring it spans. Waits for the GPU when the ring is full.
+  uint64_t appendBuffer(const nvvk::Buffer& buffer, VkDeviceSize bufferOffset, VkDeviceSize size, const FillCallback& fill);
+  uint64_t appendBuffer(const nvvk::Buffer& buffer, VkDeviceSize bufferOffset, std::span<const uint8_t> data);
+
+  // Submits the segment being filled, returns the value signaled once everything appended so far is uploaded
+  uint64_t flush();
+
+  bool isComplete(uint64_t value) const;
+  void wait(uint64_t value) const;
+
+  // Records the acquisition of the buffer ranges uploaded up to `value`, on the consumer queue family.
+  // Does nothing when the transfer queue is in the consumer family.
+  void cmdAcquire(VkCommandBuffer cmd, uint64_t value);
+
+  VkSemaphore getSemaphore() const { return m_semaphore; }
+  bool        isInitialized() const { return m_semaphore != VK_NULL_HANDLE; }
+
+private:
+  enum class SegmentState
+  {
+    eFree,       // Not used by the GPU, can be opened
+    eOpen,       // Receiving new chunks
+    eClosed,     // Full, waiting for the chunks being filled
+    eSubmitted,  // Copies in flight until `value` is signaled
+  };
+
+  struct Segment
+  {
+    VkCommandPool   cmdPool{};
+    VkCommandBuffer cmd{};
+    VkDeviceSize    ringOffset   = 0;
+    VkDeviceSize    used         = 0;
+    uint32_t        pendingFills = 0;
+    uint64_t        value        = 0;
+    SegmentState    state        = SegmentState::eFree;
+    std::vector<std::pair<VkBuffer, VkBufferCopy>> copies;
+  };
+
+  struct Chunk
+  {
+    uint32_t     segment = 0;
+    VkDeviceSize size    = 0;
+    uint8_t*     data    = nullptr;
+    uint64_t     value   = 0;
+  };
+
+  Chunk allocateChunk(VkBuffer buffer, VkDeviceSize bufferOffset, VkDeviceSize size);
+  void  finishChunk(const Chunk& chunk);
+  void  submitReadySegments();  // Under m_mutex
+  void  submitSegment(Segment& segment);
+
+  nvvk::ResourceAllocator* m_allocator{};
+  VkDevice                 m_device{};
+  nvvk::QueueInfo          m_queue{};
+  uint32_t                 m_consumerFamily = 0;
+  nvvk::Buffer             m_ring{};
+  VkDeviceSize             m_segmentSize = 0;
+  VkSemaphore              m_semaphore{};
+
+  std::mutex               m_mutex;
+  std::condition_variable  m_segmentSubmitted;
+  std::vector<Segment>     m_segments;
+  uint32_t                 m_current     = 0;  // Segment receiving the chunks
+  uint32_t                 m_nextSubmit  = 0;  // Segments are submitted in ring order, keeping the values increasing
+  uint64_t                 m_lastValue   = 0;  // Value of the last opened segment
+  std::vector<std::pair<uint64_t, VkBufferMemoryBarrier2>> m_releases;  // Ranges to acquire, with their value
+};
+
+}  // namespace nvsamples
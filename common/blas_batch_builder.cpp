@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#include "blas_batch_builder.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include "nvvk/check_error.hpp"
+#include "nvvk/debug_util.hpp"
+
+void nvsamples::BlasBatchBuilder::init(nvvk::ResourceAllocator* allocator, VkDeviceSize scratchAlignment, VkDeviceSize scratchBudget /*= 128 MB*/)
+{
+  m_allocator        = allocator;
+  m_device           = allocator->getDevice();
+  m_scratchAlignment = std::max(scratchAlignment, VkDeviceSize(1));
+  m_scratchBudget    = scratchBudget;
+}
+
+void nvsamples::BlasBatchBuilder::deinit()
+{
+  if(m_allocator)
+  {
+    m_allocator->destroyBuffer(m_scratchBuffer);
+    for(nvvk::Buffer& buffer : m_retiredScratch)
+    {
+      m_allocator->destroyBuffer(buffer);
+    }
+  }
+  m_retiredScratch.clear();
+  m_scratchUsed = false;
+  m_allocator   = nullptr;
+}
+
+void nvsamples::BlasBatchBuilder::cmdCreateAndBuild(VkCommandBuffer                         cmd,
+                                                    std::span<const Input>                  inputs,
+                                                    std::span<nvvk::AccelerationStructure> blasSet)
+{
+  assert(inputs.size() == blasSet.size());
+  auto alignUp = [this](VkDeviceSize value) { return (value + m_scratchAlignment - 1) & ~(m_scratchAlignment - 1); };
+
+  // Sizes of all the acceleration structures, and of the scratch memory they need
+  std::vector<VkAccelerationStructureBuildGeometryInfoKHR> buildInfos(inputs.size());
+  std::vector<VkDeviceSize>                                scratchSizes(inputs.size());
+  VkDeviceSize                                             maxScratch = 0, totalScratch = 0;
+  for(size_t i = 0; i < inputs.size(); i++)
+  {
+    buildInfos[i] = VkAccelerationStructureBuildGeometryInfoKHR{
+        .sType         = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
+        .type          = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+        .flags         = inputs[i].flags,
+        .mode          = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
+        .geometryCount = 1,
+        .pGeometries   = &inputs[i].geometry,
+    };
+
+    VkAccelerationStructureBuildSizesInfoKHR sizeInfo{.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR};
+    vkGetAccelerationStructureBuildSizesKHR(m_device, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &buildInfos[i],
+                                            &inputs[i].rangeInfo.primitiveCount, &sizeInfo);
+
+    VkAccelerationStructureCreateInfoKHR createInfo{
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR,
+        .size  = sizeInfo.accelerationStructureSize,
+        .type  = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+    };
+#ifdef VK_NV_ray_tracing_motion_blur
+    if(inputs[i].flags & VK_BUILD_ACCELERATION_STRUCTURE_MOTION_BIT_NV)
+    {
+      createInfo.createFlags = VK_ACCELERATION_STRUCTURE_CREATE_MOTION_BIT_NV;
+    }
+#endif
+    NVVK_CHECK(m_allocator->createAcceleration(blasSet[i], createInfo));
+    NVVK_DBG_NAME(blasSet[i].accel);
+    buildInfos[i].dstAccelerationStructure = blasSet[i].accel;
+
+    scratchSizes[i] = alignUp(sizeInfo.buildScratchSize);
+    maxScratch      = std::max(maxScratch, scratchSizes[i]);
+    totalScratch += scratchSizes[i];
+  }
+
+  // The scratch buffer holds the whole scene when it fits the budget, and at least the largest build
+  const VkDeviceSize scratchSize = std::max(std::min(totalScratch, m_scratchBudget), maxScratch);
+  if(m_scratchBuffer.bufferSize < scratchSize)
+  {
+    if(m_scratchBuffer.buffer != VK_NULL_HANDLE)
+    {
+      m_retiredScratch.push_back(m_scratchBuffer);
+    }
+    NVVK_CHECK(m_allocator->createBuffer(m_scratchBuffer, scratchSize,
+                                         VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_SHADER_DEVICE_ADDRESS_BIT,
+                                         VMA_MEMORY_USAGE_AUTO, {}, m_scratchAlignment));
+    NVVK_DBG_NAME(m_scratchBuffer.buffer);
+  }
+
+  // Packing the builds in batches, each one using its own scratch region
+  std::vector<VkAccelerationStructureBuildGeometryInfoKHR>     batchInfos;
+  std::vector<const VkAccelerationStructureBuildRangeInfoKHR*> batchRanges;
+  VkDeviceSize                                                 scratchOffset = 0;
+  m_batchCount                                                 = 0;
+
+  auto flushBatch = [&]() {
+    if(batchInfos.empty())
+      return;
+    // The previous batch must be done with the scratch buffer before it is reused
+    if(m_scratchUsed)
+    {
+      nvvk::accelerationStructureBarrier(cmd, VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+                                         VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR);
+    }
+    vkCmdBuildAccelerationStructuresKHR(cmd, uint32_t(batchInfos.size()), batchInfos.data(), batchRanges.data());
+    batchInfos.clear();
+    batchRanges.clear();
+    scratchOffset = 0;
+    m_scratchUsed = true;
+    m_batchCount++;
+  };
+
+  for(size_t i = 0; i < inputs.size(); i++)
+  {
+    if(scratchOffset + scratchSizes[i] > m_scratchBuffer.bufferSize)
+    {
+      flushBatch();
+    }
+    buildInfos[i].scratchData.deviceAddress = m_scratchBuffer.address + scratchOffset;
+    scratchOffset += scratchSizes[i];
+    batchInfos.push_back(buildInfos[i]);
+    batchRanges.push_back(&inputs[i].rangeInfo);
+  }
+  flushBatch();
+
+  // The BLAS are ready to be referenced by the TLAS build, or queried for compaction
+  nvvk::accelerationStructureBarrier(cmd, VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR);
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include <nvvk/acceleration_structures.hpp>
+#include <nvvk/resource_allocator.hpp>
+
+namespace nvsamples {
+
+//--------------------------------------------------------------------------------------------------
+// Builds many bottom-level acceleration structures with a bounded scratch memory.
+//
+// The builds are packed in batches: each BLAS of a batch gets its own region of the scratch buffer, and the whole
+// batch is a single vkCmdBuildAccelerationStructuresKHR call. The batches follow each other in the same command
+// buffer, separated by a barrier since they reuse the scratch buffer: there is a single submit and wait for the
+// whole scene instead of one per BLAS.
+//
+// The scratch buffer is kept for the next call, which can be recorded while the previous one is still executing on the
+// same queue (e.g. a few builds per frame): its builds wait for the previous ones, and a scratch buffer outgrown by a
+// larger build is only released by deinit().
+//
+class BlasBatchBuilder
+{
+public:
+  struct Input
+  {
+    VkAccelerationStructureGeometryKHR       geometry{};
+    VkAccelerationStructureBuildRangeInfoKHR rangeInfo{};
+    VkBuildAccelerationStructureFlagsKHR     flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+  };
+
+  void init(nvvk::ResourceAllocator* allocator,
+            VkDeviceSize             scratchAlignment,  // minAccelerationStructureScratchOffsetAlignment
+            VkDeviceSize             scratchBudget = VkDeviceSize(128) << 20);
+  void deinit();
+
+  // Creates blasSet[i] for inputs[i] and records all the builds
+  void cmdCreateAndBuild(VkCommandBuffer cmd, std::span<const Input> inputs, std::span<nvvk::AccelerationStructure> blasSet);
+
+  uint32_t     getBatchCount() const { return m_batchCount; }  // Batches of the last call
+  VkDeviceSize getScratchSize() const { return m_scratchBuffer.bufferSize; }
+
+private:
+  nvvk::ResourceAllocator*  m_allocator{};
+  VkDevice                  m_device{};
+  VkDeviceSize              m_scratchAlignment = 0;
+  VkDeviceSize              m_scratchBudget    = 0;
+  nvvk::Buffer              m_scratchBuffer{};
+  std::vector<nvvk::Buffer> m_retiredScratch;  // Outgrown scratch buffers, possibly still in use
+  bool                      m_scratchUsed = false;
+  uint32_t                  m_batchCount  = 0;
+};
+
+}  // namespace nvsamples
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#include "blas_compactor.hpp"
+
+#include <cassert>
+
+#include <nvutils/logger.hpp>
+#include "nvvk/check_error.hpp"
+#include "nvvk/debug_util.hpp"
+
+namespace {
+inline double toMegabytes(VkDeviceSize size)
+{
+  return double(size) / (1024.0 * 1024.0);
+}
+}  // namespace
+
+void nvsamples::BlasCompactor::init(nvvk::ResourceAllocator* allocator)
+{
+  m_allocator = allocator;
+  m_device    = allocator->getDevice();
+}
+
+void nvsamples::BlasCompactor::deinit()
+{
+  destroyOriginals();
+  if(m_queryPool)
+  {
+    vkDestroyQueryPool(m_device, m_queryPool, nullptr);
+  }
+  m_queryPool     = VK_NULL_HANDLE;
+  m_queryCapacity = 0;
+  m_allocator     = nullptr;
+}
+
+void nvsamples::BlasCompactor::cmdQuerySizes(VkCommandBuffer cmd, std::span<const nvvk::AccelerationStructure> blasSet)
+{
+  assert(m_originals.empty() && "destroyOriginals must be called before compacting again");
+  m_queryCount = uint32_t(blasSet.size());
+  if(m_queryCount == 0)
+    return;
+
+  if(m_queryCount > m_queryCapacity)
+  {
+    if(m_queryPool)
+    {
+      vkDestroyQueryPool(m_device, m_queryPool, nullptr);
+    }
+    const VkQueryPoolCreateInfo queryPoolInfo{
+        .sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType  = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR,
+        .queryCount = m_queryCount,
+    };
+    NVVK_CHECK(vkCreateQueryPool(m_device, &queryPoolInfo, nullptr, &m_queryPool));
+    NVVK_DBG_NAME(m_queryPool);
+    m_queryCapacity = m_queryCount;
+  }
+
+  std::vector<VkAccelerationStructureKHR> accels(blasSet.size());
+  for(size_t i = 0; i < blasSet.size(); i++)
+  {
+    accels[i] = blasSet[i].accel;
+  }
+
+  // The compacted sizes are only known once the builds are done
+  nvvk::accelerationStructureBarrier(cmd, VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR);
+  vkCmdResetQueryPool(cmd, m_queryPool, 0, m_queryCount);
+  vkCmdWriteAccelerationStructuresPropertiesKHR(cmd, m_queryCount, accels.data(),
+                                                VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR, m_queryPool, 0);
+}
+
+void nvsamples::BlasCompactor::cmdCompact(VkCommandBuffer cmd, std::span<nvvk::AccelerationStructure> blasSet)
+{
+  assert(blasSet.size() == m_queryCount);
+  if(m_queryCount == 0)
+    return;
+
+  m_compactedSizes.resize(m_queryCount);
+  NVVK_CHECK(vkGetQueryPoolResults(m_device, m_queryPool, 0, m_queryCount, m_queryCount * sizeof(VkDeviceSize),
+                                   m_compactedSizes.data(), sizeof(VkDeviceSize), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+
+  m_originalSize  = 0;
+  m_compactedSize = 0;
+  for(uint32_t i = 0; i < m_queryCount; i++)
+  {
+    nvvk::AccelerationStructure& blas         = blasSet[i];
+    const VkDeviceSize           originalSize = blas.buffer.bufferSize;
+    const VkDeviceSize           compactSize  = m_compactedSizes[i];
+    m_originalSize += originalSize;
+
+    // Nothing to gain (or not built with ALLOW_COMPACTION): keep the original
+    if(compactSize == 0 || compactSize >= originalSize)
+    {
+      m_compactedSize += originalSize;
+      continue;
+    }
+
+    const VkAccelerationStructureCreateInfoKHR createInfo{
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR,
+        .size  = compactSize,
+        .type  = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+    };
+    nvvk::AccelerationStructure compacted;
+    NVVK_CHECK(m_allocator->createAcceleration(compacted, createInfo));
+    NVVK_DBG_NAME(compacted.accel);
+
+    const VkCopyAccelerationStructureInfoKHR copyInfo{
+        .sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR,
+        .src   = blas.accel,
+        .dst   = compacted.accel,
+        .mode  = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR,
+    };
+    vkCmdCopyAccelerationStructureKHR(cmd, &copyInfo);
+    m_compactedSize += compacted.buffer.bufferSize;
+
+    LOGI("BLAS %u compacted: %.3f MB -> %.3f MB\n", i, toMegabytes(originalSize), toMegabytes(compacted.buffer.bufferSize));
+
+    m_originals.push_back(blas);
+    blas = compacted;
+  }
+
+  // The copies must be done before the compacted BLAS are referenced by a TLAS build
+  nvvk::accelerationStructureBarrier(cmd, VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR);
+}
+
+void nvsamples::BlasCompactor::destroyOriginals()
+{
+  if(m_originals.empty())
+    return;
+
+  for(nvvk::AccelerationStructure& blas : m_originals)
+  {
+    m_allocator->destroyAcceleration(blas);
+  }
+  LOGI("BLAS compaction: %zu of %u compacted, %.2f MB -> %.2f MB (%.1f%% saved)\n", m_originals.size(), m_queryCount,
+       toMegabytes(m_originalSize), toMegabytes(m_compactedSize),
+       m_originalSize ? 100.0 * double(m_originalSize - m_compactedSize) / double(m_originalSize) : 0.0);
+  m_originals.clear();
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include <nvvk/acceleration_structures.hpp>
+#include <nvvk/resource_allocator.hpp>
+
+namespace nvsamples {
+
+//--------------------------------------------------------------------------------------------------
+// Compacts bottom-level acceleration structures built with VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR.
+//
+// The compaction takes three steps, each one after the GPU has executed the previous one:
+// - cmdQuerySizes(): records the query of the compacted sizes, after the builds in the same command buffer
+// - cmdCompact():    creates right-sized acceleration structures, records the copies and replaces the BLAS in the span
+// - destroyOriginals(): frees the original acceleration structures and logs the memory before and after
+//
+class BlasCompactor
+{
+public:
+  void init(nvvk::ResourceAllocator* allocator);
+  void deinit();
+
+  void cmdQuerySizes(VkCommandBuffer cmd, std::span<const nvvk::AccelerationStructure> blasSet);
+  void cmdCompact(VkCommandBuffer cmd, std::span<nvvk::AccelerationStructure> blasSet);
+  void destroyOriginals();
+
+  VkDeviceSize getOriginalSize() const { return m_originalSize; }
+  VkDeviceSize getCompactedSize() const { return m_compactedSize; }
+
+private:
+  nvvk::ResourceAllocator*                 m_allocator{};
+  VkDevice                                 m_device{};
+  VkQueryPool                              m_queryPool{};
+  uint32_t                                 m_queryCapacity = 0;
+  uint32_t                                 m_queryCount    = 0;
+  std::vector<nvvk::AccelerationStructure> m_originals;  // Replaced by cmdCompact, destroyed by destroyOriginals
+  std::vector<VkDeviceSize>                m_compactedSizes;
+  VkDeviceSize                             m_originalSize  = 0;
+  VkDeviceSize                             m_compactedSize = 0;
+};
+
+}  // namespace nvsamples
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "blas_profile.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "nvutils/file_mapping.hpp"
+#include "nvutils/file_operations.hpp"
+#include "nvutils/logger.hpp"
+
+#include "utils.hpp"
+
+namespace {
+
+// Layout of a profile file:
+// - BlasProfileHeader
+// - BlasProfileEntry[numEntries]
+struct BlasProfileHeader
+{
+  uint32_t magic         = 0;
+  uint32_t formatVersion = 0;
+  uint32_t numEntries    = 0;
+  uint32_t _pad          = 0;
+};
+
+struct BlasProfileEntry
+{
+  uint64_t geometryHash = 0;
+  uint32_t variant      = 0;
+  uint32_t _pad         = 0;
+};
+
+constexpr uint32_t kBlasProfileMagic         = 0x50534152;  // "RASP"
+constexpr uint32_t kBlasProfileFormatVersion = 1;
+
+}  // namespace
+
+const char* nvsamples::getBlasVariantName(BlasVariant variant)
+{
+  switch(variant)
+  {
+    case BlasVariant::eFastTrace:
+      return "fast trace";
+    case BlasVariant::eFastBuild:
+      return "fast build";
+    case BlasVariant::eCompacted:
+      return "compacted";
+    default:
+      return "unknown";
+  }
+}
+
+VkBuildAccelerationStructureFlagsKHR nvsamples::getBlasVariantFlags(BlasVariant variant)
+{
+  switch(variant)
+  {
+    case BlasVariant::eFastBuild:
+      return VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR;
+    case BlasVariant::eCompacted:
+      return VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR;
+    default:
+      return VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+  }
+}
+
+std::filesystem::path nvsamples::BlasProfile::getFilename(const std::filesystem::path& cacheDirectory,
+                                                          std::span<const uint64_t>    geometryHashes)
+{
+  const uint64_t key = hashBytes({reinterpret_cast<const uint8_t*>(geometryHashes.data()), geometryHashes.size_bytes()});
+  return cacheDirectory / fmt::format("blas_{:016x}.blasprofile", key);
+}
+
+bool nvsamples::BlasProfile::load(const std::filesystem::path& filename)
+{
+  m_variants.clear();
+  nvutils::FileReadMapping mapping;
+  if(!mapping.open(filename) || mapping.size() < sizeof(BlasProfileHeader))
+  {
+    return false;
+  }
+
+  const uint8_t*    data = static_cast<const uint8_t*>(mapping.data());
+  BlasProfileHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  if(header.magic != kBlasProfileMagic || header.formatVersion != kBlasProfileFormatVersion
+     || sizeof(BlasProfileHeader) + header.numEntries * sizeof(BlasProfileEntry) > mapping.size())
+  {
+    return false;
+  }
+
+  for(uint32_t i = 0; i < header.numEntries; i++)
+  {
+    BlasProfileEntry entry;
+    std::memcpy(&entry, data + sizeof(BlasProfileHeader) + i * sizeof(BlasProfileEntry), sizeof(entry));
+    if(entry.variant < uint32_t(BlasVariant::eCount))
+    {
+      m_variants[entry.geometryHash] = BlasVariant(entry.variant);
+    }
+  }
+  return true;
+}
+
+bool nvsamples::BlasProfile::save(const std::filesystem::path& filename) const
+{
+  std::vector<BlasProfileEntry> entries;
+  entries.reserve(m_variants.size());
+  for(const auto& [geometryHash, variant] : m_variants)
+  {
+    entries.push_back({.geometryHash = geometryHash, .variant = uint32_t(variant)});
+  }
+  const BlasProfileHeader header{
+      .magic         = kBlasProfileMagic,
+      .formatVersion = kBlasProfileFormatVersion,
+      .numEntries    = uint32_t(entries.size()),
+  };
+
+  // Write to a temporary file first, so that concurrent processes never see a partial profile
+  std::error_code             ec;
+  const std::filesystem::path tempFilename = getTempFilename(filename);
+  std::filesystem::create_directories(filename.parent_path(), ec);
+  {
+    std::ofstream file(tempFilename, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries.data()), std::streamsize(std::span(entries).size_bytes()));
+    if(!file)
+    {
+      LOGW("Could not write the BLAS profile: %s\n", nvutils::utf8FromPath(tempFilename).c_str());
+      return false;
+    }
+  }
+  std::filesystem::rename(tempFilename, filename, ec);
+  if(ec)
+  {
+    std::filesystem::remove(tempFilename, ec);
+    return false;
+  }
+  return true;
+}
+
+nvsamples::BlasVariant nvsamples::BlasProfile::get(uint64_t geometryHash, BlasVariant fallback) const
+{
+  auto it = m_variants.find(geometryHash);
+  return it != m_variants.end() ? it->second : fallback;
+}
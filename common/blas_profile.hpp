@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <span>
+#include <unordered_map>
+
+#include <vulkan/vulkan_core.h>
+
+namespace nvsamples {
+
+// Candidate build configurations of a BLAS, compared by the BLAS tuning of RtBase
+enum class BlasVariant : uint32_t
+{
+  eFastTrace,  // PREFER_FAST_TRACE
+  eFastBuild,  // PREFER_FAST_BUILD, for the geometry rebuilt often
+  eCompacted,  // PREFER_FAST_TRACE and compacted after the build
+  eCount,
+};
+
+const char*                          getBlasVariantName(BlasVariant variant);
+VkBuildAccelerationStructureFlagsKHR getBlasVariantFlags(BlasVariant variant);
+
+//--------------------------------------------------------------------------------------------------
+// Per-scene choice of the BLAS variant of each geometry, stored on disk.
+//
+// The variants are keyed by the geometry hash of the meshes (see GltfSceneResource::meshHashes), and a profile is
+// named after the hash of all the geometry of the scene: a run tuning the BLAS writes it, the following runs load it
+// and build each BLAS with its variant.
+//
+class BlasProfile
+{
+public:
+  static std::filesystem::path getFilename(const std::filesystem::path& cacheDirectory, std::span<const uint64_t> geometryHashes);
+
+  bool load(const std::filesystem::path& filename);
+  bool save(const std::filesystem::path& filename) const;
+
+  void set(uint64_t geometryHash, BlasVariant variant) { m_variants[geometryHash] = variant; }
+  // Returns `fallback` for the geometry not in the profile
+  BlasVariant get(uint64_t geometryHash, BlasVariant fallback) const;
+  bool        empty() const { return m_variants.empty(); }
+
+private:
+  std::unordered_map<uint64_t, BlasVariant> m_variants;
+};
+
+}  // namespace nvsamples
@@ -0,0 +1,693 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "cpu_raytracer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define CPU_RAYTRACER_SSE 1
+#endif
+
+#include <glm/gtc/constants.hpp>
+
+#include "nvutils/timers.hpp"
+
+#include "instance_conversion.hpp"
+#include "vertex_quantization.hpp"
+
+namespace {
+
+constexpr uint32_t kTileSize  = 16;   // Pixels on each side of the tiles
+// Traversal stack: each visited node replaces its entry with at most 4 children, and a 4-wide node is at least one
+// level of the binary BVH, at most SahBvh::kMaxDepth deep
+constexpr uint32_t kStackSize = 3 * nvsamples::SahBvh::kMaxDepth + 1;
+constexpr float    kInfinite  = 1e32f;
+
+// Ray prepared for the slab tests: the near and far planes of each axis depend on the sign of the direction
+struct TraversalRay
+{
+  TraversalRay(const glm::vec3& o, const glm::vec3& d, float tMin)
+      : origin(o)
+      , tMin(tMin)
+  {
+    for(int axis = 0; axis < 3; axis++)
+    {
+      // No infinities: (bound - origin) * invDirection must not be NaN when the origin is on a plane
+      const float dir   = std::abs(d[axis]) < 1e-30f ? (d[axis] < 0.0f ? -1e-30f : 1e-30f) : d[axis];
+      invDirection[axis] = 1.0f / dir;
+      nearPlane[axis]    = dir < 0.0f ? axis + 3 : axis;
+      farPlane[axis]     = dir < 0.0f ? axis : axis + 3;
+    }
+#ifdef CPU_RAYTRACER_SSE
+    for(int axis = 0; axis < 3; axis++)
+    {
+      originSse[axis] = _mm_set1_ps(origin[axis]);
+      invDirSse[axis] = _mm_set1_ps(invDirection[axis]);
+    }
+#endif
+  }
+
+  glm::vec3 origin;
+  glm::vec3 invDirection;
+  float     tMin;
+  int       nearPlane[3];
+  int       farPlane[3];
+#ifdef CPU_RAYTRACER_SSE
+  __m128 originSse[3];
+  __m128 invDirSse[3];
+#endif
+};
+
+// Tests the ray against the 4 children of the node: returns the mask of the children hit before tMax, and their entry
+// distances. The unused children have inverted bounds and are never hit.
+template <typename Node>
+inline uint32_t intersectNode(const Node& node, const TraversalRay& ray, float tMax, float tEntry[4])
+{
+#ifdef CPU_RAYTRACER_SSE
+  __m128 tNear = _mm_set1_ps(ray.tMin);
+  __m128 tFar  = _mm_set1_ps(tMax);
+  for(int axis = 0; axis < 3; axis++)
+  {
+    const __m128 n = _mm_load_ps(node.bounds[ray.nearPlane[axis]]);
+    const __m128 f = _mm_load_ps(node.bounds[ray.farPlane[axis]]);
+    tNear = _mm_max_ps(tNear, _mm_mul_ps(_mm_sub_ps(n, ray.originSse[axis]), ray.invDirSse[axis]));
+    tFar  = _mm_min_ps(tFar, _mm_mul_ps(_mm_sub_ps(f, ray.originSse[axis]), ray.invDirSse[axis]));
+  }
+  _mm_storeu_ps(tEntry, tNear);
+  return uint32_t(_mm_movemask_ps(_mm_cmple_ps(tNear, tFar)));
+#else
+  uint32_t mask = 0;
+  for(int c = 0; c < 4; c++)
+  {
+    float tNear = ray.tMin;
+    float tFar  = tMax;
+    for(int axis = 0; axis < 3; axis++)
+    {
+      tNear = std::max(tNear, (node.bounds[ray.nearPlane[axis]][c] - ray.origin[axis]) * ray.invDirection[axis]);
+      tFar  = std::min(tFar, (node.bounds[ray.farPlane[axis]][c] - ray.origin[axis]) * ray.invDirection[axis]);
+    }
+    tEntry[c] = tNear;
+    mask |= tNear <= tFar ? 1U << c : 0U;
+  }
+  return mask;
+#endif
+}
+
+// Visits the leaves of the BVH hit by the ray, nearest first. `intersectLeaf(first, count, tMax)` returns true on a
+// hit and lowers tMax to the closest hit; the traversal stops at the first hit with kAnyHit.
+template <bool kAnyHit, typename Node, typename LeafFunction>
+bool traverse(const std::vector<Node>& nodes, const TraversalRay& ray, float& tMax, LeafFunction&& intersectLeaf)
+{
+  struct Entry
+  {
+    uint32_t child;
+    uint32_t count;
+    float    tEntry;
+  };
+  Entry    stack[kStackSize];
+  uint32_t stackSize = 0;
+  stack[stackSize++] = {0, 0, ray.tMin};
+
+  bool hit = false;
+  while(stackSize > 0)
+  {
+    const Entry entry = stack[--stackSize];
+    if(entry.tEntry > tMax)
+      continue;  // Behind a closer hit
+
+    if(entry.count > 0)
+    {
+      if(intersectLeaf(entry.child, entry.count, tMax))
+      {
+        hit = true;
+        if(kAnyHit)
+          return true;
+      }
+      continue;
+    }
+
+    const Node& node = nodes[entry.child];
+    float       tEntry[4];
+    const uint32_t mask = intersectNode(node, ray, tMax, tEntry);
+
+    // Pushed far to near, the nearest child is visited next
+    Entry    children[4];
+    uint32_t numChildren = 0;
+    for(int c = 0; c < 4; c++)
+    {
+      if((mask & (1U << c)) == 0)
+        continue;
+      Entry    e{node.child[c], node.count[c], tEntry[c]};
+      uint32_t i = numChildren++;
+      for(; i > 0 && children[i - 1].tEntry < e.tEntry; i--)
+        children[i] = children[i - 1];
+      children[i] = e;
+    }
+    assert(stackSize + numChildren <= kStackSize);
+    for(uint32_t i = 0; i < numChildren; i++)
+      stack[stackSize++] = children[i];
+  }
+  return hit;
+}
+
+// Moller-Trumbore, without culling: the GPU instances are double sided
+template <typename Triangle>
+inline bool intersectTriangle(const Triangle& tri, const glm::vec3& origin, const glm::vec3& direction, float tMin, float tMax, float& t, glm::vec2& uv)
+{
+  const glm::vec3 p   = glm::cross(direction, tri.e2);
+  const float     det = glm::dot(tri.e1, p);
+  if(det == 0.0f)
+    return false;
+  const float     invDet = 1.0f / det;
+  const glm::vec3 s      = origin - tri.v0;
+  uv.x                   = glm::dot(s, p) * invDet;
+  if(uv.x < 0.0f || uv.x > 1.0f)
+    return false;
+  const glm::vec3 q = glm::cross(s, tri.e1);
+  uv.y              = glm::dot(direction, q) * invDet;
+  if(uv.y < 0.0f || uv.x + uv.y > 1.0f)
+    return false;
+  t = glm::dot(tri.e2, q) * invDet;
+  return t > tMin && t < tMax;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Shading, port of pbrMetallicRoughness (pbr.h.slang) and of the closest-hit shader of 05_shadow_miss.
+// The GGX lobe is isotropic: the terms using the tangent frame only depend on the cosine with the normal.
+
+float schlickFresnel(float f0, float f90, float VdotH)
+{
+  return f0 + (f90 - f0) * std::pow(1.0f - VdotH, 5.0f);
+}
+
+glm::vec3 schlickFresnel(const glm::vec3& f0, const glm::vec3& f90, float VdotH)
+{
+  return f0 + (f90 - f0) * std::pow(1.0f - VdotH, 5.0f);
+}
+
+// hvd_ggx_eval, with x^2 + y^2 = 1 - NdotH^2 in the tangent frame
+float ggxEval(float invRoughness, float NdotH)
+{
+  const float f = (1.0f - NdotH * NdotH) * invRoughness * invRoughness + NdotH * NdotH;
+  return glm::one_over_pi<float>() * invRoughness * invRoughness * NdotH / (f * f);
+}
+
+// smith_shadow_mask, `cosine` is the cosine of the direction with the normal
+float smithShadowMask(float cosine, float roughness)
+{
+  const float kz2 = cosine * cosine;
+  if(kz2 == 0.0f)
+    return 0.0f;
+  const float invA2 = roughness * roughness * (1.0f - kz2) / kz2;
+  return 2.0f / (1.0f + std::sqrt(1.0f + invA2));
+}
+
+glm::vec3 pbrMetallicRoughness(const glm::vec3& albedo, float metallic, float roughness, const glm::vec3& N, const glm::vec3& V, const glm::vec3& L)
+{
+  const glm::vec3 H     = glm::normalize(V + L);
+  const float     NdotV = std::max(glm::dot(N, V), 0.0f);
+  const float     NdotL = std::max(glm::dot(N, L), 0.0f);
+  const float     VdotH = std::max(glm::dot(V, H), 0.0f);
+  const float     NdotH = std::max(glm::dot(N, H), 0.0f);
+  if(NdotV == 0.0f || NdotL == 0.0f || VdotH == 0.0f || NdotH == 0.0f)
+    return glm::vec3(0.0f);
+
+  constexpr float kMinReflectance = 0.04f;
+  const glm::vec3 f0       = glm::mix(glm::vec3(kMinReflectance), albedo, metallic);
+  const glm::vec3 fGlossy  = schlickFresnel(f0, glm::vec3(1.0f), VdotH);
+  const float     fDiffuse = schlickFresnel(1.0f - kMinReflectance, 0.0f, VdotH) * (1.0f - metallic);
+
+  const float d  = ggxEval(1.0f / roughness, NdotH);
+  const float g1 = smithShadowMask(NdotV, roughness);
+  const float g2 = g1 * smithShadowMask(NdotL, roughness);
+
+  const float diffusePdf  = glm::one_over_pi<float>() * NdotL;
+  const float specularPdf = g1 * d * 0.25f / (NdotV * NdotH);
+  return albedo * fDiffuse * diffusePdf + fGlossy * g2 * specularPdf;
+}
+
+// processLight of the shader: sky override, distance and cone attenuation. The direction is toward the light.
+shaderio::GltfPunctual processLight(const shaderio::GltfSceneInfo& sceneInfo, const glm::vec3& worldPos)
+{
+  shaderio::GltfPunctual light = sceneInfo.punctualLights[0];
+  if(sceneInfo.useSky == 1)
+  {
+    light.direction = sceneInfo.skySimpleParam.sunDirection;
+    light.color     = sceneInfo.skySimpleParam.sunColor;
+    light.intensity = sceneInfo.skySimpleParam.sunIntensity;
+    light.type      = shaderio::GltfLightType::eDirectional;
+  }
+
+  if(light.type == shaderio::GltfLightType::ePoint)
+  {
+    light.direction = light.position - worldPos;
+    const float d   = glm::length(light.direction);
+    light.intensity /= (d * d);
+  }
+  else if(light.type == shaderio::GltfLightType::eSpot)
+  {
+    const glm::vec3 lightDir = light.position - worldPos;
+    const float     d        = glm::length(lightDir);
+    light.intensity /= (d * d);
+    const float theta         = glm::dot(glm::normalize(lightDir), glm::normalize(light.direction));
+    const float spotIntensity = glm::clamp((theta - std::cos(light.coneAngle)) / (1.0f - std::cos(light.coneAngle)), 0.0f, 1.0f);
+    light.intensity *= spotIntensity;
+    light.direction = lightDir;
+  }
+  return light;
+}
+
+// Miss color. The sky is a gradient from the ground to the sky color, an approximation of evalSimpleSky without the
+// horizon and the sun glow.
+glm::vec3 missColor(const shaderio::GltfSceneInfo& sceneInfo, const glm::vec3& direction)
+{
+  if(sceneInfo.useSky == 1)
+  {
+    const float t = glm::smoothstep(-0.05f, 0.05f, direction.y);
+    return glm::mix(glm::vec3(sceneInfo.skySimpleParam.groundColor), glm::vec3(sceneInfo.skySimpleParam.skyColor), t);
+  }
+  return sceneInfo.backgroundColor;
+}
+
+// Per-worker counters, on their own cache line
+struct alignas(64) WorkerCounters
+{
+  uint64_t numRays = 0;
+};
+
+}  // namespace
+
+
+void nvsamples::CpuRaytracer::init(uint32_t numThreads /*= 0*/)
+{
+  m_scheduler.init(numThreads);
+}
+
+void nvsamples::CpuRaytracer::deinit()
+{
+  m_scheduler.deinit();
+  m_meshes.clear();
+  m_meshIndices.clear();
+  m_topLevelNodes.clear();
+  m_topLevelInstances.clear();
+  m_instances.clear();
+  m_builtInstances.clear();
+}
+
+void nvsamples::CpuRaytracer::createScene(const GltfSceneResource& scene, const std::function<const uint8_t*(uint32_t meshIndex)>& getMeshData)
+{
+  SCOPED_TIMER(__FUNCTION__);
+
+  m_meshes.clear();
+  m_meshIndices.assign(scene.meshes.size(), ~0U);
+  for(uint32_t i = 0; i < uint32_t(scene.meshes.size()); i++)
+  {
+    if(scene.getGeometryMesh(i) != i)
+      continue;
+    m_meshIndices[i] = uint32_t(m_meshes.size());
+    createMesh(scene.meshes[i], getMeshData(i), m_meshes.emplace_back());
+  }
+  for(uint32_t i = 0; i < uint32_t(scene.meshes.size()); i++)
+  {
+    m_meshIndices[i] = m_meshIndices[scene.getGeometryMesh(i)];
+  }
+
+  // The top level is built by the first render
+  m_builtInstances.clear();
+  m_topLevelNodes.clear();
+}
+
+// Decodes the vertices and the triangles of the mesh, whatever their storage format (see vertex_attributes.h.slang),
+// and builds its BVH
+void nvsamples::CpuRaytracer::createMesh(const shaderio::GltfMesh& gltfMesh, const uint8_t* data, Mesh& mesh)
+{
+  const shaderio::TriangleMesh& triMesh = gltfMesh.triMesh;
+
+  std::vector<glm::vec3> positions(triMesh.positions.count);
+  const bool     quantized      = triMesh.positions.format == shaderio::eVertexFormatSnorm16;
+  const uint32_t positionStride = triMesh.positions.byteStride ? triMesh.positions.byteStride :
+                                  quantized                     ? uint32_t(sizeof(QuantizedPosition)) :
+                                                                  uint32_t(sizeof(glm::vec3));
+  for(uint32_t v = 0; v < triMesh.positions.count; v++)
+  {
+    const uint8_t* ptr = data + triMesh.positions.offset + size_t(v) * positionStride;
+    if(quantized)
+    {
+      QuantizedPosition q;
+      std::memcpy(&q, ptr, sizeof(q));
+      positions[v] = dequantizePosition(q, gltfMesh.dequantScale, gltfMesh.dequantOffset);
+    }
+    else
+    {
+      std::memcpy(&positions[v], ptr, sizeof(glm::vec3));
+    }
+  }
+
+  // Meshes without normals get (1, 1, 1), like in the shaders
+  mesh.normals.assign(triMesh.positions.count, glm::vec3(1.0f));
+  if(triMesh.normals.count > 0)
+  {
+    const bool     octahedral   = triMesh.normals.format == shaderio::eVertexFormatOct16;
+    const uint32_t normalStride = triMesh.normals.byteStride ? triMesh.normals.byteStride :
+                                  octahedral                  ? uint32_t(sizeof(QuantizedDirection)) :
+                                                                uint32_t(sizeof(glm::vec3));
+    for(uint32_t v = 0; v < std::min(triMesh.normals.count, triMesh.positions.count); v++)
+    {
+      const uint8_t* ptr = data + triMesh.normals.offset + size_t(v) * normalStride;
+      if(octahedral)
+      {
+        QuantizedDirection q;
+        std::memcpy(&q, ptr, sizeof(q));
+        mesh.normals[v] = glm::vec3(dequantizeDirection(q));
+      }
+      else
+      {
+        std::memcpy(&mesh.normals[v], ptr, sizeof(glm::vec3));
+      }
+    }
+  }
+
+  const uint32_t indexSize   = gltfMesh.indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4;
+  const uint32_t indexStride = triMesh.indices.byteStride ? triMesh.indices.byteStride : indexSize;
+  const uint32_t numTriangles = triMesh.indices.count / 3;
+  mesh.indices.resize(numTriangles);
+  std::vector<BvhBounds> triangleBounds(numTriangles);
+  for(uint32_t t = 0; t < numTriangles; t++)
+  {
+    for(uint32_t k = 0; k < 3; k++)
+    {
+      const uint8_t* ptr = data + triMesh.indices.offset + size_t(3 * t + k) * indexStride;
+      uint32_t       index = 0;
+      if(indexSize == 2)
+      {
+        uint16_t index16;
+        std::memcpy(&index16, ptr, sizeof(index16));
+        index = index16;
+      }
+      else
+      {
+        std::memcpy(&index, ptr, sizeof(index));
+      }
+      mesh.indices[t][k] = std::min(index, triMesh.positions.count - 1);
+      triangleBounds[t].grow(positions[mesh.indices[t][k]]);
+    }
+    mesh.bounds.grow(triangleBounds[t]);
+  }
+
+  SahBvh bvh;
+  bvh.build(triangleBounds, SahBvh::Settings{});
+  collapseBvh(bvh.getNodes(), mesh.nodes);
+
+  // The triangles are stored in the order of the leaves, ready for the intersection
+  const std::vector<uint32_t>& order = bvh.getPrimitiveIndices();
+  mesh.triangles.resize(order.size());
+  for(size_t i = 0; i < order.size(); i++)
+  {
+    const glm::uvec3& tri = mesh.indices[order[i]];
+    const glm::vec3&  v0  = positions[tri.x];
+    mesh.triangles[i]     = {v0, positions[tri.y] - v0, positions[tri.z] - v0, order[i]};
+  }
+}
+
+// Collapses the binary BVH into 4-wide nodes: each node opens its largest inner children until it has 4 children
+void nvsamples::CpuRaytracer::collapseBvh(const std::vector<SahBvh::Node>& bvh, std::vector<Node>& nodes)
+{
+  Node emptyNode{};
+  for(int c = 0; c < 4; c++)
+  {
+    for(int axis = 0; axis < 3; axis++)
+    {
+      emptyNode.bounds[axis][c]     = kInfinite;
+      emptyNode.bounds[axis + 3][c] = -kInfinite;
+    }
+  }
+
+  nodes.assign(1, emptyNode);
+  if(bvh.empty())
+    return;
+
+  // Binary node collapsed into each 4-wide node
+  std::vector<std::pair<uint32_t, uint32_t>> stack{{0, 0}};
+  while(!stack.empty())
+  {
+    const auto [binaryIndex, nodeIndex] = stack.back();
+    stack.pop_back();
+
+    uint32_t children[4];
+    uint32_t numChildren = 0;
+    if(bvh[binaryIndex].count > 0)
+    {
+      children[numChildren++] = binaryIndex;  // The root is a leaf
+    }
+    else
+    {
+      children[numChildren++] = bvh[binaryIndex].first;
+      children[numChildren++] = bvh[binaryIndex].first + 1;
+    }
+    while(numChildren < 4)
+    {
+      int   largest     = -1;
+      float largestArea = -1.0f;
+      for(uint32_t c = 0; c < numChildren; c++)
+      {
+        const SahBvh::Node& child = bvh[children[c]];
+        if(child.count == 0 && child.bounds.getArea() > largestArea)
+        {
+          largest     = int(c);
+          largestArea = child.bounds.getArea();
+        }
+      }
+      if(largest < 0)
+        break;
+      const uint32_t left     = bvh[children[largest]].first;
+      children[largest]       = left;
+      children[numChildren++] = left + 1;
+    }
+
+    Node node = emptyNode;
+    for(uint32_t c = 0; c < numChildren; c++)
+    {
+      const SahBvh::Node& child = bvh[children[c]];
+      for(int axis = 0; axis < 3; axis++)
+      {
+        node.bounds[axis][c]     = child.bounds.min[axis];
+        node.bounds[axis + 3][c] = child.bounds.max[axis];
+      }
+      if(child.count > 0)
+      {
+        node.child[c] = child.first;
+        node.count[c] = child.count;
+      }
+      else
+      {
+        node.child[c] = uint32_t(nodes.size());
+        nodes.push_back(emptyNode);
+        stack.emplace_back(children[c], node.child[c]);
+      }
+    }
+    nodes[nodeIndex] = node;
+  }
+}
+
+// BVH over the world bounds of the instances
+void nvsamples::CpuRaytracer::createTopLevel(const GltfSceneResource& scene)
+{
+  std::vector<glm::mat3> normalMatrices(scene.instances.size());
+  computeNormalMatrices(scene.instances, normalMatrices);
+
+  m_instances.resize(scene.instances.size());
+  std::vector<BvhBounds> instanceBounds(scene.instances.size());
+  for(size_t i = 0; i < scene.instances.size(); i++)
+  {
+    const shaderio::GltfInstance& gltfInstance = scene.instances[i];
+    Instance&                     instance     = m_instances[i];
+    instance.objectToWorld                     = gltfInstance.transform;
+    instance.worldToObject                     = glm::inverse(gltfInstance.transform);
+    instance.normalMatrix                      = normalMatrices[i];
+    instance.mesh                              = m_meshIndices[gltfInstance.meshIndex];
+    instance.materialIndex                     = gltfInstance.materialIndex;
+
+    const BvhBounds& bounds = m_meshes[instance.mesh].bounds;
+    if(bounds.isEmpty())
+      continue;
+    for(int corner = 0; corner < 8; corner++)
+    {
+      const glm::vec3 p((corner & 1) ? bounds.max.x : bounds.min.x, (corner & 2) ? bounds.max.y : bounds.min.y,
+                        (corner & 4) ? bounds.max.z : bounds.min.z);
+      instanceBounds[i].grow(glm::vec3(instance.objectToWorld * glm::vec4(p, 1.0f)));
+    }
+  }
+
+  SahBvh::Settings settings;
+  settings.maxLeafSize = 1;  // Entering an instance transforms the ray, better split as much as possible
+  SahBvh bvh;
+  bvh.build(instanceBounds, settings);
+  collapseBvh(bvh.getNodes(), m_topLevelNodes);
+  m_topLevelInstances = bvh.getPrimitiveIndices();
+  m_builtInstances    = scene.instances;
+}
+
+template <bool kAnyHit>
+bool nvsamples::CpuRaytracer::traceRay(const Ray& ray, Hit& hit) const
+{
+  const TraversalRay worldRay(ray.origin, ray.direction, ray.tMin);
+  float              tMax = ray.tMax;
+  return traverse<kAnyHit>(m_topLevelNodes, worldRay, tMax, [&](uint32_t first, uint32_t count, float& tMaxInstance) {
+    bool instanceHit = false;
+    for(uint32_t i = first; i < first + count; i++)
+    {
+      const uint32_t  instanceIndex = m_topLevelInstances[i];
+      const Instance& instance      = m_instances[instanceIndex];
+      const Mesh&     mesh          = m_meshes[instance.mesh];
+
+      // The direction is not normalized, the distances along the ray are the same in both spaces
+      const glm::vec3    origin    = glm::vec3(instance.worldToObject * glm::vec4(ray.origin, 1.0f));
+      const glm::vec3    direction = glm::mat3(instance.worldToObject) * ray.direction;
+      const TraversalRay objectRay(origin, direction, ray.tMin);
+
+      const bool meshHit = traverse<kAnyHit>(mesh.nodes, objectRay, tMaxInstance, [&](uint32_t firstTriangle, uint32_t numTriangles, float& tMaxTriangle) {
+        bool triangleHit = false;
+        for(uint32_t t = firstTriangle; t < firstTriangle + numTriangles; t++)
+        {
+          float     tHit;
+          glm::vec2 uv;
+          if(intersectTriangle(mesh.triangles[t], origin, direction, ray.tMin, tMaxTriangle, tHit, uv))
+          {
+            tMaxTriangle = tHit;
+            hit          = {tHit, uv, instanceIndex, mesh.triangles[t].primitive};
+            triangleHit  = true;
+            if(kAnyHit)
+              break;
+          }
+        }
+        return triangleHit;
+      });
+
+      if(meshHit)
+      {
+        instanceHit = true;
+        if(kAnyHit)
+          break;
+      }
+    }
+    return instanceHit;
+  });
+}
+
+// Color of a primary ray, like the closest-hit and miss shaders
+glm::vec3 nvsamples::CpuRaytracer::shade(const GltfSceneResource& scene, const glm::vec2& metallicRoughnessOverride, const Ray& ray, uint64_t& numRays) const
+{
+  const shaderio::GltfSceneInfo& sceneInfo = scene.sceneInfo;
+
+  Hit hit;
+  numRays++;
+  if(!traceRay<false>(ray, hit))
+  {
+    return missColor(sceneInfo, ray.direction);
+  }
+
+  const Instance&   instance     = m_instances[hit.instance];
+  const Mesh&       mesh         = m_meshes[instance.mesh];
+  const glm::uvec3& indices      = mesh.indices[hit.primitive];
+  const glm::vec3   barycentrics = {1.0f - hit.barycentrics.x - hit.barycentrics.y, hit.barycentrics.x, hit.barycentrics.y};
+
+  const glm::vec3 worldPos = ray.origin + ray.direction * hit.t;
+  const glm::vec3 nrm      = mesh.normals[indices.x] * barycentrics.x + mesh.normals[indices.y] * barycentrics.y
+                        + mesh.normals[indices.z] * barycentrics.z;
+  const glm::vec3 N = glm::normalize(instance.normalMatrix * nrm);
+  const glm::vec3 V = -glm::normalize(ray.direction);
+
+  const shaderio::GltfPunctual light = processLight(sceneInfo, worldPos);
+  const glm::vec3              L     = glm::normalize(light.direction);
+
+  // Shadow
+  const Ray shadowRay{
+      .origin    = worldPos + N * 0.001f,
+      .direction = L,
+      .tMin      = 0.001f,
+      .tMax      = light.type == shaderio::GltfLightType::eDirectional ? kInfinite : glm::length(light.direction),
+  };
+  Hit shadowHit;
+  numRays++;
+  const float shadowFactor = traceRay<true>(shadowRay, shadowHit) ? 0.0f : 1.0f;
+
+  const shaderio::GltfMetallicRoughness& material = scene.materials[instance.materialIndex];
+  const glm::vec3                        albedo   = glm::vec3(material.baseColorFactor);
+  const float metallic  = metallicRoughnessOverride.x >= 0.0f ? metallicRoughnessOverride.x : material.metallicFactor;
+  const float roughness = metallicRoughnessOverride.y >= 0.0f ? metallicRoughnessOverride.y : material.roughnessFactor;
+
+  glm::vec3 color = pbrMetallicRoughness(albedo, metallic, roughness, N, V, L);
+  color *= light.color * light.intensity * shadowFactor;
+
+  // Ambient from the background, the shader does the same with the sky
+  color += glm::vec3(sceneInfo.backgroundColor) * albedo * 0.025f;
+  return color;
+}
+
+void nvsamples::CpuRaytracer::render(const GltfSceneResource& scene, const glm::vec2& metallicRoughnessOverride, const glm::uvec2& size, glm::vec4* image)
+{
+  assert(isInitialized());
+  const auto start = std::chrono::steady_clock::now();
+
+  if(m_topLevelNodes.empty() || scene.instances.size() != m_builtInstances.size()
+     || std::memcmp(scene.instances.data(), m_builtInstances.data(), std::span(m_builtInstances).size_bytes()) != 0)
+  {
+    createTopLevel(scene);
+  }
+
+  // Camera rays of the ray generation shader
+  const shaderio::GltfSceneInfo& sceneInfo = scene.sceneInfo;
+  const glm::vec3                origin    = glm::vec3(sceneInfo.viewInvMatrix * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+  const glm::vec2                imageSize = glm::vec2(size);
+
+  const uint32_t              tilesX = (size.x + kTileSize - 1) / kTileSize;
+  const uint32_t              tilesY = (size.y + kTileSize - 1) / kTileSize;
+  std::vector<WorkerCounters> counters(m_scheduler.getWorkerCount());
+  m_scheduler.run(tilesX * tilesY, [&](uint32_t tile, uint32_t worker) {
+    const glm::uvec2 tileMin = glm::uvec2(tile % tilesX, tile / tilesX) * kTileSize;
+    const glm::uvec2 tileMax = glm::min(tileMin + kTileSize, size);
+    for(uint32_t y = tileMin.y; y < tileMax.y; y++)
+    {
+      for(uint32_t x = tileMin.x; x < tileMax.x; x++)
+      {
+        const glm::vec2 clipCoords = glm::vec2(x, y) / imageSize * 2.0f - 1.0f;
+        const glm::vec4 viewCoords = sceneInfo.projInvMatrix * glm::vec4(clipCoords, 1.0f, 1.0f);
+        const Ray       ray{
+                  .origin    = origin,
+                  .direction = glm::vec3(sceneInfo.viewInvMatrix * glm::vec4(glm::normalize(glm::vec3(viewCoords)), 0.0f)),
+                  .tMin      = 0.001f,
+                  .tMax      = kInfinite,
+        };
+        image[size_t(y) * size.x + x] = glm::vec4(shade(scene, metallicRoughnessOverride, ray, counters[worker].numRays), 1.0f);
+      }
+    }
+  });
+
+  m_stats.numRays = 0;
+  for(const WorkerCounters& c : counters)
+    m_stats.numRays += c.numRays;
+  m_stats.numThreads = m_scheduler.getWorkerCount();
+  m_stats.numSteals  = m_scheduler.getStealCount();
+  m_stats.renderTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
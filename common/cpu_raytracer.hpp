@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "gltf_utils.hpp"
+#include "sah_bvh.hpp"
+#include "tile_scheduler.hpp"
+
+namespace nvsamples {
+
+//--------------------------------------------------------------------------------------------------
+// Ray tracer running on the CPU, for the machines without ray tracing support (render nodes, CI).
+//
+// It renders a GltfSceneResource like the ray tracing pipeline of 05_shadow_miss: PBR shading of the first light with
+// a shadow ray and the ambient of the background, and the background or the sky on a miss. The output is the linear
+// color of each pixel, to be copied where the pipeline writes it (eImgRendered) and tonemapped the same way.
+//
+// The acceleration structures mirror the GPU ones: one BVH per geometry, built once, and one over the instances,
+// rebuilt when they change. The binary SahBvh are collapsed to 4-wide nodes, whose 4 children are tested at once with
+// SSE. The image is split in tiles, run on all the threads with work stealing (see TileScheduler).
+//
+class CpuRaytracer
+{
+public:
+  struct Stats
+  {
+    double   renderTime = 0;  // Of the last frame, in milliseconds
+    uint64_t numRays    = 0;  // Primary and shadow rays of the last frame
+    uint32_t numThreads = 0;
+    uint32_t numSteals  = 0;  // Tile ranges stolen during the last frame
+  };
+
+  void init(uint32_t numThreads = 0);  // 0: one per hardware thread
+  void deinit();
+  bool isInitialized() const { return m_scheduler.getWorkerCount() > 0; }
+
+  // Builds the BVH of each geometry of the scene. The geometry is read on the host: `getMeshData(meshIndex)` returns
+  // the host address of the data referenced by GltfMesh::gltfBuffer.
+  void createScene(const GltfSceneResource& scene, const std::function<const uint8_t*(uint32_t meshIndex)>& getMeshData);
+
+  // Renders `size.x` x `size.y` pixels in `image`, from the top row. The BVH of the instances is rebuilt first if they
+  // changed since the previous frame.
+  void render(const GltfSceneResource& scene, const glm::vec2& metallicRoughnessOverride, const glm::uvec2& size, glm::vec4* image);
+
+  const Stats& getStats() const { return m_stats; }
+
+private:
+  // 4-wide BVH node, the bounds of the children are stored per axis to be tested together
+  struct alignas(16) Node
+  {
+    float    bounds[6][4];  // Min x, y, z then max x, y, z of each child, inverted for the unused children
+    uint32_t child[4];      // Inner child: index of its node. Leaf: first primitive
+    uint32_t count[4];      // Primitives of a leaf, 0 for an inner child
+  };
+
+  struct Triangle
+  {
+    glm::vec3 v0;
+    glm::vec3 e1;  // v1 - v0
+    glm::vec3 e2;  // v2 - v0
+    uint32_t  primitive;
+  };
+
+  struct Mesh
+  {
+    std::vector<Node>       nodes;
+    std::vector<Triangle>   triangles;  // In the order of the leaves
+    std::vector<glm::uvec3> indices;    // Of each primitive
+    std::vector<glm::vec3>  normals;    // Of each vertex
+    BvhBounds               bounds;
+  };
+
+  struct Instance
+  {
+    glm::mat4 objectToWorld;
+    glm::mat4 worldToObject;
+    glm::mat3 normalMatrix;
+    uint32_t  mesh;  // In m_meshes
+    uint32_t  materialIndex;
+  };
+
+  struct Ray
+  {
+    glm::vec3 origin;
+    glm::vec3 direction;
+    float     tMin;
+    float     tMax;
+  };
+
+  struct Hit
+  {
+    float     t = 0;
+    glm::vec2 barycentrics{};  // Weights of the second and third vertices
+    uint32_t  instance  = 0;
+    uint32_t  primitive = 0;
+  };
+
+  void createMesh(const shaderio::GltfMesh& gltfMesh, const uint8_t* data, Mesh& mesh);
+  void createTopLevel(const GltfSceneResource& scene);
+  static void collapseBvh(const std::vector<SahBvh::Node>& bvh, std::vector<Node>& nodes);
+
+  // Closest hit, or any hit for the shadow rays
+  template <bool kAnyHit>
+  bool traceRay(const Ray& ray, Hit& hit) const;
+  glm::vec3 shade(const GltfSceneResource& scene, const glm::vec2& metallicRoughnessOverride, const Ray& ray, uint64_t& numRays) const;
+
+  TileScheduler         m_scheduler;
+  std::vector<Mesh>     m_meshes;
+  std::vector<uint32_t> m_meshIndices;  // Index in m_meshes of each mesh of the scene, the aliases share their geometry
+
+  std::vector<Node>                   m_topLevelNodes;
+  std::vector<uint32_t>               m_topLevelInstances;  // Instance of each top-level leaf primitive
+  std::vector<Instance>               m_instances;
+  std::vector<shaderio::GltfInstance> m_builtInstances;  // Instances of the top level, to detect the changes
+  Stats                               m_stats;
+};
+
+}  // namespace nvsamples
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#include "frame_ring.hpp"
+
+#include <cassert>
+#include <cstring>
+
+#include "nvutils/logger.hpp"
+#include "nvvk/check_error.hpp"
+#include "nvvk/debug_util.hpp"
+
+namespace {
+// Keeps every region aligned for any use of the allocations (copy source, storage, AS build input)
+constexpr VkDeviceSize kRegionAlignment = 256;
+}  // namespace
+
+void nvsamples::FrameRing::init(nvvk::ResourceAllocator* allocator,
+                                uint32_t                 numFrames,
+                                VkBufferUsageFlags2      usage /*= kDefaultUsage*/,
+                                VkDeviceSize             frameSize /*= 4 MB*/)
+{
+  assert(numFrames > 0);
+  m_allocator = allocator;
+  m_numFrames = numFrames;
+  m_frameSize = (frameSize + kRegionAlignment - 1) & ~(kRegionAlignment - 1);
+
+  NVVK_CHECK(m_allocator->createBuffer(m_buffer, m_frameSize * m_numFrames, usage, VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+                                       VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT));
+  NVVK_DBG_NAME(m_buffer.buffer);
+  m_used      = 0;
+  m_frameOpen = false;
+}
+
+void nvsamples::FrameRing::deinit()
+{
+  if(m_allocator)
+  {
+    m_allocator->destroyBuffer(m_buffer);
+  }
+  m_allocator = nullptr;
+}
+
+void nvsamples::FrameRing::beginFrame(uint32_t frameIndex)
+{
+  if(m_frameOpen)
+    return;
+  m_frameIndex = frameIndex % m_numFrames;
+  m_used       = 0;
+  m_frameOpen  = true;
+}
+
+void nvsamples::FrameRing::endFrame()
+{
+  flush();
+  m_frameOpen = false;
+}
+
+void nvsamples::FrameRing::flush()
+{
+  if(m_used == 0)
+    return;
+  NVVK_CHECK(vmaFlushAllocation(*m_allocator, m_buffer.allocation, m_frameIndex * m_frameSize, m_used));
+}
+
+bool nvsamples::FrameRing::allocate(VkDeviceSize size, Allocation& allocation, VkDeviceSize alignment /*= 16*/)
+{
+  assert(m_frameOpen && "beginFrame must be called before allocating");
+  const VkDeviceSize offset = (m_used + alignment - 1) & ~(alignment - 1);
+  if(offset + size > m_frameSize)
+  {
+    LOGW("FrameRing: %llu bytes requested, %llu of %llu used this frame\n", (unsigned long long)size,
+         (unsigned long long)m_used, (unsigned long long)m_frameSize);
+    return false;
+  }
+  m_used = offset + size;
+
+  const VkDeviceSize bufferOffset = m_frameIndex * m_frameSize + offset;
+  allocation = {
+      .buffer  = m_buffer.buffer,
+      .offset  = bufferOffset,
+      .data    = static_cast<uint8_t*>(m_buffer.mapping) + bufferOffset,
+      .address = m_buffer.address + bufferOffset,
+  };
+  return true;
+}
+
+bool nvsamples::FrameRing::cmdUploadBuffer(VkCommandBuffer cmd, VkBuffer dstBuffer, VkDeviceSize dstOffset, std::span<const uint8_t> data)
+{
+  if(data.empty())
+    return true;
+
+  Allocation allocation;
+  if(!allocate(data.size(), allocation))
+    return false;
+
+  std::memcpy(allocation.data, data.data(), data.size());
+  const VkBufferCopy region{.srcOffset = allocation.offset, .dstOffset = dstOffset, .size = data.size()};
+  vkCmdCopyBuffer(cmd, allocation.buffer, dstBuffer, 1, &region);
+  return true;
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+
+#include <span>
+
+#include <nvvk/resource_allocator.hpp>
+#include <nvvk/resources.hpp>
+
+namespace nvsamples {
+
+//--------------------------------------------------------------------------------------------------
+// Persistently mapped staging ring for the data uploaded every frame (instances, scene information, ...).
+//
+// The buffer is split in one region per frame in flight. A region is only rewritten once the frame that used it
+// is done on the GPU, which is guaranteed by the frame cycle of the application: beginFrame() takes the region of
+// the current frame, and the allocations are linear in it. Nothing is allocated or freed in the frame loop.
+//
+// beginFrame() can be called several times in a frame (the first call wins), endFrame() closes the frame and flushes
+// the host writes of its region, as the memory may not be host coherent. A command buffer using the allocations must
+// be submitted after endFrame(), or after flush().
+//
+class FrameRing
+{
+public:
+  struct Allocation
+  {
+    VkBuffer        buffer  = VK_NULL_HANDLE;
+    VkDeviceSize    offset  = 0;        // Offset in `buffer`
+    uint8_t*        data    = nullptr;  // Mapped memory of the allocation
+    VkDeviceAddress address = 0;        // Device address of the allocation
+  };
+
+  static constexpr VkBufferUsageFlags2 kDefaultUsage =
+      VK_BUFFER_USAGE_2_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT
+      | VK_BUFFER_USAGE_2_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR;
+
+  // `usage` must leave out the acceleration structure build input bit when the device has no acceleration structures
+  void init(nvvk::ResourceAllocator* allocator,
+            uint32_t                 numFrames,
+            VkBufferUsageFlags2      usage     = kDefaultUsage,
+            VkDeviceSize             frameSize = VkDeviceSize(4) << 20);
+  void deinit();
+  bool isInitialized() const { return m_buffer.buffer != VK_NULL_HANDLE; }
+
+  void beginFrame(uint32_t frameIndex);
+  void endFrame();
+
+  // Makes the host writes to the region of the current frame visible to the device
+  void flush();
+
+  // Suballocates from the region of the current frame, returns false when the region is full
+  [[nodiscard]] bool allocate(VkDeviceSize size, Allocation& allocation, VkDeviceSize alignment = 16);
+
+  // Copies the data to `dstBuffer` through the ring, the caller is responsible for the barriers around the copy.
+  // Returns false, without recording anything, when the region of the frame is full: the caller must then upload the
+  // data another way (staging uploader, vkCmdUpdateBuffer).
+  [[nodiscard]] bool cmdUploadBuffer(VkCommandBuffer cmd, VkBuffer dstBuffer, VkDeviceSize dstOffset, std::span<const uint8_t> data);
+  template <typename T>
+  [[nodiscard]] bool cmdUploadBuffer(VkCommandBuffer cmd, const nvvk::Buffer& dstBuffer, VkDeviceSize dstOffset, std::span<const T> data)
+  {
+    return cmdUploadBuffer(cmd, dstBuffer.buffer, dstOffset,
+                           std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(data.data()), data.size_bytes()));
+  }
+
+  VkDeviceSize getFrameSize() const { return m_frameSize; }
+  VkDeviceSize getFrameUsage() const { return m_used; }
+
+private:
+  nvvk::ResourceAllocator* m_allocator{};
+  nvvk::Buffer             m_buffer{};
+  VkDeviceSize             m_frameSize  = 0;
+  uint32_t                 m_numFrames  = 0;
+  uint32_t                 m_frameIndex = 0;
+  VkDeviceSize             m_used       = 0;  // Bytes allocated in the region of the current frame
+  bool                     m_frameOpen  = false;
+};
+
+}  // namespace nvsamples
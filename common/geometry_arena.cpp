@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "geometry_arena.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include "nvvk/check_error.hpp"
+#include "nvvk/debug_util.hpp"
+
+void nvsamples::GeometryArena::init(nvvk::ResourceAllocator* allocator,
+                                    VkBufferUsageFlags2      usage /*= kDefaultUsage*/,
+                                    VkDeviceSize             blockSize /*= 128 MB*/)
+{
+  m_allocator     = allocator;
+  m_usage         = usage;
+  m_blockSize     = (blockSize + kAlignment - 1) & ~(kAlignment - 1);
+  m_allocatedSize = 0;
+}
+
+void nvsamples::GeometryArena::deinit()
+{
+  for(Block& block : m_blocks)
+  {
+    m_allocator->destroyBuffer(block.buffer);
+  }
+  m_blocks.clear();
+  m_allocator = nullptr;
+}
+
+nvsamples::GeometryArena::Allocation nvsamples::GeometryArena::allocate(VkDeviceSize size)
+{
+  assert(isInitialized());
+  const VkDeviceSize alignedSize = std::max((size + kAlignment - 1) & ~(kAlignment - 1), kAlignment);
+
+  // Best fit among the free ranges of all blocks, keeping the large ranges for the large requests
+  uint32_t     bestBlock = ~0U;
+  VkDeviceSize bestOffset = 0, bestSize = ~VkDeviceSize(0);
+  for(uint32_t b = 0; b < uint32_t(m_blocks.size()); b++)
+  {
+    for(const auto& [offset, rangeSize] : m_blocks[b].freeRanges)
+    {
+      if(rangeSize >= alignedSize && rangeSize < bestSize)
+      {
+        bestBlock  = b;
+        bestOffset = offset;
+        bestSize   = rangeSize;
+      }
+    }
+  }
+
+  if(bestBlock == ~0U)
+  {
+    Block block;
+    NVVK_CHECK(m_allocator->createBuffer(block.buffer, std::max(m_blockSize, alignedSize), m_usage));
+    NVVK_DBG_NAME(block.buffer.buffer);
+    block.freeRanges[0] = block.buffer.bufferSize;
+    bestBlock           = uint32_t(m_blocks.size());
+    bestOffset          = 0;
+    bestSize            = block.buffer.bufferSize;
+    m_blocks.push_back(std::move(block));
+  }
+
+  // The allocation takes the front of the range
+  Block& block = m_blocks[bestBlock];
+  block.freeRanges.erase(bestOffset);
+  if(bestSize > alignedSize)
+  {
+    block.freeRanges[bestOffset + alignedSize] = bestSize - alignedSize;
+  }
+  m_allocatedSize += alignedSize;
+
+  return {.block = bestBlock, .offset = bestOffset, .size = alignedSize, .address = block.buffer.address + bestOffset};
+}
+
+nvsamples::GeometryArena::Allocation nvsamples::GeometryArena::allocateBlock(VkDeviceSize size)
+{
+  assert(isInitialized());
+  const VkDeviceSize alignedSize = std::max((size + kAlignment - 1) & ~(kAlignment - 1), kAlignment);
+
+  // The block has no free range, allocate() only picks it once the allocation is freed
+  Block block;
+  NVVK_CHECK(m_allocator->createBuffer(block.buffer, alignedSize, m_usage));
+  NVVK_DBG_NAME(block.buffer.buffer);
+  m_allocatedSize += alignedSize;
+  m_blocks.push_back(std::move(block));
+
+  const uint32_t blockIndex = uint32_t(m_blocks.size() - 1);
+  return {.block = blockIndex, .offset = 0, .size = alignedSize, .address = m_blocks[blockIndex].buffer.address};
+}
+
+void nvsamples::GeometryArena::free(const Allocation& allocation)
+{
+  if(allocation.block >= m_blocks.size())
+    return;
+
+  auto&        freeRanges = m_blocks[allocation.block].freeRanges;
+  VkDeviceSize offset     = allocation.offset;
+  VkDeviceSize size       = allocation.size;
+  m_allocatedSize -= allocation.size;
+
+  // Merge with the following and the preceding free ranges
+  auto next = freeRanges.lower_bound(offset);
+  assert(next == freeRanges.end() || next->first >= offset + size);
+  if(next != freeRanges.end() && next->first == offset + size)
+  {
+    size += next->second;
+    next = freeRanges.erase(next);
+  }
+  if(next != freeRanges.begin())
+  {
+    auto prev = std::prev(next);
+    if(prev->first + prev->second == offset)
+    {
+      offset = prev->first;
+      size += prev->second;
+      freeRanges.erase(prev);
+    }
+  }
+  freeRanges[offset] = size;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include <nvvk/resource_allocator.hpp>
+#include <nvvk/resources.hpp>
+
+namespace nvsamples {
+
+//--------------------------------------------------------------------------------------------------
+// Arena holding the geometry of the scene: a few large device buffers (blocks), suballocated for each mesh or scene.
+//
+// By default each block is usable as vertex, index and storage buffer, as acceleration structure build input and as
+// copy source (read back by the CPU ray tracer). On a device without the acceleration structure extension, the usage
+// given to init() must leave out the build input bit. The suballocations are aligned to kAlignment, and the freed
+// ranges are merged with their neighbors and reused by the next allocations. A request larger than the block size gets
+// a block of its own.
+//
+class GeometryArena
+{
+public:
+  // Enough for any vertex, index or transform data read by the acceleration structure builds
+  static constexpr VkDeviceSize kAlignment = 16;
+
+  static constexpr VkBufferUsageFlags2 kDefaultUsage =
+      VK_BUFFER_USAGE_2_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_2_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT
+      | VK_BUFFER_USAGE_2_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_2_TRANSFER_SRC_BIT;
+
+  struct Allocation
+  {
+    uint32_t        block   = ~0U;  // Index of the block, see getBuffer()
+    VkDeviceSize    offset  = 0;    // Offset in the block
+    VkDeviceSize    size    = 0;
+    VkDeviceAddress address = 0;  // Device address of the allocation
+  };
+
+  void init(nvvk::ResourceAllocator* allocator,
+            VkBufferUsageFlags2      usage     = kDefaultUsage,
+            VkDeviceSize             blockSize = VkDeviceSize(128) << 20);
+  void deinit();
+  bool isInitialized() const { return m_allocator != nullptr; }
+
+  Allocation allocate(VkDeviceSize size);
+  // Allocation in a block of its own, never shared with other allocations: for the data written by another queue family
+  // (see AsyncUploader), as the queue family ownership of a buffer applies to the whole buffer
+  Allocation allocateBlock(VkDeviceSize size);
+  // Returns the range to the arena, the caller must make sure the GPU no longer uses it
+  void free(const Allocation& allocation);
+
+  const nvvk::Buffer& getBuffer(uint32_t block) const { return m_blocks[block].buffer; }
+  uint32_t            getBlockCount() const { return uint32_t(m_blocks.size()); }
+  VkDeviceSize        getAllocatedSize() const { return m_allocatedSize; }
+
+private:
+  struct Block
+  {
+    nvvk::Buffer                         buffer;
+    std::map<VkDeviceSize, VkDeviceSize> freeRanges;  // Offset -> size of the unused ranges
+  };
+
+  nvvk::ResourceAllocator* m_allocator{};
+  VkBufferUsageFlags2      m_usage         = 0;
+  VkDeviceSize             m_blockSize     = 0;
+  VkDeviceSize             m_allocatedSize = 0;
+  std::vector<Block>       m_blocks;
+};
+
+}  // namespace nvsamples
@@ -0,0 +1,365 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "gltf_cache.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <span>
+
+#include <fmt/format.h>
+
+#include "nvutils/file_mapping.hpp"
+#include "nvutils/logger.hpp"
+#include "nvutils/parallel_work.hpp"
+#include "nvutils/timers.hpp"
+#include "nvvk/check_error.hpp"
+#include "nvvk/debug_util.hpp"
+
+#include "utils.hpp"
+
+namespace {
+
+// Layout of a cache file:
+// - SceneCacheHeader
+// - GltfMesh[numMeshes], with gltfBuffer set to null
+// - uint64_t[numMeshes], hash of the geometry of each mesh (see GltfSceneResource::meshHashes)
+// - PrimitiveRange[numRanges], relative to the first mesh of the file
+// - GltfInstance[numInstances], with meshIndex relative to the first mesh of the file
+// - GltfMetallicRoughness[numMaterials]
+// - packed geometry (blobSize bytes), at blobOffset
+struct SceneCacheHeader
+{
+  uint32_t magic           = 0;
+  uint32_t formatVersion   = 0;
+  uint32_t importerVersion = 0;
+  uint32_t importFlags     = 0;
+  uint64_t sourceHash      = 0;
+  uint64_t blobOffset      = 0;
+  uint64_t blobSize        = 0;
+  uint32_t numMeshes       = 0;
+  uint32_t numRanges       = 0;
+  uint32_t numInstances    = 0;
+  uint32_t numMaterials    = 0;
+};
+
+constexpr uint32_t     kSceneCacheMagic         = 0x48435352;  // "RSCH"
+constexpr uint32_t     kSceneCacheFormatVersion = 2;
+constexpr uint32_t     kImportInstanceFlag      = 1 << 0;
+constexpr uint32_t     kQuantizeVerticesFlag    = 1 << 1;
+constexpr uint32_t     kOptimizeMeshesFlag      = 1 << 2;
+constexpr VkDeviceSize kBlobAlignment           = 16;
+constexpr VkDeviceSize kBlobStreamingChunk      = VkDeviceSize(4) << 20;
+
+// Copy of the record `index` of the array at `offset` in the file, the records may not be aligned in the mapping
+template <typename T>
+T readRecord(const uint8_t* data, size_t offset, uint32_t index)
+{
+  T record;
+  std::memcpy(&record, data + offset + size_t(index) * sizeof(T), sizeof(T));
+  return record;
+}
+
+// The hash of the full path keeps apart the scenes having the same name in different directories
+std::filesystem::path getCacheFilename(const std::filesystem::path& filename, const std::filesystem::path& cacheDirectory)
+{
+  std::error_code   ec;
+  const std::string path     = nvutils::utf8FromPath(std::filesystem::weakly_canonical(filename, ec));
+  const uint64_t    pathHash = nvsamples::hashBytes({reinterpret_cast<const uint8_t*>(path.data()), path.size()});
+  return cacheDirectory / fmt::format("{}_{:016x}.scenecache", nvutils::utf8FromPath(filename.stem()), pathHash);
+}
+
+// Appends the content of a valid cache file to the scene
+bool loadSceneCache(nvsamples::GltfSceneResource& sceneResource,
+                    const std::filesystem::path&  cacheFilename,
+                    const SceneCacheHeader&       expected,
+                    nvvk::StagingUploader&        stagingUploader,
+                    nvsamples::AsyncUploader*     asyncUploader,
+                    bool                          deduplicateMeshes)
+{
+  nvutils::FileReadMapping mapping;
+  if(!mapping.open(cacheFilename) || mapping.size() < sizeof(SceneCacheHeader))
+  {
+    return false;
+  }
+
+  const uint8_t*   data = static_cast<const uint8_t*>(mapping.data());
+  SceneCacheHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  if(header.magic != expected.magic || header.formatVersion != expected.formatVersion
+     || header.importerVersion != expected.importerVersion || header.importFlags != expected.importFlags
+     || header.sourceHash != expected.sourceHash || header.blobOffset > mapping.size()
+     || header.blobSize > mapping.size() - header.blobOffset)
+  {
+    return false;
+  }
+
+  // A truncated or corrupted file can have a valid header: the records must fit before the packed geometry
+  const uint64_t recordsSize = sizeof(SceneCacheHeader)
+                               + uint64_t(header.numMeshes) * (sizeof(shaderio::GltfMesh) + sizeof(uint64_t))
+                               + uint64_t(header.numRanges) * sizeof(nvsamples::PrimitiveRange)
+                               + uint64_t(header.numInstances) * sizeof(shaderio::GltfInstance)
+                               + uint64_t(header.numMaterials) * sizeof(shaderio::GltfMetallicRoughness);
+  bool valid = recordsSize <= header.blobOffset;
+
+  // Nothing referenced by the records may be out of the meshes or of the packed geometry, as the geometry is read on
+  // the host for the registration and on the device by the shaders and the BLAS builds
+  const size_t meshesOffset    = sizeof(SceneCacheHeader);
+  const size_t hashesOffset    = meshesOffset + size_t(header.numMeshes) * sizeof(shaderio::GltfMesh);
+  const size_t rangesOffset    = hashesOffset + size_t(header.numMeshes) * sizeof(uint64_t);
+  const size_t instancesOffset = rangesOffset + size_t(header.numRanges) * sizeof(nvsamples::PrimitiveRange);
+  for(uint32_t i = 0; i < header.numMeshes && valid; i++)
+  {
+    valid = nvsamples::isMeshInBuffer(readRecord<shaderio::GltfMesh>(data, meshesOffset, i), header.blobSize);
+  }
+  for(uint32_t i = 0; i < header.numRanges && valid; i++)
+  {
+    const nvsamples::PrimitiveRange range = readRecord<nvsamples::PrimitiveRange>(data, rangesOffset, i);
+    valid                                 = uint64_t(range.first) + range.count <= header.numMeshes;
+  }
+  for(uint32_t i = 0; i < header.numInstances && valid; i++)
+  {
+    valid = readRecord<shaderio::GltfInstance>(data, instancesOffset, i).meshIndex < header.numMeshes;
+  }
+  if(!valid)
+  {
+    LOGW("Invalid scene cache: %s\n", nvutils::utf8FromPath(cacheFilename).c_str());
+    return false;
+  }
+
+  const uint32_t meshOffset = uint32_t(sceneResource.meshes.size());
+  size_t         offset     = sizeof(SceneCacheHeader);
+  auto           readArray  = [&]<typename T>(std::vector<T>& dst, uint32_t count) {
+    const size_t first = dst.size();
+    dst.resize(first + count);
+    std::memcpy(dst.data() + first, data + offset, count * sizeof(T));
+    offset += count * sizeof(T);
+    return std::span<T>(dst.data() + first, count);
+  };
+
+  // Geometry, streamed from the mapping to a range of the geometry arena (a block of its own for the transfer queue)
+  const nvsamples::GeometryArena::Allocation allocation = nvsamples::allocateGeometry(
+      sceneResource, stagingUploader.getResourceAllocator(), header.blobSize, asyncUploader != nullptr);
+  const nvvk::Buffer& bGltfData = sceneResource.geometryArena.getBuffer(allocation.block);
+  if(header.blobSize > 0 && asyncUploader)
+  {
+    // Worker threads page in the mapping while the transfer queue copies the chunks already in the staging ring
+    const uint64_t numChunks = (header.blobSize + kBlobStreamingChunk - 1) / kBlobStreamingChunk;
+    nvutils::parallel_batches<1>(numChunks, [&](uint64_t i) {
+      const VkDeviceSize chunkOffset = i * kBlobStreamingChunk;
+      const VkDeviceSize chunkSize   = std::min(kBlobStreamingChunk, header.blobSize - chunkOffset);
+      asyncUploader->appendBuffer(bGltfData, allocation.offset + chunkOffset,
+                                  std::span<const uint8_t>(data + header.blobOffset + chunkOffset, size_t(chunkSize)));
+    });
+  }
+  else if(header.blobSize > 0)
+  {
+    NVVK_CHECK(stagingUploader.appendBuffer(bGltfData, allocation.offset, std::span<const uint8_t>(data + header.blobOffset, header.blobSize)));
+  }
+
+  // Records, relocated to the scene
+  for(shaderio::GltfMesh& mesh : readArray(sceneResource.meshes, header.numMeshes))
+  {
+    mesh.gltfBuffer = (uint8_t*)allocation.address;
+    sceneResource.meshToBufferIndex.push_back(allocation.block);
+  }
+  std::vector<uint64_t> meshHashes;
+  readArray(meshHashes, header.numMeshes);
+  for(nvsamples::PrimitiveRange& range : readArray(sceneResource.meshPrimitiveRanges, header.numRanges))
+  {
+    range.first += meshOffset;
+  }
+  for(shaderio::GltfInstance& instance : readArray(sceneResource.instances, header.numInstances))
+  {
+    instance.meshIndex += meshOffset;
+  }
+  readArray(sceneResource.materials, header.numMaterials);
+
+  // The cache holds the meshes before deduplication and their hashes: the geometry is only read for the comparison of
+  // the meshes with the same hash
+  nvsamples::registerMeshGeometries(sceneResource, meshOffset, std::span<const uint8_t>(data + header.blobOffset, header.blobSize),
+                                    deduplicateMeshes, meshHashes);
+
+  return true;
+}
+
+// Writes the records appended by the import (starting at the `first*` indices) and the packed geometry
+void saveSceneCache(const nvsamples::GltfSceneResource&  sceneResource,
+                    const std::filesystem::path&         cacheFilename,
+                    SceneCacheHeader                     header,
+                    uint32_t                             firstMesh,
+                    uint32_t                             firstRange,
+                    uint32_t                             firstInstance,
+                    uint32_t                             firstMaterial,
+                    const nvsamples::GltfPackedGeometry& packedGeometry)
+{
+  header.numMeshes    = uint32_t(sceneResource.meshes.size()) - firstMesh;
+  header.numRanges    = uint32_t(sceneResource.meshPrimitiveRanges.size()) - firstRange;
+  header.numInstances = uint32_t(sceneResource.instances.size()) - firstInstance;
+  header.numMaterials = uint32_t(sceneResource.materials.size()) - firstMaterial;
+
+  std::vector<shaderio::GltfMesh> meshes(sceneResource.meshes.begin() + firstMesh, sceneResource.meshes.end());
+  for(shaderio::GltfMesh& mesh : meshes)
+  {
+    mesh.gltfBuffer = nullptr;
+  }
+  std::span<const uint64_t> meshHashes(sceneResource.meshHashes.data() + firstMesh, header.numMeshes);
+  std::vector<nvsamples::PrimitiveRange> ranges(sceneResource.meshPrimitiveRanges.begin() + firstRange,
+                                                sceneResource.meshPrimitiveRanges.end());
+  for(nvsamples::PrimitiveRange& range : ranges)
+  {
+    range.first -= firstMesh;
+  }
+  std::vector<shaderio::GltfInstance> instances(sceneResource.instances.begin() + firstInstance, sceneResource.instances.end());
+  for(shaderio::GltfInstance& instance : instances)
+  {
+    instance.meshIndex -= firstMesh;
+  }
+  std::span<const shaderio::GltfMetallicRoughness> materials(sceneResource.materials.data() + firstMaterial, header.numMaterials);
+
+  const size_t recordsSize = sizeof(SceneCacheHeader) + std::span(meshes).size_bytes() + meshHashes.size_bytes()
+                             + std::span(ranges).size_bytes() + std::span(instances).size_bytes()
+                             + materials.size_bytes();
+  header.blobOffset = (recordsSize + kBlobAlignment - 1) & ~(kBlobAlignment - 1);
+  header.blobSize   = packedGeometry.size();
+
+  // Write to a temporary file first, so that concurrent processes never see a partial cache
+  std::error_code             ec;
+  const std::filesystem::path tempFilename = nvsamples::getTempFilename(cacheFilename);
+  std::filesystem::create_directories(cacheFilename.parent_path(), ec);
+  {
+    std::ofstream file(tempFilename, std::ios::binary | std::ios::trunc);
+    if(!file)
+    {
+      LOGW("Could not write the scene cache: %s\n", nvutils::utf8FromPath(tempFilename).c_str());
+      return;
+    }
+    auto write = [&](const void* data, size_t size) { file.write(static_cast<const char*>(data), std::streamsize(size)); };
+    write(&header, sizeof(header));
+    write(meshes.data(), std::span(meshes).size_bytes());
+    write(meshHashes.data(), meshHashes.size_bytes());
+    write(ranges.data(), std::span(ranges).size_bytes());
+    write(instances.data(), std::span(instances).size_bytes());
+    write(materials.data(), materials.size_bytes());
+    const uint8_t padding[kBlobAlignment]{};
+    write(padding, header.blobOffset - recordsSize);
+
+    // The packed geometry is written from its pieces, the glTF buffers and the converted data, padded to their offsets
+    VkDeviceSize blobWritten = 0;
+    auto         writeBlob   = [&](VkDeviceSize offset, std::span<const uint8_t> piece) {
+      write(padding, offset - blobWritten);
+      write(piece.data(), piece.size());
+      blobWritten = offset + piece.size();
+    };
+    for(size_t i = 0; i < packedGeometry.buffers.size(); i++)
+    {
+      writeBlob(packedGeometry.bufferOffsets[i], packedGeometry.buffers[i]);
+    }
+    writeBlob(packedGeometry.convertedBase, packedGeometry.convertedData);
+    if(!file)
+    {
+      LOGW("Could not write the scene cache: %s\n", nvutils::utf8FromPath(tempFilename).c_str());
+      return;
+    }
+  }
+  std::filesystem::rename(tempFilename, cacheFilename, ec);
+  if(ec)
+  {
+    std::filesystem::remove(tempFilename, ec);
+  }
+}
+
+}  // namespace
+
+
+bool nvsamples::importGltfCached(GltfSceneResource&           sceneResource,
+                                 const std::filesystem::path& filename,
+                                 const std::filesystem::path& cacheDirectory,
+                                 nvvk::StagingUploader&       stagingUploader,
+                                 bool                         importInstance /*= false*/,
+                                 const GltfImportOptions&     options /*= {}*/,
+                                 AsyncUploader*               asyncUploader /*= nullptr*/)
+{
+  nvutils::ScopedTimer _st(__FUNCTION__);
+
+  SceneCacheHeader header{
+      .magic           = kSceneCacheMagic,
+      .formatVersion   = kSceneCacheFormatVersion,
+      .importerVersion = kGltfImporterVersion,
+      .importFlags     = (importInstance ? kImportInstanceFlag : 0) | (options.quantizeVertices ? kQuantizeVerticesFlag : 0)
+                     | (options.optimizeMeshes ? kOptimizeMeshesFlag : 0),
+  };
+  if(!hashFile(filename, header.sourceHash))
+  {
+    LOGE("Error reading glTF file: %s\n", nvutils::utf8FromPath(filename).c_str());
+    return false;
+  }
+
+  const std::filesystem::path cacheFilename = getCacheFilename(filename, cacheDirectory);
+  if(loadSceneCache(sceneResource, cacheFilename, header, stagingUploader, asyncUploader, options.deduplicateMeshes))
+  {
+    LOGI("%s", fmt::format("\n{}Loaded scene cache: {}", _st.indent(), nvutils::utf8FromPath(cacheFilename)).c_str());
+    return true;
+  }
+
+  // Cache miss: regular import, keeping a copy of the packed geometry to write the cache
+  const uint32_t firstMesh     = uint32_t(sceneResource.meshes.size());
+  const uint32_t firstRange    = uint32_t(sceneResource.meshPrimitiveRanges.size());
+  const uint32_t firstInstance = uint32_t(sceneResource.instances.size());
+  const uint32_t firstMaterial = uint32_t(sceneResource.materials.size());
+
+  GltfMappedModel mappedModel;
+  if(filename.extension() == ".glb")
+  {
+    if(!loadGltfMapped(filename, mappedModel))
+      return false;
+  }
+  else
+  {
+    mappedModel.model = loadGltfResources(filename);
+  }
+
+  std::vector<std::span<const uint8_t>> buffersData;
+  for(const tinygltf::Buffer& buffer : mappedModel.model.buffers)
+  {
+    buffersData.emplace_back(buffer.data);
+  }
+  if(!buffersData.empty() && !mappedModel.binChunk.empty())
+  {
+    buffersData[0] = mappedModel.binChunk;
+  }
+
+  GltfPackedGeometry   packedGeometry;
+  GltfImportOptions    importOptions = options;
+  importOptions.deduplicateMeshes    = false;  // Done after saving, see loadSceneCache
+  if(!importGltfData(sceneResource, mappedModel.model, buffersData, &stagingUploader, importInstance, importOptions,
+                     &packedGeometry, asyncUploader))
+  {
+    return false;
+  }
+  saveSceneCache(sceneResource, cacheFilename, header, firstMesh, firstRange, firstInstance, firstMaterial, packedGeometry);
+  if(options.deduplicateMeshes)
+  {
+    registerMeshGeometries(sceneResource, firstMesh, packedGeometry, true);
+  }
+
+  LOGI("%s", fmt::format("\n{}Created scene cache: {}", _st.indent(), nvutils::utf8FromPath(cacheFilename)).c_str());
+  return true;
+}
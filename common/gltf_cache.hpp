@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <filesystem>
+
+#include "async_uploader.hpp"
+#include "gltf_utils.hpp"
+
+namespace nvsamples {
+
+// Imports a glTF file through a preprocessed binary cache stored in `cacheDirectory`.
+// The cache file holds the packed geometry and the shaderio records (GltfMesh, GltfInstance, GltfMetallicRoughness)
+// produced by importGltfData, and is keyed by the hash of the source file and kGltfImporterVersion.
+// - Cache hit: tinygltf is skipped, the records are appended to the scene and the geometry is streamed from the cache mapping.
+// - Cache miss: the glTF is imported normally and the cache file is (re)written.
+// With `asyncUploader`, the geometry is streamed on the transfer queue through its bounded staging ring instead of the
+// staging uploader: the caller flushes it and acquires the buffers before using them, see AsyncUploader.
+// Returns false if the scene could not be imported.
+bool importGltfCached(GltfSceneResource&           sceneResource,
+                      const std::filesystem::path& filename,
+                      const std::filesystem::path& cacheDirectory,
+                      nvvk::StagingUploader&       stagingUploader,
+                      bool                         importInstance = false,
+                      const GltfImportOptions&     options        = {},
+                      AsyncUploader*               asyncUploader  = nullptr);
+
+}  // namespace nvsamples
@@ -22,16 +22,237 @@
 #include <span>
 #include <algorithm>
 #include <functional>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
 
 #include <glm/gtc/type_ptr.hpp>  // glm::make_vec3
 #include <vulkan/vulkan_core.h>
 #include <fmt/format.h>
 
 #include "nvutils/timers.hpp"
+#include "nvutils/parallel_work.hpp"
 #include "nvutils/logger.hpp"
 #include "nvvk/check_error.hpp"
 #include "nvvk/debug_util.hpp"
+#include "tinygltf/json.hpp"
 
+#include "async_uploader.hpp"
+#include "mesh_optimizer.hpp"
+#include "utils.hpp"
+#include "vertex_quantization.hpp"
+
+
+// Calls `fn(view, elementSize, stride)` for each view of the mesh, with the size of its elements in the buffer
+static void forEachMeshView(const shaderio::GltfMesh&                                                   mesh,
+                            const std::function<void(const shaderio::BufferView&, uint32_t, uint32_t)>& fn)
+{
+  auto visit = [&](const shaderio::BufferView& view, uint32_t floatSize, uint32_t quantizedSize) {
+    const uint32_t stride = view.byteStride ? view.byteStride : floatSize;
+    fn(view, std::min(view.format == shaderio::eVertexFormatFloat32 ? floatSize : quantizedSize, stride), stride);
+  };
+  const uint32_t indexSize = mesh.indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4;
+  visit(mesh.triMesh.indices, indexSize, indexSize);
+  visit(mesh.triMesh.positions, 3 * sizeof(float), sizeof(nvsamples::QuantizedPosition));
+  visit(mesh.triMesh.normals, 3 * sizeof(float), sizeof(nvsamples::QuantizedDirection));
+  visit(mesh.triMesh.colorVert, 4 * sizeof(float), 4 * sizeof(float));
+  visit(mesh.triMesh.texCoords, 2 * sizeof(float), sizeof(nvsamples::QuantizedTexCoord));
+  visit(mesh.triMesh.tangents, 4 * sizeof(float), sizeof(nvsamples::QuantizedDirection));
+}
+
+// Content of the geometry of a mesh, as compared by the deduplication: the elements of its views, their format, and
+// the dequantization. The views may be interleaved, only the bytes of the elements are kept.
+// `getData(offset)` returns the host copy of the mesh buffer at `offset`.
+static std::vector<uint8_t> getMeshGeometryContent(const shaderio::GltfMesh&                      mesh,
+                                                   const std::function<const uint8_t*(uint32_t)>& getData)
+{
+  std::vector<uint8_t> content;
+  auto                 append = [&](const void* data, size_t size) {
+    content.insert(content.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+  };
+  const float header[] = {float(mesh.indexType), mesh.dequantScale.x,  mesh.dequantScale.y, mesh.dequantScale.z,
+                          mesh.dequantOffset.x,  mesh.dequantOffset.y, mesh.dequantOffset.z};
+  append(header, sizeof(header));
+
+  forEachMeshView(mesh, [&](const shaderio::BufferView& view, uint32_t elementSize, uint32_t stride) {
+    if(view.offset == ~0U || view.count == 0)
+    {
+      const uint32_t emptyView[] = {0, 0};
+      append(emptyView, sizeof(emptyView));
+      return;
+    }
+    const uint8_t* data         = getData(view.offset);
+    const uint32_t viewHeader[] = {view.count, view.format + 1};
+    append(viewHeader, sizeof(viewHeader));
+    if(stride == elementSize)
+    {
+      append(data, size_t(view.count) * elementSize);
+      return;
+    }
+    for(size_t i = 0; i < view.count; i++)
+      append(data + i * stride, elementSize);
+  });
+  return content;
+}
+
+bool nvsamples::isMeshInBuffer(const shaderio::GltfMesh& mesh, VkDeviceSize bufferSize)
+{
+  if(mesh.indexType != VK_INDEX_TYPE_UINT16 && mesh.indexType != VK_INDEX_TYPE_UINT32)
+    return false;
+  bool inBuffer = true;
+  forEachMeshView(mesh, [&](const shaderio::BufferView& view, uint32_t elementSize, uint32_t stride) {
+    if(view.offset == ~0U || view.count == 0)
+      return;
+    const uint64_t end = uint64_t(view.offset) + uint64_t(view.count - 1) * stride + elementSize;
+    inBuffer           = inBuffer && view.format <= shaderio::eVertexFormatFloat16 && end <= bufferSize;
+  });
+  if(mesh.triMesh.positions.format == shaderio::eVertexFormatSnorm16)
+  {
+    inBuffer = inBuffer && uint64_t(mesh.dequantTransform) + sizeof(VkTransformMatrixKHR) <= bufferSize;
+  }
+  return inBuffer && mesh.triMesh.indices.offset != ~0U && mesh.triMesh.positions.offset != ~0U;
+}
+
+// Registration of the meshes [firstMesh, meshes.size()), see nvsamples::registerMeshGeometries.
+// Without `deduplicate`, each mesh only gets the hash of its geometry and stays its own geometry.
+// With it, a mesh whose hash matches a mesh of the same range is compared byte for byte with it through `getData`: on a
+// collision, or when the matching mesh is from another range whose data is no longer on the host, the geometry takes
+// the next free key, so that the key of each distinct deduplicated geometry is unique (the BLAS cache and profile rely
+// on it). The contents are only extracted for these comparisons, and released at the end of the registration.
+static uint32_t registerMeshGeometryRange(nvsamples::GltfSceneResource&                  sceneResource,
+                                          uint32_t                                       firstMesh,
+                                          const std::function<const uint8_t*(uint32_t)>& getData,
+                                          bool                                           deduplicate,
+                                          std::span<const uint64_t>                      hashes)
+{
+  // Meshes added without going through the registration are their own geometry, not hashed
+  while(sceneResource.meshAliases.size() < firstMesh)
+  {
+    sceneResource.meshHashes.push_back(0);
+    sceneResource.meshAliases.push_back(uint32_t(sceneResource.meshAliases.size()));
+  }
+
+  // Meshes already registered without deduplication are registered again, with the hashes computed the first time
+  std::vector<uint64_t> knownHashes(hashes.begin(), hashes.end());
+  if(firstMesh < sceneResource.meshAliases.size())
+  {
+    for(uint32_t i = firstMesh; i < uint32_t(sceneResource.meshAliases.size()); i++)
+    {
+      assert(sceneResource.meshAliases[i] == i);
+    }
+    if(knownHashes.empty())
+    {
+      knownHashes.assign(sceneResource.meshHashes.begin() + firstMesh, sceneResource.meshHashes.end());
+    }
+    sceneResource.meshHashes.resize(firstMesh);
+    sceneResource.meshAliases.resize(firstMesh);
+  }
+
+  // Contents of the meshes of the range, extracted on demand for the hash and the comparisons
+  std::unordered_map<uint32_t, std::vector<uint8_t>> contents;
+
+  auto getContent = [&](uint32_t meshIndex) -> const std::vector<uint8_t>& {
+    auto [it, inserted] = contents.try_emplace(meshIndex);
+    if(inserted)
+      it->second = getMeshGeometryContent(sceneResource.meshes[meshIndex], getData);
+    return it->second;
+  };
+
+  uint32_t numAliased = 0;
+  for(uint32_t i = firstMesh; i < uint32_t(sceneResource.meshes.size()); i++)
+  {
+    const uint32_t rangeIndex = i - firstMesh;
+    uint64_t       hash       = rangeIndex < knownHashes.size() ? knownHashes[rangeIndex] : 0;
+    if(hash == 0)
+    {
+      hash = nvsamples::hashBytes(getContent(i));
+    }
+
+    uint32_t geometryMesh = i;
+    uint64_t key          = hash;
+    for(;; key++)
+    {
+      if(key == 0)
+        continue;  // Meshes not hashed
+      if(!deduplicate)
+        break;
+      const auto [it, inserted] = sceneResource.geometryMeshes.try_emplace(key, i);
+      if(inserted)
+        break;
+      if(it->second >= firstMesh && getContent(it->second) == getContent(i))
+      {
+        geometryMesh = it->second;
+        break;
+      }
+    }
+    sceneResource.meshHashes.push_back(key);
+    sceneResource.meshAliases.push_back(geometryMesh);
+    contents.erase(i);  // Extracted again if a later mesh matches it, only the matched contents are kept
+
+    if(geometryMesh != i)
+    {
+      // The alias keeps its entry, but refers to the geometry of the first mesh
+      sceneResource.meshes[i]            = sceneResource.meshes[geometryMesh];
+      sceneResource.meshToBufferIndex[i] = sceneResource.meshToBufferIndex[geometryMesh];
+      numAliased++;
+    }
+  }
+
+  if(numAliased > 0)
+  {
+    // Only the new instances can refer to the new meshes
+    for(shaderio::GltfInstance& instance : sceneResource.instances)
+    {
+      if(instance.meshIndex >= firstMesh)
+        instance.meshIndex = sceneResource.getGeometryMesh(instance.meshIndex);
+    }
+    LOGI("Aliased %u meshes with the geometry of other meshes\n", numAliased);
+  }
+  return numAliased;
+}
+
+nvsamples::GeometryArena::Allocation nvsamples::allocateGeometry(GltfSceneResource&       sceneResource,
+                                                                 nvvk::ResourceAllocator* allocator,
+                                                                 VkDeviceSize             size,
+                                                                 bool                     ownBlock /*= false*/)
+{
+  if(!sceneResource.geometryArena.isInitialized())
+  {
+    sceneResource.geometryArena.init(allocator);
+  }
+  const GeometryArena::Allocation allocation =
+      ownBlock ? sceneResource.geometryArena.allocateBlock(size) : sceneResource.geometryArena.allocate(size);
+  sceneResource.geometryAllocations.push_back(allocation);
+  return allocation;
+}
+
+const uint8_t* nvsamples::GltfPackedGeometry::getData(VkDeviceSize offset) const
+{
+  if(offset >= convertedBase || buffers.empty())
+    return convertedData.data() + (offset - convertedBase);
+  const size_t i = std::upper_bound(bufferOffsets.begin(), bufferOffsets.end(), offset) - bufferOffsets.begin() - 1;
+  return buffers[i].data() + (offset - bufferOffsets[i]);
+}
+
+uint32_t nvsamples::registerMeshGeometries(GltfSceneResource&        sceneResource,
+                                          uint32_t                  firstMesh,
+                                          const GltfPackedGeometry& packedGeometry,
+                                          bool                      deduplicate)
+{
+  return registerMeshGeometryRange(
+      sceneResource, firstMesh, [&](uint32_t offset) { return packedGeometry.getData(VkDeviceSize(offset)); },
+      deduplicate, {});
+}
+
+uint32_t nvsamples::registerMeshGeometries(GltfSceneResource&        sceneResource,
+                                          uint32_t                  firstMesh,
+                                          std::span<const uint8_t>  hostData,
+                                          bool                      deduplicate,
+                                          std::span<const uint64_t> hashes /*= {}*/)
+{
+  return registerMeshGeometryRange(
+      sceneResource, firstMesh, [&](uint32_t offset) { return hostData.data() + offset; }, deduplicate, hashes);
+}
 
 // This is a utility function to convert a primitive mesh to a GltfMeshResource.
 void nvsamples::primitiveMeshToResource(GltfSceneResource&            sceneResource,
@@ -41,26 +262,25 @@ void nvsamples::primitiveMeshToResource(GltfSceneResource&            sceneResou
 
   nvvk::ResourceAllocator* allocator = stagingUploader.getResourceAllocator();
 
+  // Indices are narrowed to 16 bits when possible, the triangle order is kept as callers may rely on it
+  const bool            useUint16 = primMesh.vertices.size() <= kMaxUint16IndexedVertices;
+  std::vector<uint16_t> indices16;
+  if(useUint16)
+  {
+    indices16.reserve(primMesh.triangles.size() * 3);
+    for(const auto& triangle : primMesh.triangles)
+    {
+      indices16.insert(indices16.end(), {uint16_t(triangle.indices.x), uint16_t(triangle.indices.y), uint16_t(triangle.indices.z)});
+    }
+  }
+
   // Calculate buffer sizes
   size_t verticesSize  = std::span(primMesh.vertices).size_bytes();
-  size_t trianglesSize = std::span(primMesh.triangles).size_bytes();
-
-  // Create buffer for the geometry data (vertices + triangles)
-  nvvk::Buffer gltfData;
-  allocator->createBuffer(gltfData, verticesSize + trianglesSize,
-                          VK_BUFFER_USAGE_2_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_2_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT
-                              | VK_BUFFER_USAGE_2_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR);
-  uint32_t bufferIndex = static_cast<uint32_t>(sceneResource.bGltfDatas.size());
-  sceneResource.bGltfDatas.push_back(gltfData);
-
-  // Upload vertices first (at offset 0)
-  stagingUploader.appendBuffer(gltfData, 0, std::span(primMesh.vertices));
-
-  // Upload triangles after vertices
-  stagingUploader.appendBuffer(gltfData, verticesSize, std::span(primMesh.triangles));
+  size_t trianglesSize = useUint16 ? std::span(indices16).size_bytes() : std::span(primMesh.triangles).size_bytes();
 
   // Set up the TriangleMesh structure with proper BufferView offsets
-  shaderio::GltfMesh mesh;
+  shaderio::GltfMesh mesh{};
+  mesh.dequantScale = glm::vec3(1.0f);
   mesh.triMesh.positions = {.offset     = 0,
                             .count      = static_cast<uint32_t>(primMesh.vertices.size()),
                             .byteStride = sizeof(nvutils::PrimitiveVertex)};
@@ -75,16 +295,41 @@ void nvsamples::primitiveMeshToResource(GltfSceneResource&            sceneResou
 
   mesh.triMesh.indices = {.offset     = static_cast<uint32_t>(verticesSize),
                           .count      = static_cast<uint32_t>(primMesh.triangles.size() * 3),  // 3 indices per triangle
-                          .byteStride = sizeof(uint32_t)};
-  mesh.indexType       = VK_INDEX_TYPE_UINT32;  // Assuming uint32_t indices
+                          .byteStride = useUint16 ? uint32_t(sizeof(uint16_t)) : uint32_t(sizeof(uint32_t))};
+  mesh.indexType       = useUint16 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+
+  // A primitive mesh is a glTF mesh with a single primitive
+  const uint32_t meshIndex = uint32_t(sceneResource.meshes.size());
+  sceneResource.meshPrimitiveRanges.push_back({.first = meshIndex, .count = 1});
+
+  // Range of the geometry arena for the geometry data (vertices + triangles)
+  const GeometryArena::Allocation allocation = allocateGeometry(sceneResource, allocator, verticesSize + trianglesSize);
+  const nvvk::Buffer&             gltfData   = sceneResource.geometryArena.getBuffer(allocation.block);
+
+  // Upload vertices first (at the start of the range)
+  stagingUploader.appendBuffer(gltfData, allocation.offset, std::span(primMesh.vertices));
+
+  // Upload triangles after vertices
+  if(useUint16)
+    stagingUploader.appendBuffer(gltfData, allocation.offset + verticesSize, std::span(indices16));
+  else
+    stagingUploader.appendBuffer(gltfData, allocation.offset + verticesSize, std::span(primMesh.triangles));
 
-  // Set the buffer address and index type
-  mesh.gltfBuffer = (uint8_t*)gltfData.address;
-  mesh.indexType  = VK_INDEX_TYPE_UINT32;  // Assuming uint32_t indices
+  // Set the buffer address
+  mesh.gltfBuffer = (uint8_t*)allocation.address;
   sceneResource.meshes.push_back(mesh);
 
   // Update the mapping from mesh index to buffer index
-  sceneResource.meshToBufferIndex.push_back(bufferIndex);
+  sceneResource.meshToBufferIndex.push_back(allocation.block);
+
+  // Hash of the geometry, for the BLAS cache and profile
+  const uint8_t* vertexData = reinterpret_cast<const uint8_t*>(primMesh.vertices.data());
+  const uint8_t* indexData  = useUint16 ? reinterpret_cast<const uint8_t*>(indices16.data()) :
+                                          reinterpret_cast<const uint8_t*>(primMesh.triangles.data());
+  registerMeshGeometryRange(
+      sceneResource, meshIndex,
+      [&](uint32_t offset) { return offset < verticesSize ? vertexData + offset : indexData + (offset - verticesSize); },
+      false, {});
 }
 
 tinygltf::Model nvsamples::loadGltfResources(const std::filesystem::path& filename)
@@ -122,22 +367,346 @@ tinygltf::Model nvsamples::loadGltfResources(const std::filesystem::path& filena
   return model;
 }
 
+// This is the .glb fast path of loadGltfResources.
+// The file is mapped in memory and only the JSON chunk is given to tinygltf: the buffer referring to the BIN chunk
+// is replaced by a 1-byte placeholder, and the BIN chunk is exposed as a span of the mapping.
+// Images stored in buffer views get the same treatment, their bufferView is restored after parsing.
+// This avoids reading the whole file in a std::vector and copying the BIN chunk into tinygltf::Buffer::data.
+bool nvsamples::loadGltfMapped(const std::filesystem::path& filename, GltfMappedModel& mappedModel)
+{
+  nvutils::ScopedTimer _st(__FUNCTION__);
+
+  // https://registry.khronos.org/glTF/specs/2.0/glTF-2.0.html#binary-gltf-layout
+  constexpr uint32_t kGlbMagic     = 0x46546C67;  // "glTF"
+  constexpr uint32_t kChunkJson    = 0x4E4F534A;  // "JSON"
+  constexpr uint32_t kChunkBin     = 0x004E4942;  // "BIN\0"
+  constexpr char     kPlaceholder[] = "data:application/octet-stream;base64,AA==";  // One zero byte
+
+  mappedModel.model    = {};
+  mappedModel.binChunk = {};
+  if(!mappedModel.mapping.open(filename))
+  {
+    LOGE("Error mapping glTF file: %s\n", filename.string().c_str());
+    return false;
+  }
+
+  const uint8_t* fileData = static_cast<const uint8_t*>(mappedModel.mapping.data());
+  const size_t   fileSize = mappedModel.mapping.size();
+  auto           readU32  = [&](size_t offset) -> uint32_t {
+    uint32_t value{};
+    std::memcpy(&value, fileData + offset, sizeof(value));
+    return value;
+  };
+
+  if(fileSize < 20 || readU32(0) != kGlbMagic || readU32(4) != 2 || readU32(8) > fileSize || readU32(16) != kChunkJson)
+  {
+    LOGE("Invalid .glb file: %s\n", filename.string().c_str());
+    return false;
+  }
+  const size_t jsonLength = readU32(12);
+  const size_t binHeader  = (20 + jsonLength + 3) & ~size_t(3);
+  if(20 + jsonLength > fileSize)
+  {
+    LOGE("Invalid .glb JSON chunk: %s\n", filename.string().c_str());
+    return false;
+  }
+  std::span<const uint8_t> binChunk;
+  if(binHeader + 8 <= fileSize && readU32(binHeader + 4) == kChunkBin)
+  {
+    binChunk = std::span<const uint8_t>(fileData + binHeader + 8, std::min<size_t>(readU32(binHeader), fileSize - binHeader - 8));
+  }
+
+  // Replace the references to the BIN chunk before handing the JSON to tinygltf
+  nlohmann::json json = nlohmann::json::parse(fileData + 20, fileData + 20 + jsonLength, nullptr, false);
+  if(json.is_discarded())
+  {
+    LOGE("Invalid .glb JSON chunk: %s\n", filename.string().c_str());
+    return false;
+  }
+  size_t binByteLength = 0;
+  if(json.contains("buffers") && !json["buffers"].empty() && !json["buffers"][0].contains("uri"))
+  {
+    binByteLength                    = json["buffers"][0].value("byteLength", size_t(0));
+    json["buffers"][0]["uri"]        = kPlaceholder;
+    json["buffers"][0]["byteLength"] = 1;
+    if(binByteLength > binChunk.size())
+    {
+      LOGE("Invalid .glb BIN chunk: %s\n", filename.string().c_str());
+      return false;
+    }
+  }
+  std::vector<int> imageBufferViews;
+  if(json.contains("images"))
+  {
+    for(nlohmann::json& image : json["images"])
+    {
+      imageBufferViews.push_back(image.value("bufferView", -1));
+      if(image.contains("bufferView"))
+      {
+        image.erase("bufferView");
+        image["uri"] = kPlaceholder;
+      }
+    }
+  }
+
+  tinygltf::TinyGLTF tinyLoader;
+  std::string        err, warn;
+  // Images are not decoded by the importer, and the placeholders cannot be decoded anyway
+  tinyLoader.SetImageLoader([](tinygltf::Image*, const int, std::string*, std::string*, int, int, const unsigned char*, int,
+                               void*) { return true; },
+                            nullptr);
+  const std::string jsonString = json.dump();
+  if(!tinyLoader.LoadASCIIFromString(&mappedModel.model, &err, &warn, jsonString.c_str(), uint32_t(jsonString.size()),
+                                     filename.parent_path().string()))
+  {
+    LOGE("Error loading glTF file: %s\n", err.c_str());
+    return false;
+  }
+
+  // Restore what was patched, the data now comes from the mapping
+  if(binByteLength > 0)
+  {
+    mappedModel.model.buffers[0].uri.clear();
+    mappedModel.model.buffers[0].data.clear();
+    mappedModel.binChunk = binChunk.subspan(0, binByteLength);
+  }
+  for(size_t i = 0; i < imageBufferViews.size() && i < mappedModel.model.images.size(); i++)
+  {
+    if(imageBufferViews[i] >= 0)
+    {
+      mappedModel.model.images[i].bufferView = imageBufferViews[i];
+      mappedModel.model.images[i].uri.clear();
+    }
+  }
+
+  LOGI("%s", fmt::format("\n{}Loaded glTF file: {} (mapped, {:.2f} MB BIN chunk not copied)", _st.indent(),
+                         filename.string(), double(mappedModel.binChunk.size()) / (1024.0 * 1024.0))
+                 .c_str());
+  return true;
+}
+
+// Local transform of a node: the matrix if available, otherwise translation * rotation * scale
+static glm::mat4 getNodeLocalTransform(const tinygltf::Node& node)
+{
+  if(!node.matrix.empty())
+  {
+    return glm::make_mat4(node.matrix.data());
+  }
+
+  glm::mat4 transform(1.0f);
+  if(!node.translation.empty())
+  {
+    transform = glm::translate(transform, glm::vec3(glm::make_vec3(node.translation.data())));
+  }
+  if(!node.rotation.empty())
+  {
+    transform = transform * glm::mat4_cast(glm::quat(glm::make_quat(node.rotation.data())));
+  }
+  if(!node.scale.empty())
+  {
+    transform = glm::scale(transform, glm::vec3(glm::make_vec3(node.scale.data())));
+  }
+  return transform;
+}
+
+// Creates the instances of all nodes referencing a mesh, with their world transform.
+// The hierarchy is flattened in linear time:
+// - a parent table is built once, the roots are the nodes without parent
+// - a depth-first pre-order of the nodes gives the (deterministic) order of the instances
+// - the world transforms are computed level by level, each level in parallel batches
+// - the instances are written in parallel to their pre-computed slot in the reserved `instances` vector
+static void importGltfInstances(nvsamples::GltfSceneResource& sceneResource, const tinygltf::Model& model, uint32_t rangeOffset)
+{
+  SCOPED_TIMER(__FUNCTION__);
+
+  const uint32_t numNodes = uint32_t(model.nodes.size());
+  auto           isValidNode = [&](int nodeIdx) { return nodeIdx >= 0 && nodeIdx < int(numNodes); };
+
+  // Parent table, -1 for the root nodes
+  std::vector<int> parents(numNodes, -1);
+  for(uint32_t nodeIdx = 0; nodeIdx < numNodes; nodeIdx++)
+  {
+    for(int childIdx : model.nodes[nodeIdx].children)
+    {
+      if(isValidNode(childIdx) && parents[childIdx] == -1 && childIdx != int(nodeIdx))
+      {
+        parents[childIdx] = int(nodeIdx);
+      }
+    }
+  }
+
+  // Depth-first pre-order from the roots, in the same order as a recursive traversal
+  std::vector<uint32_t> order;
+  std::vector<uint32_t> depths(numNodes, 0);
+  std::vector<uint8_t>  visited(numNodes, 0);
+  std::vector<uint32_t> stack;
+  order.reserve(numNodes);
+  for(uint32_t rootIdx = 0; rootIdx < numNodes; rootIdx++)
+  {
+    if(parents[rootIdx] != -1)
+      continue;
+    stack.push_back(rootIdx);
+    while(!stack.empty())
+    {
+      const uint32_t nodeIdx = stack.back();
+      stack.pop_back();
+      if(visited[nodeIdx])
+        continue;  // Malformed hierarchy (node with several parents, or cycle)
+      visited[nodeIdx] = 1;
+      order.push_back(nodeIdx);
+
+      const std::vector<int>& children = model.nodes[nodeIdx].children;
+      for(auto it = children.rbegin(); it != children.rend(); ++it)
+      {
+        if(isValidNode(*it) && parents[*it] == int(nodeIdx))
+        {
+          depths[*it] = depths[nodeIdx] + 1;
+          stack.push_back(uint32_t(*it));
+        }
+      }
+    }
+  }
+
+  // Group the reachable nodes by depth (counting sort), a level only depends on the previous one
+  uint32_t maxDepth = 0;
+  for(uint32_t nodeIdx : order)
+  {
+    maxDepth = std::max(maxDepth, depths[nodeIdx]);
+  }
+  std::vector<uint32_t> levelStart(maxDepth + 2, 0);
+  for(uint32_t nodeIdx : order)
+  {
+    levelStart[depths[nodeIdx] + 1]++;
+  }
+  for(uint32_t d = 1; d < levelStart.size(); d++)
+  {
+    levelStart[d] += levelStart[d - 1];
+  }
+  std::vector<uint32_t> levelNodes(order.size());
+  {
+    std::vector<uint32_t> cursor(levelStart.begin(), levelStart.end() - 1);
+    for(uint32_t nodeIdx : order)
+    {
+      levelNodes[cursor[depths[nodeIdx]]++] = nodeIdx;
+    }
+  }
+
+  // World transforms, level by level
+  std::vector<glm::mat4> worldTransforms(numNodes, glm::mat4(1.0f));
+  for(uint32_t d = 0; d <= maxDepth; d++)
+  {
+    const uint32_t* nodes = levelNodes.data() + levelStart[d];
+    nvutils::parallel_batches(levelStart[d + 1] - levelStart[d], [&](uint64_t i) {
+      const uint32_t  nodeIdx  = nodes[i];
+      const glm::mat4 local    = getNodeLocalTransform(model.nodes[nodeIdx]);
+      worldTransforms[nodeIdx] = parents[nodeIdx] == -1 ? local : worldTransforms[parents[nodeIdx]] * local;
+    });
+  }
+
+  // Slot of the first instance of each node in pre-order, one instance per primitive of the node's mesh
+  auto getPrimitiveRange = [&](uint32_t nodeIdx) -> nvsamples::PrimitiveRange {
+    const int mesh = model.nodes[nodeIdx].mesh;
+    return mesh >= 0 ? sceneResource.meshPrimitiveRanges[rangeOffset + mesh] : nvsamples::PrimitiveRange{};
+  };
+  std::vector<uint32_t> firstInstance(order.size());
+  uint32_t              numInstances = uint32_t(sceneResource.instances.size());
+  for(size_t i = 0; i < order.size(); i++)
+  {
+    firstInstance[i] = numInstances;
+    numInstances += getPrimitiveRange(order[i]).count;
+  }
+
+  sceneResource.instances.resize(numInstances);
+  nvutils::parallel_batches(order.size(), [&](uint64_t i) {
+    const nvsamples::PrimitiveRange range = getPrimitiveRange(order[i]);
+    for(uint32_t p = 0; p < range.count; p++)
+    {
+      shaderio::GltfInstance& instance = sceneResource.instances[firstInstance[i] + p];
+      instance                         = {};
+      instance.meshIndex               = range.first + p;
+      instance.transform               = worldTransforms[order[i]];
+    }
+  });
+}
+
 // This is a utility function to import the GLTF data into the scene resource.
-// It is a very simple function that just imports the GLTF data into the scene resource.
-// It has strong limitations, like the mesh must have only one primitive, and the primitive must be a triangle primitive.
-// But it allow to import the GLTF data into the scene resource with a single function call, and call it again to import another scene.
-void nvsamples::importGltfData(GltfSceneResource&     sceneResource,
-                               const tinygltf::Model& model,
-                               nvvk::StagingUploader& stagingUploader,
-                               bool                   importInstance /*= false*/)
+// All the glTF buffers are packed, one after the other, in a single range of the geometry arena and uploaded in a single staging pass.
+// Each triangle primitive of each mesh becomes a GltfMesh, and `meshPrimitiveRanges` tells which GltfMesh belong to which glTF mesh.
+// When importing the instances, a node referencing a mesh creates one instance per primitive of the mesh.
+// The function can be called again to import another scene.
+bool nvsamples::importGltfData(GltfSceneResource&       sceneResource,
+                               const tinygltf::Model&   model,
+                               nvvk::StagingUploader&   stagingUploader,
+                               bool                     importInstance /*= false*/,
+                               const GltfImportOptions& options /*= {}*/)
+{
+  std::vector<std::span<const uint8_t>> buffersData;
+  for(const tinygltf::Buffer& buffer : model.buffers)
+  {
+    buffersData.emplace_back(buffer.data);
+  }
+  return importGltfData(sceneResource, model, buffersData, &stagingUploader, importInstance, options);
+}
+
+// Same as above, but the binary chunk of the .glb is read directly from the file mapping
+bool nvsamples::importGltfData(GltfSceneResource&       sceneResource,
+                               const GltfMappedModel&   mappedModel,
+                               nvvk::StagingUploader&   stagingUploader,
+                               bool                     importInstance /*= false*/,
+                               const GltfImportOptions& options /*= {}*/)
+{
+  std::vector<std::span<const uint8_t>> buffersData;
+  for(const tinygltf::Buffer& buffer : mappedModel.model.buffers)
+  {
+    buffersData.emplace_back(buffer.data);
+  }
+  if(!buffersData.empty() && !mappedModel.binChunk.empty())
+  {
+    buffersData[0] = mappedModel.binChunk;
+  }
+  return importGltfData(sceneResource, mappedModel.model, buffersData, &stagingUploader, importInstance, options);
+}
+
+// The data of each glTF buffer is provided separately, `buffersData[i]` holds the content of `model.buffers[i]`.
+//
+// Attributes stored as floats are used in place, from the packed glTF buffers. The other attributes are converted
+// on the host and written after the glTF buffers, in the same device buffer:
+// - KHR_mesh_quantization inputs (normalized or integer components) are expanded to floats
+// - 8-bit indices are widened to 16 bits
+// - with `options.quantizeVertices`, positions, normals, tangents and texture coordinates are quantized
+//   (see shaderio::VertexFormat). The glTF buffers are then not uploaded, all the used data being converted.
+// - with `options.optimizeMeshes`, each primitive gets its own optimized copy of the indices and of the vertices
+//   (see mesh_optimizer.hpp). The glTF buffers are not uploaded either.
+// Converted indices use 16 bits when the primitive has at most 65536 vertices.
+// The geometry of the meshes is hashed, and with `options.deduplicateMeshes`, the meshes identical to other meshes of
+// the glTF become aliases of them (see registerMeshGeometries).
+// Without staging uploader, nothing is uploaded: the geometry stays on the host, in `packedGeometry`.
+// The buffer views address the packed geometry with 32-bit offsets: a scene whose packed geometry does not fit is not
+// imported, the function returns false.
+bool nvsamples::importGltfData(GltfSceneResource&                        sceneResource,
+                               const tinygltf::Model&                    model,
+                               std::span<const std::span<const uint8_t>> buffersData,
+                               nvvk::StagingUploader*                    stagingUploader,
+                               bool                                      importInstance,
+                               const GltfImportOptions&                  options,
+                               GltfPackedGeometry*                       packedGeometry,
+                               AsyncUploader*                            asyncUploader)
 {
   SCOPED_TIMER(__FUNCTION__);
+  assert(buffersData.size() == model.buffers.size());
+
+  const uint32_t rangeOffset = uint32_t(sceneResource.meshPrimitiveRanges.size());
+  const uint32_t meshOffset  = uint32_t(sceneResource.meshes.size());
 
-  const uint32_t meshOffset = uint32_t(sceneResource.meshes.size());
+  // When all the vertex data is converted, the glTF buffers are not needed on the device
+  const bool convertAll = options.quantizeVertices || options.optimizeMeshes;
 
   // Lambda for element byte size calculation
   auto getElementByteSize = [](int type) -> uint32_t {
-    return type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT ? 2U :
+    return type == TINYGLTF_COMPONENT_TYPE_BYTE           ? 1U :
+           type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE  ? 1U :
+           type == TINYGLTF_COMPONENT_TYPE_SHORT          ? 2U :
+           type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT ? 2U :
            type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT   ? 4U :
            type == TINYGLTF_COMPONENT_TYPE_FLOAT          ? 4U :
                                                             0U;
@@ -145,170 +714,477 @@ void nvsamples::importGltfData(GltfSceneResource&     sceneResource,
 
   // Lambda for type size calculation
   auto getTypeSize = [](int type) -> uint32_t {
-    return type == TINYGLTF_TYPE_VEC2 ? 2U :
-           type == TINYGLTF_TYPE_VEC3 ? 3U :
-           type == TINYGLTF_TYPE_VEC4 ? 4U :
-           type == TINYGLTF_TYPE_MAT2 ? 4U * 2U :
-           type == TINYGLTF_TYPE_MAT3 ? 4U * 3U :
-           type == TINYGLTF_TYPE_MAT4 ? 4U * 4U :
-                                        0U;
+    return type == TINYGLTF_TYPE_SCALAR ? 1U :
+           type == TINYGLTF_TYPE_VEC2   ? 2U :
+           type == TINYGLTF_TYPE_VEC3   ? 3U :
+           type == TINYGLTF_TYPE_VEC4   ? 4U :
+           type == TINYGLTF_TYPE_MAT2   ? 4U * 2U :
+           type == TINYGLTF_TYPE_MAT3   ? 4U * 3U :
+           type == TINYGLTF_TYPE_MAT4   ? 4U * 4U :
+                                          0U;
   };
 
-  // Lambda for extracting attributes, like positions, normals, colors, etc.
-  auto extractAttribute = [&](const std::string& name, shaderio::BufferView& attr, const tinygltf::Primitive& primitive) {
-    if(!primitive.attributes.contains(name))
-    {
-      attr.offset = -1;
-      return;
-    }
-    const tinygltf::Accessor&   acc = model.accessors[primitive.attributes.at(name)];
-    const tinygltf::BufferView& bv  = model.bufferViews[acc.bufferView];
-    assert((acc.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) && "Should be floats");
-    attr = {
-        .offset = uint32_t(bv.byteOffset + acc.byteOffset),
-        .count  = uint32_t(acc.count),
-        .byteStride = uint32_t(bv.byteStride ? uint32_t(bv.byteStride) : getTypeSize(acc.type) * getElementByteSize(acc.componentType)),
-    };
+  auto getAccessorStride = [&](const tinygltf::Accessor& acc) -> uint32_t {
+    const tinygltf::BufferView& bv = model.bufferViews[acc.bufferView];
+    return uint32_t(bv.byteStride ? bv.byteStride : getTypeSize(acc.type) * getElementByteSize(acc.componentType));
   };
 
-
-  // Upload the scene resource to the GPU
-  nvvk::Buffer bGltfData;
-  uint32_t     bufferIndex{};
+  // Each glTF buffer is placed at an aligned offset in the packed device buffer
+  constexpr VkDeviceSize kBufferAlignment = 16;
+  GltfPackedGeometry     packed;
+  packed.bufferOffsets.resize(model.buffers.size());
+  for(size_t i = 0; i < buffersData.size() && !convertAll; i++)
   {
-    nvvk::ResourceAllocator* allocator = stagingUploader.getResourceAllocator();
-
-
-    // The GLTF buffer is used to store the geometry data (indices, positions, normals, etc.)
-    // The flags are set to allow the buffer to be used as a vertex buffer, index buffer, storage buffer, and for acceleration structure build input read-only.
-    NVVK_CHECK(allocator->createBuffer(bGltfData, std::span<const unsigned char>(model.buffers[0].data).size_bytes(),
-                                       VK_BUFFER_USAGE_2_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_2_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT
-                                           | VK_BUFFER_USAGE_2_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR));  // #RT
-    NVVK_CHECK(stagingUploader.appendBuffer(bGltfData, 0, std::span<const unsigned char>(model.buffers[0].data)));
-    NVVK_DBG_NAME(bGltfData.buffer);
-
-    bufferIndex = static_cast<uint32_t>(sceneResource.bGltfDatas.size());
-    sceneResource.bGltfDatas.push_back(bGltfData);
+    packed.buffers.push_back(buffersData[i]);
+    packed.bufferOffsets[i] = packed.convertedBase;
+    packed.convertedBase = (packed.convertedBase + buffersData[i].size() + kBufferAlignment - 1) & ~(kBufferAlignment - 1);
   }
+  const std::vector<VkDeviceSize>& bufferOffsets = packed.bufferOffsets;
 
-  for(size_t meshIdx = 0; meshIdx < model.meshes.size(); ++meshIdx)
+  // The offsets of the buffer views are 32 bits, with ~0 marking a missing attribute
+  constexpr VkDeviceSize kMaxPackedSize  = VkDeviceSize(~0U);
+  auto                   checkPackedSize = [&](VkDeviceSize size) -> bool {
+    if(size <= kMaxPackedSize)
+      return true;
+    LOGE("The packed geometry of the glTF scene (%llu bytes) exceeds the 4 GB addressable by the buffer views\n",
+         static_cast<unsigned long long>(size));
+    return false;
+  };
+  if(!checkPackedSize(packed.convertedBase))
   {
-    shaderio::GltfMesh mesh{};
+    return false;
+  }
 
-    const tinygltf::Mesh&      tinyMesh  = model.meshes[meshIdx];
-    const tinygltf::Primitive& primitive = tinyMesh.primitives.front();
-    assert((tinyMesh.primitives.size() == 1 && primitive.mode == TINYGLTF_MODE_TRIANGLES) && "Must have one triangle primitive");
+  // Converted data, placed after the glTF buffers
+  const VkDeviceSize    convertedBase = packed.convertedBase;
+  std::vector<uint8_t>& convertedData = packed.convertedData;
+  auto appendConverted = [&](const void* data, size_t size) -> uint32_t {
+    const size_t offset = (convertedData.size() + kBufferAlignment - 1) & ~size_t(kBufferAlignment - 1);
+    convertedData.resize(offset + size);
+    std::memcpy(convertedData.data() + offset, data, size);
+    return uint32_t(convertedBase + offset);
+  };
 
+  // Offset of an accessor in the packed buffer
+  auto getAccessorOffset = [&](const tinygltf::Accessor& acc) -> uint32_t {
+    const tinygltf::BufferView& bv = model.bufferViews[acc.bufferView];
+    return uint32_t(bufferOffsets[bv.buffer] + bv.byteOffset + acc.byteOffset);
+  };
 
-    // Extract indices
-    auto& accessor   = model.accessors[primitive.indices];
-    auto& bufferView = model.bufferViews[accessor.bufferView];
-    assert((accessor.count % 3 == 0) && "Should be a multiple of 3");
-    mesh.triMesh.indices = {
-        .offset = uint32_t(bufferView.byteOffset + accessor.byteOffset),
-        .count  = uint32_t(accessor.count),
-        .byteStride = uint32_t(bufferView.byteStride ? bufferView.byteStride : getElementByteSize(accessor.componentType)),
-    };
-    mesh.indexType = accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+  // Host pointer to the first element of an accessor
+  auto getAccessorData = [&](const tinygltf::Accessor& acc) -> const uint8_t* {
+    const tinygltf::BufferView& bv = model.bufferViews[acc.bufferView];
+    return buffersData[bv.buffer].data() + bv.byteOffset + acc.byteOffset;
+  };
 
-    // Set the buffer address
-    mesh.gltfBuffer = (uint8_t*)bGltfData.address;
+  // Reads an accessor as `numComponents` floats per element, following KHR_mesh_quantization for the integer types
+  auto readAccessorFloats = [&](const tinygltf::Accessor& acc, uint32_t numComponents, float defaultW) -> std::vector<float> {
+    const uint8_t* data       = getAccessorData(acc);
+    const uint32_t stride     = getAccessorStride(acc);
+    const uint32_t srcComps   = std::min(getTypeSize(acc.type), numComponents);
+    const bool     normalized = acc.normalized;
+    std::vector<float> result(acc.count * numComponents, 0.0f);
+    for(size_t i = 0; i < acc.count; i++)
+    {
+      const uint8_t* element = data + i * stride;
+      float*         dst     = result.data() + i * numComponents;
+      for(uint32_t c = 0; c < srcComps; c++)
+      {
+        switch(acc.componentType)
+        {
+          case TINYGLTF_COMPONENT_TYPE_FLOAT: {
+            std::memcpy(&dst[c], element + c * 4, 4);
+            break;
+          }
+          case TINYGLTF_COMPONENT_TYPE_BYTE: {
+            const int8_t v = int8_t(element[c]);
+            dst[c]         = normalized ? std::max(float(v) / 127.0f, -1.0f) : float(v);
+            break;
+          }
+          case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: {
+            dst[c] = normalized ? float(element[c]) / 255.0f : float(element[c]);
+            break;
+          }
+          case TINYGLTF_COMPONENT_TYPE_SHORT: {
+            int16_t v;
+            std::memcpy(&v, element + c * 2, 2);
+            dst[c] = normalized ? std::max(float(v) / 32767.0f, -1.0f) : float(v);
+            break;
+          }
+          case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+            uint16_t v;
+            std::memcpy(&v, element + c * 2, 2);
+            dst[c] = normalized ? float(v) / 65535.0f : float(v);
+            break;
+          }
+          case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: {
+            uint32_t v;
+            std::memcpy(&v, element + c * 4, 4);
+            dst[c] = float(v);
+            break;
+          }
+        }
+      }
+      if(numComponents == 4 && srcComps == 3)
+      {
+        dst[3] = defaultW;
+      }
+    }
+    return result;
+  };
 
-    // Extract attributes
-    extractAttribute("POSITION", mesh.triMesh.positions, primitive);
-    extractAttribute("NORMAL", mesh.triMesh.normals, primitive);
-    extractAttribute("COLOR_0", mesh.triMesh.colorVert, primitive);
-    extractAttribute("TEXCOORD_0", mesh.triMesh.texCoords, primitive);
-    extractAttribute("TANGENT", mesh.triMesh.tangents, primitive);
+  enum class AttributeKind
+  {
+    ePosition,
+    eNormal,
+    eTangent,
+    eTexCoord,
+    eColor,
+  };
 
-    sceneResource.meshes.emplace_back(mesh);
+  // Converted attributes are shared between the primitives using the same accessor, unless the vertices are reordered
+  struct ConvertedAttribute
+  {
+    shaderio::BufferView view;
+    glm::vec3            dequantScale{1.0f};
+    glm::vec3            dequantOffset{0.0f};
+    uint32_t             dequantTransform{0};
+  };
+  std::unordered_map<uint64_t, ConvertedAttribute> convertedAttributes;
 
-    // Update the mapping from mesh index to buffer index
-    sceneResource.meshToBufferIndex.push_back(bufferIndex);
-  }
+  // `vertexOrder` is the optimized order of the vertices of the primitive, see optimizeVertexFetch
+  auto convertAttribute = [&](int accessorIndex, AttributeKind kind, std::span<const uint32_t> vertexOrder) -> ConvertedAttribute {
+    const uint64_t key = (uint64_t(accessorIndex) << 8) | uint64_t(kind);
+    if(auto it = convertedAttributes.find(key); it != convertedAttributes.end() && !options.optimizeMeshes)
+      return it->second;
 
-  if(importInstance)
-  {
-    // Extract instances with proper hierarchical transformation handling
-    std::function<void(const tinygltf::Node&, const glm::mat4&)> processNode = [&](const tinygltf::Node& node,
-                                                                                   const glm::mat4& parentTransform) {
-      glm::mat4 nodeTransform = parentTransform;
+    const tinygltf::Accessor& acc   = model.accessors[accessorIndex];
+    const uint32_t            count = options.optimizeMeshes ? uint32_t(vertexOrder.size()) : uint32_t(acc.count);
+    ConvertedAttribute        result;
+    result.view.count = count;
 
-      // Apply node transform
-      if(!node.matrix.empty())
+    // Reads the vertices of the accessor, in the optimized order when the meshes are optimized
+    auto readVertices = [&](uint32_t numComponents, float defaultW) -> std::vector<float> {
+      std::vector<float> values = readAccessorFloats(acc, numComponents, defaultW);
+      if(!options.optimizeMeshes)
+        return values;
+      std::vector<float> ordered(vertexOrder.size() * numComponents);
+      for(size_t i = 0; i < vertexOrder.size(); i++)
       {
-        // Use matrix if available
-        glm::mat4 matrix = glm::make_mat4(node.matrix.data());
-        nodeTransform    = parentTransform * matrix;
+        std::copy_n(&values[vertexOrder[i] * numComponents], numComponents, &ordered[i * numComponents]);
       }
-      else
-      {
-        // Apply TRS if matrix is not available
-        if(!node.translation.empty())
+      return ordered;
+    };
+
+    const bool quantize = options.quantizeVertices;
+    switch(kind)
+    {
+      case AttributeKind::ePosition: {
+        const std::vector<float> pos = readVertices(3, 0.0f);
+        if(!quantize)
         {
-          glm::vec3 translation = glm::make_vec3(node.translation.data());
-          nodeTransform         = glm::translate(nodeTransform, translation);
+          result.view.offset     = appendConverted(pos.data(), pos.size() * sizeof(float));
+          result.view.byteStride = 3 * sizeof(float);
+          break;
         }
-        if(!node.rotation.empty())
+        // Map the bounding box of the positions to [-1,1]
+        glm::vec3 bbMin(std::numeric_limits<float>::max()), bbMax(-std::numeric_limits<float>::max());
+        for(uint32_t i = 0; i < count; i++)
         {
-          glm::quat rotation = glm::make_quat(node.rotation.data());
-          nodeTransform      = nodeTransform * glm::mat4_cast(rotation);
+          bbMin = glm::min(bbMin, glm::make_vec3(&pos[i * 3]));
+          bbMax = glm::max(bbMax, glm::make_vec3(&pos[i * 3]));
         }
-        if(!node.scale.empty())
+        result.dequantOffset = (bbMin + bbMax) * 0.5f;
+        result.dequantScale  = glm::max((bbMax - bbMin) * 0.5f, glm::vec3(1e-20f));
+        std::vector<QuantizedPosition> quantized(count);
+        for(uint32_t i = 0; i < count; i++)
         {
-          glm::vec3 scale = glm::make_vec3(node.scale.data());
-          nodeTransform   = glm::scale(nodeTransform, scale);
+          quantized[i] = quantizePosition(glm::make_vec3(&pos[i * 3]), result.dequantScale, result.dequantOffset);
         }
-      }
+        result.view.offset     = appendConverted(quantized.data(), std::span(quantized).size_bytes());
+        result.view.byteStride = sizeof(QuantizedPosition);
+        result.view.format     = shaderio::eVertexFormatSnorm16;
 
-      // Create instance for this node if it has a mesh
-      if(node.mesh != -1)
-      {
-        const tinygltf::Mesh&      tinyMesh  = model.meshes[node.mesh];
-        const tinygltf::Primitive& primitive = tinyMesh.primitives.front();
-        assert((tinyMesh.primitives.size() == 1 && primitive.mode == TINYGLTF_MODE_TRIANGLES) && "Must have one triangle primitive");
-        shaderio::GltfInstance instance{};
-        instance.meshIndex = node.mesh + meshOffset;
-        instance.transform = nodeTransform;
-        sceneResource.instances.push_back(instance);
+        // Transform applied by the BLAS build to get the positions back in object space
+        const VkTransformMatrixKHR dequant{{{result.dequantScale.x, 0.0f, 0.0f, result.dequantOffset.x},
+                                            {0.0f, result.dequantScale.y, 0.0f, result.dequantOffset.y},
+                                            {0.0f, 0.0f, result.dequantScale.z, result.dequantOffset.z}}};
+        result.dequantTransform = appendConverted(&dequant, sizeof(dequant));
+        break;
       }
-
-      // Process children
-      for(int childIdx : node.children)
-      {
-        if(childIdx >= 0 && childIdx < static_cast<int>(model.nodes.size()))
+      case AttributeKind::eNormal:
+      case AttributeKind::eTangent: {
+        const uint32_t           numComponents = kind == AttributeKind::eTangent ? 4 : 3;
+        const std::vector<float> dirs          = readVertices(numComponents, 1.0f);
+        if(!quantize)
         {
-          processNode(model.nodes[childIdx], nodeTransform);
+          result.view.offset     = appendConverted(dirs.data(), dirs.size() * sizeof(float));
+          result.view.byteStride = numComponents * sizeof(float);
+          break;
         }
+        std::vector<QuantizedDirection> quantized(count);
+        for(uint32_t i = 0; i < count; i++)
+        {
+          const float* d = &dirs[i * numComponents];
+          quantized[i]   = quantizeDirection(glm::make_vec3(d), numComponents == 4 ? d[3] : 1.0f);
+        }
+        result.view.offset     = appendConverted(quantized.data(), std::span(quantized).size_bytes());
+        result.view.byteStride = sizeof(QuantizedDirection);
+        result.view.format     = shaderio::eVertexFormatOct16;
+        break;
       }
-    };
+      case AttributeKind::eTexCoord: {
+        const std::vector<float> uvs = readVertices(2, 0.0f);
+        if(!quantize)
+        {
+          result.view.offset     = appendConverted(uvs.data(), uvs.size() * sizeof(float));
+          result.view.byteStride = 2 * sizeof(float);
+          break;
+        }
+        std::vector<QuantizedTexCoord> quantized(count);
+        for(uint32_t i = 0; i < count; i++)
+        {
+          quantized[i] = quantizeTexCoord(glm::make_vec2(&uvs[i * 2]));
+        }
+        result.view.offset     = appendConverted(quantized.data(), std::span(quantized).size_bytes());
+        result.view.byteStride = sizeof(QuantizedTexCoord);
+        result.view.format     = shaderio::eVertexFormatFloat16;
+        break;
+      }
+      case AttributeKind::eColor: {
+        const std::vector<float> colors = readVertices(4, 1.0f);
+        result.view.offset              = appendConverted(colors.data(), colors.size() * sizeof(float));
+        result.view.byteStride          = 4 * sizeof(float);
+        break;
+      }
+    }
+
+    if(!options.optimizeMeshes)
+      convertedAttributes[key] = result;
+    return result;
+  };
+
+  // Lambda for extracting attributes, like positions, normals, colors, etc.
+  auto extractAttribute = [&](const std::string& name, AttributeKind kind, shaderio::GltfMesh& mesh, shaderio::BufferView& attr,
+                              const tinygltf::Primitive& primitive, std::span<const uint32_t> vertexOrder) {
+    if(!primitive.attributes.contains(name) || model.accessors[primitive.attributes.at(name)].bufferView < 0)
+    {
+      attr.offset = -1;
+      return;
+    }
+    const int                 accessorIndex = primitive.attributes.at(name);
+    const tinygltf::Accessor& acc           = model.accessors[accessorIndex];
+    if(acc.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT && !convertAll)
+    {
+      attr = {
+          .offset     = getAccessorOffset(acc),
+          .count      = uint32_t(acc.count),
+          .byteStride = getAccessorStride(acc),
+          .format     = shaderio::eVertexFormatFloat32,
+      };
+      return;
+    }
 
-    // Process all root nodes (nodes with no parent)
-    for(size_t nodeIdx = 0; nodeIdx < model.nodes.size(); ++nodeIdx)
+    const ConvertedAttribute converted = convertAttribute(accessorIndex, kind, vertexOrder);
+    attr                               = converted.view;
+    if(kind == AttributeKind::ePosition)
     {
-      const tinygltf::Node& node = model.nodes[nodeIdx];
-      // Check if this is a root node (not referenced as a child)
-      bool isRootNode = true;
-      for(const auto& otherNode : model.nodes)
+      mesh.dequantScale     = converted.dequantScale;
+      mesh.dequantOffset    = converted.dequantOffset;
+      mesh.dequantTransform = converted.dequantTransform;
+    }
+  };
+
+  // Only indexed triangle primitives with positions stored in a buffer view can be used for ray tracing
+  auto isSupportedPrimitive = [&](const tinygltf::Primitive& primitive) -> bool {
+    if(primitive.mode != TINYGLTF_MODE_TRIANGLES || primitive.indices < 0 || !primitive.attributes.contains("POSITION"))
+      return false;
+    const tinygltf::Accessor& indexAcc = model.accessors[primitive.indices];
+    const tinygltf::Accessor& posAcc   = model.accessors[primitive.attributes.at("POSITION")];
+    return indexAcc.bufferView >= 0 && posAcc.bufferView >= 0 && getElementByteSize(indexAcc.componentType) != 0
+           && indexAcc.sparse.count == 0 && posAcc.sparse.count == 0;
+  };
+
+  // Reads the indices of an accessor as 32-bit values
+  auto readIndices = [&](const tinygltf::Accessor& acc) -> std::vector<uint32_t> {
+    const uint8_t*        data   = getAccessorData(acc);
+    const uint32_t        stride = getAccessorStride(acc);
+    std::vector<uint32_t> indices(acc.count);
+    for(size_t i = 0; i < acc.count; i++)
+    {
+      switch(acc.componentType)
       {
-        for(int childIdx : otherNode.children)
-        {
-          if(childIdx == static_cast<int>(nodeIdx))
-          {
-            isRootNode = false;
-            break;
-          }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+          indices[i] = data[i * stride];
+          break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+          uint16_t v;
+          std::memcpy(&v, data + i * stride, sizeof(v));
+          indices[i] = v;
+          break;
         }
-        if(!isRootNode)
+        default:
+          std::memcpy(&indices[i], data + i * stride, sizeof(uint32_t));
           break;
       }
+    }
+    return indices;
+  };
+
+  // Writes the indices to the converted data, with 16 bits when all the vertices can be addressed
+  auto appendIndices = [&](shaderio::GltfMesh& mesh, std::span<const uint32_t> indices, uint32_t numVertices) {
+    mesh.triMesh.indices.count = uint32_t(indices.size());
+    if(numVertices <= kMaxUint16IndexedVertices)
+    {
+      std::vector<uint16_t> indices16(indices.begin(), indices.end());
+      mesh.indexType                  = VK_INDEX_TYPE_UINT16;
+      mesh.triMesh.indices.offset     = appendConverted(indices16.data(), std::span(indices16).size_bytes());
+      mesh.triMesh.indices.byteStride = sizeof(uint16_t);
+    }
+    else
+    {
+      mesh.indexType                  = VK_INDEX_TYPE_UINT32;
+      mesh.triMesh.indices.offset     = appendConverted(indices.data(), indices.size_bytes());
+      mesh.triMesh.indices.byteStride = sizeof(uint32_t);
+    }
+  };
+
+  uint32_t numSkipped    = 0;
+  uint32_t numDegenerate = 0;
+  sceneResource.meshPrimitiveRanges.reserve(sceneResource.meshPrimitiveRanges.size() + model.meshes.size());
+  for(size_t meshIdx = 0; meshIdx < model.meshes.size(); ++meshIdx)
+  {
+    const tinygltf::Mesh& tinyMesh = model.meshes[meshIdx];
+    PrimitiveRange        range{.first = uint32_t(sceneResource.meshes.size())};
+
+    for(const tinygltf::Primitive& primitive : tinyMesh.primitives)
+    {
+      if(!isSupportedPrimitive(primitive))
+      {
+        numSkipped++;
+        continue;
+      }
+
+      shaderio::GltfMesh mesh{};
+      mesh.dequantScale = glm::vec3(1.0f);
+
+      // Extract indices, 8-bit indices are widened to 16 bits
+      const tinygltf::Accessor& accessor    = model.accessors[primitive.indices];
+      const tinygltf::Accessor& posAccessor = model.accessors[primitive.attributes.at("POSITION")];
+      assert((accessor.count % 3 == 0) && "Should be a multiple of 3");
+      std::vector<uint32_t> vertexOrder;  // Optimized order of the vertices, vertexOrder[newIndex] = oldIndex
+      if(options.optimizeMeshes)
+      {
+        std::vector<uint32_t>    indices     = readIndices(accessor);
+        const std::vector<float> positions   = readAccessorFloats(posAccessor, 3, 0.0f);
+        const uint32_t           numVertices = uint32_t(posAccessor.count);
+        numDegenerate += removeDegenerateTriangles(indices, {reinterpret_cast<const glm::vec3*>(positions.data()), numVertices});
+        optimizeVertexCache(indices, numVertices);
+        vertexOrder = optimizeVertexFetch(indices, numVertices);
+        appendIndices(mesh, indices, uint32_t(vertexOrder.size()));
+      }
+      else if(accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE || convertAll)
+      {
+        appendIndices(mesh, readIndices(accessor), uint32_t(posAccessor.count));
+      }
+      else
+      {
+        mesh.indexType = accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16;
+        mesh.triMesh.indices = {
+            .offset     = getAccessorOffset(accessor),
+            .count      = uint32_t(accessor.count),
+            .byteStride = getAccessorStride(accessor),
+        };
+      }
+
+      // Extract attributes
+      extractAttribute("POSITION", AttributeKind::ePosition, mesh, mesh.triMesh.positions, primitive, vertexOrder);
+      extractAttribute("NORMAL", AttributeKind::eNormal, mesh, mesh.triMesh.normals, primitive, vertexOrder);
+      extractAttribute("COLOR_0", AttributeKind::eColor, mesh, mesh.triMesh.colorVert, primitive, vertexOrder);
+      extractAttribute("TEXCOORD_0", AttributeKind::eTexCoord, mesh, mesh.triMesh.texCoords, primitive, vertexOrder);
+      extractAttribute("TANGENT", AttributeKind::eTangent, mesh, mesh.triMesh.tangents, primitive, vertexOrder);
+
+      sceneResource.meshes.emplace_back(mesh);
+      range.count++;
+    }
+
+    sceneResource.meshPrimitiveRanges.push_back(range);
+  }
+
+  // The offsets computed above wrapped around if the converted data made the packed geometry too large
+  if(!checkPackedSize(packed.size()))
+  {
+    sceneResource.meshes.resize(meshOffset);
+    sceneResource.meshPrimitiveRanges.resize(rangeOffset);
+    return false;
+  }
+
+  if(numSkipped > 0)
+  {
+    LOGW("Skipped %u glTF primitives: only indexed triangle primitives are supported\n", numSkipped);
+  }
+  if(numDegenerate > 0)
+  {
+    LOGI("Removed %u degenerate triangles\n", numDegenerate);
+  }
+
+  // Upload the scene resource to the GPU
+  GeometryArena::Allocation allocation;
+  if(stagingUploader)
+  {
+    nvvk::ResourceAllocator* allocator = stagingUploader->getResourceAllocator();
 
-      if(isRootNode)
+    // A range of the geometry arena stores the geometry data (indices, positions, normals, etc.) of all glTF buffers
+    // The arena blocks can be used as vertex buffer, index buffer, storage buffer, and for acceleration structure build input read-only.  #RT
+    // The packed offsets are multiples of kBufferAlignment, which the alignment of the arena preserves.
+    // The data streamed on the transfer queue changes of queue family, it must not share a buffer with other data.
+    static_assert(GeometryArena::kAlignment % kBufferAlignment == 0);
+    allocation                    = allocateGeometry(sceneResource, allocator, packed.size(), asyncUploader != nullptr);
+    const nvvk::Buffer& bGltfData = sceneResource.geometryArena.getBuffer(allocation.block);
+
+    // The async uploader splits the data in chunks of its staging ring, recycled as the copies complete
+    auto upload = [&](VkDeviceSize offset, std::span<const uint8_t> data) {
+      if(asyncUploader)
+      {
+        asyncUploader->appendBuffer(bGltfData, allocation.offset + offset, data);
+      }
+      else
       {
-        processNode(node, glm::mat4(1.0f));  // Start with identity matrix
+        NVVK_CHECK(stagingUploader->appendBuffer(bGltfData, allocation.offset + offset, data));
+      }
+    };
+    for(size_t i = 0; i < packed.buffers.size(); i++)
+    {
+      if(!packed.buffers[i].empty())
+      {
+        upload(bufferOffsets[i], packed.buffers[i]);
       }
     }
+    if(!convertedData.empty())
+    {
+      upload(convertedBase, convertedData);
+    }
+  }
+
+  // Set the buffer address and the mapping from mesh index to buffer index, null and ~0 for a host-only import
+  for(size_t i = meshOffset; i < sceneResource.meshes.size(); i++)
+  {
+    sceneResource.meshes[i].gltfBuffer = (uint8_t*)allocation.address;
+    sceneResource.meshToBufferIndex.push_back(allocation.block);
+  }
+
+  if(importInstance)
+  {
+    importGltfInstances(sceneResource, model, rangeOffset);
+  }
+
+  registerMeshGeometries(sceneResource, meshOffset, packed, options.deduplicateMeshes);
+
+  if(packedGeometry)
+  {
+    *packedGeometry = std::move(packed);
   }
+  return true;
 }
 
 // This function creates the scene info buffer
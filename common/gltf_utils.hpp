@@ -21,12 +21,16 @@
 #pragma once
 
 #include <filesystem>
+#include <span>
+#include <unordered_map>
 
 #include <glm/glm.hpp>
 
+#include "geometry_arena.hpp"
 #include "io_gltf.h"  // Contains definitions for GLTF GltfMesh, BufferView, TriangleMesh and more
 
 #include "nvutils/bounding_box.hpp"
+#include "nvutils/file_mapping.hpp"
 #include "nvvk/resources.hpp"
 #include "nvvk/staging.hpp"
 #include "nvutils/primitives.hpp"
@@ -34,6 +38,33 @@
 
 namespace nvsamples {
 
+class AsyncUploader;
+
+// Version of the data produced by importGltfData, to be increased when the output of the importer changes.
+// It is part of the key of the preprocessed scene cache.
+constexpr uint32_t kGltfImporterVersion = 3;
+
+// Range of consecutive GltfMesh entries created from the primitives of one glTF mesh
+struct PrimitiveRange
+{
+  uint32_t first = 0;  // Index of the first GltfMesh (primitive) of the mesh
+  uint32_t count = 0;  // Number of primitives of the mesh
+};
+
+// Options of importGltfData
+struct GltfImportOptions
+{
+  // Quantize the vertex attributes (see shaderio::VertexFormat): 16-bit snorm positions with a per-mesh dequantization
+  // transform, octahedral 2x16-bit normals and tangents, and 16-bit float texture coordinates
+  bool quantizeVertices = false;
+  // Remove the degenerate triangles, reorder the triangles for the vertex cache and the vertices in order of first use,
+  // and use 16-bit indices when the primitive has at most 65536 vertices (see mesh_optimizer.hpp)
+  bool optimizeMeshes = false;
+  // Alias the meshes whose geometry is identical to another mesh of the same scene (see registerMeshGeometries).
+  // The aliases share the geometry range and the BLAS of the first mesh, but their data stays in the packed geometry.
+  bool deduplicateMeshes = false;
+};
+
 // Simple scene resource that holds meshes, instances, and materials
 struct GltfSceneResource
 {
@@ -43,30 +74,138 @@ struct GltfSceneResource
   shaderio::GltfSceneInfo sceneInfo;  // Scene information (camera matrices, meshes, instances, materials, etc.)
 
   // GPU buffers for the scene data
-  std::vector<nvvk::Buffer> bGltfDatas;  // Buffers containing the GLTF binary data for each loaded scene
-  nvvk::Buffer              bMeshes;     // Buffer containing all GltfMesh data
-  nvvk::Buffer              bInstances;  // Buffer containing all GltfInstance data
-  nvvk::Buffer              bMaterials;  // Buffer containing all GltfMetallicRoughness data
-  nvvk::Buffer              bSceneInfo;  // Buffer containing GltfSceneInfo
+  GeometryArena geometryArena;  // Geometry (GLTF binary data, primitive meshes) of all loaded scenes, gltfBuffer points into it
+  nvvk::Buffer  bMeshes;        // Buffer containing all GltfMesh data
+  nvvk::Buffer  bInstances;     // Buffer containing all GltfInstance data
+  nvvk::Buffer  bMaterials;     // Buffer containing all GltfMetallicRoughness data
+  nvvk::Buffer  bSceneInfo;     // Buffer containing GltfSceneInfo
+
+  // Range of the arena used by each primitive mesh or imported scene, to be freed when unloading it
+  std::vector<GeometryArena::Allocation> geometryAllocations;
 
-  // Mapping from mesh index to buffer index in bGltfDatas
+  // Mapping from mesh index to the block of geometryArena holding its geometry
   std::vector<uint32_t> meshToBufferIndex;  // meshToBufferIndex[meshIndex] = bufferIndex
+
+  // Each glTF primitive becomes one GltfMesh, this table maps the imported glTF meshes to their primitives
+  std::vector<PrimitiveRange> meshPrimitiveRanges;  // meshPrimitiveRanges[gltfMeshIndex] = range in meshes
+
+  // Geometry hashes and deduplication, see registerMeshGeometries
+  std::vector<uint64_t>                  meshHashes;      // Hash of the geometry of each mesh (0 if not hashed)
+  std::vector<uint32_t>                  meshAliases;     // meshAliases[meshIndex] = first mesh with the same geometry
+  std::unordered_map<uint64_t, uint32_t> geometryMeshes;  // Hash of a deduplicated geometry -> first mesh using it
+
+  // Mesh owning the geometry and the BLAS used by `meshIndex`, which is `meshIndex` unless the mesh is an alias
+  uint32_t getGeometryMesh(uint32_t meshIndex) const
+  {
+    return meshIndex < meshAliases.size() ? meshAliases[meshIndex] : meshIndex;
+  }
+
+  // Buffer holding the geometry of a mesh, and offset of the mesh data (gltfBuffer) in it
+  const nvvk::Buffer& getMeshBuffer(uint32_t meshIndex) const
+  {
+    return geometryArena.getBuffer(meshToBufferIndex[meshIndex]);
+  }
+  VkDeviceSize getMeshBufferOffset(uint32_t meshIndex) const
+  {
+    return VkDeviceAddress(meshes[meshIndex].gltfBuffer) - getMeshBuffer(meshIndex).address;
+  }
+};
+
+// Host view of the geometry packed by importGltfData in the device buffer, without copying the glTF buffers:
+// the glTF buffers (referenced, they must outlive it) at `bufferOffsets`, followed by the converted data.
+struct GltfPackedGeometry
+{
+  std::vector<std::span<const uint8_t>> buffers;        // Uploaded glTF buffers, empty when all the data is converted
+  std::vector<VkDeviceSize>             bufferOffsets;  // Offset of each glTF buffer in the device buffer
+  VkDeviceSize                          convertedBase = 0;
+  std::vector<uint8_t>                  convertedData;  // Data converted by the importer, at `convertedBase`
+
+  VkDeviceSize size() const { return convertedBase + convertedData.size(); }
+  // Host address of the data at `offset` in the device buffer
+  const uint8_t* getData(VkDeviceSize offset) const;
+};
+
+// glTF model of a .glb file, where the BIN chunk is not copied but stays in the file mapping
+struct GltfMappedModel
+{
+  tinygltf::Model          model;     // Model parsed from the JSON chunk, buffers[0].data is empty
+  nvutils::FileReadMapping mapping;   // Read-only mapping of the .glb file
+  std::span<const uint8_t> binChunk;  // Content of buffers[0], pointing into the mapping
 };
 
 // This is a utility function to load a GLTF file and return the model data.
 tinygltf::Model loadGltfResources(const std::filesystem::path& filename);
 
+// Fast path for .glb files: maps the file and only parses the JSON chunk, returns false on error.
+bool loadGltfMapped(const std::filesystem::path& filename, GltfMappedModel& mappedModel);
+
 // This is a utility function to import the GLTF data into the scene resource.
-void importGltfData(GltfSceneResource&     sceneResource,
-                    const tinygltf::Model& model,
-                    nvvk::StagingUploader& stagingUploader,
-                    bool                   importInstance = false);
+// All glTF buffers are packed in a single range of the geometry arena, and each triangle primitive becomes a GltfMesh.
+// Returns false, importing nothing, if the packed geometry exceeds the 4 GB addressable by the buffer views.
+bool importGltfData(GltfSceneResource&       sceneResource,
+                    const tinygltf::Model&   model,
+                    nvvk::StagingUploader&   stagingUploader,
+                    bool                     importInstance = false,
+                    const GltfImportOptions& options        = {});
+
+// Same as above, the BIN chunk is streamed from the file mapping to the staging buffer.
+bool importGltfData(GltfSceneResource&       sceneResource,
+                    const GltfMappedModel&   mappedModel,
+                    nvvk::StagingUploader&   stagingUploader,
+                    bool                     importInstance = false,
+                    const GltfImportOptions& options        = {});
+
+// Same as above, with `buffersData[i]` providing the content of `model.buffers[i]`.
+// If `packedGeometry` is set, it receives the host view of the geometry uploaded to the device buffer.
+// With `asyncUploader`, the geometry is streamed in chunks through its staging ring instead of being copied at once
+// to the staging uploader: the staging memory never exceeds the size of the ring, whatever the size of the scene.
+// Without `stagingUploader`, the import runs on the host only (e.g. for the tools without a device): nothing is
+// uploaded, the gltfBuffer of the meshes is null and their geometry is read from `packedGeometry`.
+bool importGltfData(GltfSceneResource&                        sceneResource,
+                    const tinygltf::Model&                    model,
+                    std::span<const std::span<const uint8_t>> buffersData,
+                    nvvk::StagingUploader*                    stagingUploader,
+                    bool                                      importInstance = false,
+                    const GltfImportOptions&                  options        = {},
+                    GltfPackedGeometry*                       packedGeometry = nullptr,
+                    AsyncUploader*                            asyncUploader  = nullptr);
+
+// Hashes the geometry of the meshes [firstMesh, meshes.size()), all stored in one buffer whose host copy is `hostData`.
+// The hashes (meshHashes) key the BLAS cache and profile, the hashes already known (e.g. read from a cache file) are
+// given in `hashes`. With `deduplicate`, a mesh whose geometry is byte-identical to another mesh of the range becomes
+// an alias of it: it uses the same geometry range and BLAS, and the instances are redirected to the first mesh. The
+// meshes of other ranges are not compared, their data being no longer on the host. Meshes of the range already
+// registered without deduplication are registered again, with their hashes. Returns the number of aliased meshes.
+uint32_t registerMeshGeometries(GltfSceneResource&        sceneResource,
+                                uint32_t                  firstMesh,
+                                std::span<const uint8_t>  hostData,
+                                bool                      deduplicate,
+                                std::span<const uint64_t> hashes = {});
+uint32_t registerMeshGeometries(GltfSceneResource&        sceneResource,
+                                uint32_t                  firstMesh,
+                                const GltfPackedGeometry& packedGeometry,
+                                bool                      deduplicate);
+
+// Returns true if the elements of all the views of the mesh (and its dequantization transform) are in the first
+// `bufferSize` bytes of its buffer, e.g. to validate meshes read from a file.
+bool isMeshInBuffer(const shaderio::GltfMesh& mesh, VkDeviceSize bufferSize);
+
+// Suballocates `size` bytes of the geometry arena of the scene for a primitive mesh or an imported scene,
+// initializing the arena on first use. The allocation is recorded in `geometryAllocations`. With `ownBlock`, the range
+// is a block of its own, as needed for the data streamed by the AsyncUploader (see GeometryArena::allocateBlock).
+GeometryArena::Allocation allocateGeometry(GltfSceneResource&       sceneResource,
+                                           nvvk::ResourceAllocator* allocator,
+                                           VkDeviceSize             size,
+                                           bool                     ownBlock = false);
 
 // This is a utility function to create the scene info buffer.
 void createGltfSceneInfoBuffer(GltfSceneResource& sceneResource, nvvk::StagingUploader& stagingUploader);
 
 // This is a utility function to convert a primitive mesh to a GltfMeshResource.
-void primitiveMeshToResource(GltfSceneResource& sceneResource, nvvk::StagingUploader& stagingUploader, const nvutils::PrimitiveMesh& primMesh);
+// The triangle order is kept, but 16-bit indices are used when the mesh has at most 65536 vertices.
+void primitiveMeshToResource(GltfSceneResource&            sceneResource,
+                             nvvk::StagingUploader&        stagingUploader,
+                             const nvutils::PrimitiveMesh& primMesh);
 
 
 }  // namespace nvsamples
\ No newline at end of file
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "instance_conversion.hpp"
+
+#include <cassert>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define INSTANCE_CONVERSION_SSE 1
+#endif
+
+#include "nvutils/parallel_work.hpp"
+
+namespace {
+
+// Below this, the conversion is faster than waking up the worker threads
+constexpr size_t   kParallelThreshold = 16384;
+constexpr uint64_t kBatchSize         = 1024;
+
+// Row-major 3x4 of the column-major 4x4: the last row (0, 0, 0, 1) is dropped
+inline void packTransform(const glm::mat4& m, VkTransformMatrixKHR& transform)
+{
+#ifdef INSTANCE_CONVERSION_SSE
+  __m128 c0 = _mm_loadu_ps(&m[0][0]);
+  __m128 c1 = _mm_loadu_ps(&m[1][0]);
+  __m128 c2 = _mm_loadu_ps(&m[2][0]);
+  __m128 c3 = _mm_loadu_ps(&m[3][0]);
+  _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+  _mm_storeu_ps(transform.matrix[0], c0);
+  _mm_storeu_ps(transform.matrix[1], c1);
+  _mm_storeu_ps(transform.matrix[2], c2);
+#else
+  for(int row = 0; row < 3; row++)
+  {
+    for(int col = 0; col < 4; col++)
+    {
+      transform.matrix[row][col] = m[col][row];
+    }
+  }
+#endif
+}
+
+template <typename F>
+void forEachInstance(size_t count, F&& fn)
+{
+  if(count < kParallelThreshold)
+  {
+    for(size_t i = 0; i < count; i++)
+    {
+      fn(i);
+    }
+  }
+  else
+  {
+    nvutils::parallel_batches<kBatchSize>(count, [&](uint64_t i) { fn(size_t(i)); });
+  }
+}
+
+}  // namespace
+
+void nvsamples::convertInstances(std::span<const shaderio::GltfInstance>        instances,
+                                 const InstanceConversion&                      conversion,
+                                 std::span<VkAccelerationStructureInstanceKHR> output)
+{
+  assert(output.size() >= instances.size());
+  forEachInstance(instances.size(), [&](size_t i) {
+    const shaderio::GltfInstance& instance = instances[i];
+    assert(instance.meshIndex < conversion.blasSet.size());
+
+    VkAccelerationStructureInstanceKHR record;
+    packTransform(instance.transform, record.transform);
+    record.instanceCustomIndex                    = instance.meshIndex;
+    record.mask                                   = conversion.mask;
+    record.instanceShaderBindingTableRecordOffset = conversion.sbtRecordOffset;
+    record.flags                                  = conversion.flags;
+    record.accelerationStructureReference         = conversion.blasSet[instance.meshIndex].address;
+
+    // One write of the whole record, the bitfields are not read-modify-written in the (mapped) output
+    std::memcpy(&output[i], &record, sizeof(record));
+  });
+}
+
+void nvsamples::convertInstanceTransforms(std::span<const shaderio::GltfInstance>        instances,
+                                          std::span<VkAccelerationStructureInstanceKHR> output)
+{
+  assert(output.size() >= instances.size());
+  forEachInstance(instances.size(), [&](size_t i) { packTransform(instances[i].transform, output[i].transform); });
+}
+
+void nvsamples::computeNormalMatrices(std::span<const shaderio::GltfInstance> instances, std::span<glm::mat3> normalMatrices)
+{
+  assert(normalMatrices.size() >= instances.size());
+  forEachInstance(instances.size(), [&](size_t i) {
+    // The inverse transpose is the cofactor matrix over the determinant, cheaper than glm::inverse
+    const glm::mat4& m = instances[i].transform;
+    const glm::vec3  a(m[0]), b(m[1]), c(m[2]);
+    const glm::vec3  bc = glm::cross(b, c);
+    const float      invDet = 1.0f / glm::dot(a, bc);
+    normalMatrices[i] = glm::mat3(bc * invDet, glm::cross(c, a) * invDet, glm::cross(a, b) * invDet);
+  });
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <span>
+
+#include <glm/glm.hpp>
+#include <nvvk/acceleration_structures.hpp>
+
+#include "io_gltf.h"
+
+namespace nvsamples {
+
+//--------------------------------------------------------------------------------------------------
+// Batch conversion of the scene instances to TLAS instance records and normal matrices.
+//
+// The column-major 4x4 transforms are transposed to the row-major 3x4 of VkTransformMatrixKHR with SSE when
+// available, and large batches are split across the worker threads. Each record is assembled in registers and written
+// once, so `output` can point directly at mapped memory (e.g. a frame ring allocation or the instance buffer of the
+// TLAS), even when it is write-combined: the output is never read.
+//
+
+// How the records of convertInstances are filled, besides the transform
+struct InstanceConversion
+{
+  std::span<const nvvk::AccelerationStructure> blasSet;  // BLAS of each mesh, indexed by GltfInstance::meshIndex
+  VkGeometryInstanceFlagsKHR flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;  // Double sided
+  uint8_t                    mask  = 0xFF;
+  uint32_t                   sbtRecordOffset = 0;  // Same hit group for all the instances
+};
+
+// Writes one record per instance: its transform, the mesh index as custom index (gl_InstanceCustomIndexEXT) and the
+// address of the BLAS of the mesh. `output` holds at least as many records as `instances`.
+void convertInstances(std::span<const shaderio::GltfInstance>        instances,
+                      const InstanceConversion&                      conversion,
+                      std::span<VkAccelerationStructureInstanceKHR> output);
+
+// Only writes the transform of the records, the other members are left untouched
+void convertInstanceTransforms(std::span<const shaderio::GltfInstance> instances, std::span<VkAccelerationStructureInstanceKHR> output);
+
+// Normal matrices of the instances (inverse transpose of the upper 3x3 of the transform), for the raster path
+void computeNormalMatrices(std::span<const shaderio::GltfInstance> instances, std::span<glm::mat3> normalMatrices);
+
+}  // namespace nvsamples
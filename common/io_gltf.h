@@ -45,12 +45,23 @@
 #include "nvshaders/sky_io.h.slang"
 
 NAMESPACE_SHADERIO_BEGIN()
+// Storage format of the elements of a BufferView
+// The quantized formats are produced by the importer (see GltfImportOptions) and decoded in vertex_attributes.h.slang
+enum VertexFormat
+{
+  eVertexFormatFloat32 = 0,  // 32-bit floats (float2, float3 or float4 depending on the attribute)
+  eVertexFormatSnorm16 = 1,  // Positions: 4 x 16-bit snorm, dequantized with GltfMesh::dequantScale/dequantOffset
+  eVertexFormatOct16   = 2,  // Normals and tangents: octahedral 2 x 16-bit snorm, tangent sign in the lowest bit of y
+  eVertexFormatFloat16 = 3,  // Texture coordinates: 2 x 16-bit floats
+};
+
 // GLTF
 struct BufferView
 {
   uint32_t offset;      // Offset in the buffer where the data starts (in bytes)
   uint32_t count;       // Number of elements in the buffer view
   uint32_t byteStride;  // Stride in bytes between consecutive elements (0 if tightly packed)
+  uint32_t format;      // Storage format of the elements (VertexFormat)
 };
 
 struct TriangleMesh
@@ -76,7 +87,11 @@ struct GltfMesh
   uint8_t*     gltfBuffer = nullptr;  // Buffer to the data (index, position, normal, ...)
   TriangleMesh triMesh;               // Mesh data
   int          indexType;             // Index type (uint16_t or uint32_t)
+  uint32_t     dequantTransform;      // Offset of the VkTransformMatrixKHR dequantizing eVertexFormatSnorm16 positions, for the BLAS build
+  float3       dequantScale;          // Quantized positions: position = snorm * dequantScale + dequantOffset
+  float3       dequantOffset;         //
 };
+CHECK_STRUCT_ALIGNMENT(GltfMesh)
 
 enum GltfLightType
 {
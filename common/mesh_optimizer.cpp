@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace {
+
+// Size of the simulated vertex cache, a LRU of the most recently used vertices
+constexpr uint32_t kVertexCacheSize = 32;
+
+// Score of a vertex, the triangle with the highest sum of vertex scores is emitted next
+float getVertexScore(int32_t cachePosition, uint32_t remainingTriangles)
+{
+  if(remainingTriangles == 0)
+    return -1.0f;
+
+  float score = 0.0f;
+  if(cachePosition >= 0)
+  {
+    // The vertices of the last triangle get the same score, to not favor a particular strip direction
+    score = cachePosition < 3 ? 0.75f : std::pow(1.0f - float(cachePosition - 3) / float(kVertexCacheSize - 3), 1.5f);
+  }
+  // Favor the vertices with few remaining triangles, so they leave the cache for good
+  score += 2.0f / std::sqrt(float(remainingTriangles));
+  return score;
+}
+
+}  // namespace
+
+uint32_t nvsamples::removeDegenerateTriangles(std::vector<uint32_t>& indices, std::span<const glm::vec3> positions /*= {}*/)
+{
+  size_t numKept = 0;
+  for(size_t i = 0; i + 2 < indices.size(); i += 3)
+  {
+    const uint32_t a = indices[i + 0];
+    const uint32_t b = indices[i + 1];
+    const uint32_t c = indices[i + 2];
+    if(a == b || b == c || c == a)
+      continue;
+    if(!positions.empty())
+    {
+      const glm::vec3 n = glm::cross(positions[b] - positions[a], positions[c] - positions[a]);
+      if(n == glm::vec3(0.0f))
+        continue;
+    }
+    indices[numKept + 0] = a;
+    indices[numKept + 1] = b;
+    indices[numKept + 2] = c;
+    numKept += 3;
+  }
+  const uint32_t numRemoved = uint32_t((indices.size() - numKept) / 3);
+  indices.resize(numKept);
+  return numRemoved;
+}
+
+void nvsamples::optimizeVertexCache(std::span<uint32_t> indices, uint32_t vertexCount)
+{
+  const uint32_t numTriangles = uint32_t(indices.size() / 3);
+  if(numTriangles == 0)
+    return;
+
+  // Triangles using each vertex: vertexTriangles[triangleOffsets[v] .. triangleOffsets[v] + remaining[v]]
+  std::vector<uint32_t> triangleOffsets(vertexCount + 1, 0);
+  for(uint32_t index : indices)
+  {
+    assert(index < vertexCount);
+    triangleOffsets[index + 1]++;
+  }
+  for(uint32_t v = 0; v < vertexCount; v++)
+  {
+    triangleOffsets[v + 1] += triangleOffsets[v];
+  }
+  std::vector<uint32_t> remaining(vertexCount, 0);
+  std::vector<uint32_t> vertexTriangles(indices.size());
+  for(uint32_t t = 0; t < numTriangles * 3; t++)
+  {
+    const uint32_t v = indices[t];
+    vertexTriangles[triangleOffsets[v] + remaining[v]++] = t / 3;
+  }
+
+  std::vector<float> vertexScores(vertexCount);
+  for(uint32_t v = 0; v < vertexCount; v++)
+  {
+    vertexScores[v] = getVertexScore(-1, remaining[v]);
+  }
+
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+  std::vector<bool>     emitted(numTriangles, false);
+  std::vector<uint32_t> cache, newCache;
+  cache.reserve(kVertexCacheSize + 3);
+  newCache.reserve(kVertexCacheSize + 3);
+
+  uint32_t nextTriangle = 0;   // Scanning position when no cached vertex has a remaining triangle
+  int64_t  bestTriangle = -1;  // Best triangle using a cached vertex
+  while(result.size() < indices.size())
+  {
+    if(bestTriangle < 0)
+    {
+      while(emitted[nextTriangle])
+        nextTriangle++;
+      bestTriangle = nextTriangle;
+    }
+
+    const uint32_t  t   = uint32_t(bestTriangle);
+    const uint32_t* tri = &indices[t * 3];
+    emitted[t]          = true;
+    result.insert(result.end(), tri, tri + 3);
+
+    // Remove the triangle from the remaining triangles of its vertices
+    for(uint32_t k = 0; k < 3; k++)
+    {
+      const uint32_t v     = tri[k];
+      auto           begin = vertexTriangles.begin() + triangleOffsets[v];
+      auto           end   = begin + remaining[v];
+      std::iter_swap(std::find(begin, end, t), end - 1);
+      remaining[v]--;
+    }
+
+    // Move the vertices of the triangle to the front of the cache, the last entries are evicted
+    newCache.assign(tri, tri + 3);
+    for(uint32_t v : cache)
+    {
+      if(v != tri[0] && v != tri[1] && v != tri[2])
+        newCache.push_back(v);
+    }
+
+    // Update the scores of the touched vertices, and find the best triangle using a cached vertex
+    bestTriangle    = -1;
+    float bestScore = -1.0f;
+    for(uint32_t i = 0; i < newCache.size(); i++)
+    {
+      const uint32_t v = newCache[i];
+      vertexScores[v]  = getVertexScore(i < kVertexCacheSize ? int32_t(i) : -1, remaining[v]);
+    }
+    newCache.resize(std::min(newCache.size(), size_t(kVertexCacheSize)));
+    for(uint32_t v : newCache)
+    {
+      for(uint32_t j = 0; j < remaining[v]; j++)
+      {
+        const uint32_t  candidate = vertexTriangles[triangleOffsets[v] + j];
+        const uint32_t* c         = &indices[candidate * 3];
+        const float     score     = vertexScores[c[0]] + vertexScores[c[1]] + vertexScores[c[2]];
+        if(score > bestScore)
+        {
+          bestScore    = score;
+          bestTriangle = candidate;
+        }
+      }
+    }
+    std::swap(cache, newCache);
+  }
+
+  std::copy(result.begin(), result.end(), indices.begin());
+}
+
+std::vector<uint32_t> nvsamples::optimizeVertexFetch(std::span<uint32_t> indices, uint32_t vertexCount)
+{
+  constexpr uint32_t    kUnused = ~0U;
+  std::vector<uint32_t> remap(vertexCount, kUnused);
+  std::vector<uint32_t> vertexOrder;
+  vertexOrder.reserve(vertexCount);
+  for(uint32_t& index : indices)
+  {
+    assert(index < vertexCount);
+    if(remap[index] == kUnused)
+    {
+      remap[index] = uint32_t(vertexOrder.size());
+      vertexOrder.push_back(index);
+    }
+    index = remap[index];
+  }
+  return vertexOrder;
+}
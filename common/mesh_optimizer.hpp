@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+// Index buffer optimizations applied at import time, on triangle lists with 32-bit indices.
+// The usual order is: removeDegenerateTriangles, optimizeVertexCache, optimizeVertexFetch.
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace nvsamples {
+
+// Largest number of vertices that can be addressed with 16-bit indices, read as unsigned (uint16_t3) by the shaders
+constexpr uint32_t kMaxUint16IndexedVertices = 1 << 16;
+
+// Removes the triangles with a repeated index, or with a zero area when `positions` is not empty.
+// Returns the number of removed triangles.
+uint32_t removeDegenerateTriangles(std::vector<uint32_t>& indices, std::span<const glm::vec3> positions = {});
+
+// Reorders the triangles to improve the reuse of the post-transform vertex cache (Forsyth, "Linear-Speed Vertex Cache
+// Optimisation"). Triangles sharing vertices end up close to each other, which also helps the BLAS builder.
+void optimizeVertexCache(std::span<uint32_t> indices, uint32_t vertexCount);
+
+// Renumbers the vertices in the order of their first use by the indices, and rewrites the indices.
+// Returns the new vertex order: vertexOrder[newIndex] = oldIndex. Unreferenced vertices are dropped.
+std::vector<uint32_t> optimizeVertexFetch(std::span<uint32_t> indices, uint32_t vertexCount);
+
+}  // namespace nvsamples
@@ -55,4 +55,10 @@ inline static std::vector<std::filesystem::path> getShaderDirs()
   };
 }
 
+// Directory where the preprocessed data (scene cache, ...) is stored between runs
+inline static std::filesystem::path getCacheDir()
+{
+  return nvutils::getExecutablePath().parent_path() / "cache";
+}
+
 }  // namespace nvsamples
\ No newline at end of file
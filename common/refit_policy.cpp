@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "refit_policy.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+struct PointBounds
+{
+  glm::vec3 min{std::numeric_limits<float>::max()};
+  glm::vec3 max{-std::numeric_limits<float>::max()};
+
+  float diagonal() const { return min.x <= max.x ? glm::length(max - min) : 0.0f; }
+  float surfaceArea() const
+  {
+    if(min.x > max.x)
+      return 0.0f;
+    const glm::vec3 e = max - min;
+    return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+  }
+};
+
+PointBounds computeBounds(std::span<const glm::vec3> points)
+{
+  PointBounds bounds;
+  for(const glm::vec3& p : points)
+  {
+    bounds.min = glm::min(bounds.min, p);
+    bounds.max = glm::max(bounds.max, p);
+  }
+  return bounds;
+}
+
+}  // namespace
+
+void nvsamples::RefitPolicy::onRebuild(std::span<const glm::vec3> points /*= {}*/)
+{
+  const PointBounds bounds = computeBounds(points);
+  m_buildPoints.assign(points.begin(), points.end());
+  m_buildDiagonal    = bounds.diagonal();
+  m_buildSurfaceArea = bounds.surfaceArea();
+  m_baselineSum      = 0;
+  m_baselineCount    = 0;
+  m_traceAverage     = 0;
+  m_updateCount      = 0;
+  m_motion           = 0;
+  m_boundsGrowth     = 1;
+  m_traceGrowth      = 1;
+  m_reason           = nullptr;
+  m_rebuildCount++;
+}
+
+void nvsamples::RefitPolicy::onUpdate(std::span<const glm::vec3> points /*= {}*/)
+{
+  m_updateCount++;
+  if(!points.empty() && points.size() == m_buildPoints.size())
+  {
+    // Displacement from the build-time positions: what the hierarchy of the build no longer fits
+    float largest = 0;
+    for(size_t i = 0; i < points.size(); i++)
+    {
+      largest = std::max(largest, glm::length(points[i] - m_buildPoints[i]));
+    }
+    m_motion = m_buildDiagonal > 0.0f ? largest / m_buildDiagonal : 0.0f;
+
+    const float surfaceArea = computeBounds(points).surfaceArea();
+    m_boundsGrowth          = m_buildSurfaceArea > 0.0f ? surfaceArea / m_buildSurfaceArea : 1.0f;
+  }
+  evaluate();
+}
+
+void nvsamples::RefitPolicy::addTraceTime(double milliseconds)
+{
+  if(milliseconds <= 0.0)
+    return;
+
+  // The first frames after a rebuild give the reference cost
+  if(m_baselineCount < std::max(m_settings.baselineFrames, 1U))
+  {
+    m_baselineSum += milliseconds;
+    m_baselineCount++;
+    m_traceAverage = m_baselineSum / m_baselineCount;
+    return;
+  }
+
+  // Smoothed, a single slow frame does not trigger a rebuild
+  m_traceAverage += (milliseconds - m_traceAverage) * 0.1;
+  m_traceGrowth = float(m_traceAverage / (m_baselineSum / m_baselineCount));
+  evaluate();
+}
+
+void nvsamples::RefitPolicy::resetTraceBaseline()
+{
+  m_baselineSum   = 0;
+  m_baselineCount = 0;
+  m_traceAverage  = 0;
+  m_traceGrowth   = 1;
+  evaluate();
+}
+
+void nvsamples::RefitPolicy::evaluate()
+{
+  m_reason = nullptr;
+  if(m_settings.maxMotion > 0.0f && m_motion > m_settings.maxMotion)
+    m_reason = "motion";
+  else if(m_settings.maxBoundsGrowth > 0.0f && m_boundsGrowth > m_settings.maxBoundsGrowth)
+    m_reason = "bounds growth";
+  else if(m_settings.maxTraceGrowth > 0.0f && m_traceGrowth > m_settings.maxTraceGrowth)
+    m_reason = "trace cost";
+  else if(m_settings.maxUpdates > 0 && m_updateCount >= m_settings.maxUpdates)
+    m_reason = "update count";
+}
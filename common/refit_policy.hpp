@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace nvsamples {
+
+//--------------------------------------------------------------------------------------------------
+// Decides when an acceleration structure updated in place (refit) must be rebuilt instead.
+//
+// A refit keeps the hierarchy of the last build and only recomputes the bounds of its nodes: as the objects move away
+// from their build-time positions, the nodes overlap more and the traversal gets slower. The policy compares the state
+// since the last rebuild with the one at the rebuild, and asks for a rebuild when one of these crosses its threshold:
+// - motion:       largest displacement of a tracked point, relative to the diagonal of the build-time bounds
+// - bounds:       growth of the surface area of the bounds of the tracked points
+// - trace cost:   tracing time relative to the one measured over the first frames after the rebuild, or after the
+//                 last change of the traced view
+// - update count: number of refits, when the motion is not known on the host (e.g. deformed on the GPU)
+//
+class RefitPolicy
+{
+public:
+  struct Settings
+  {
+    float    maxMotion       = 0.25f;  // 0 to ignore
+    float    maxBoundsGrowth = 1.5f;   // 0 to ignore
+    float    maxTraceGrowth  = 1.2f;   // 0 to ignore
+    uint32_t maxUpdates      = 0;      // 0 to ignore
+    uint32_t baselineFrames  = 8;      // Frames averaged for the trace cost of a new build
+  };
+
+  void init(const Settings& settings) { m_settings = settings; }
+
+  // A full build was recorded with these points (empty when not tracked), the reference of the following refits
+  void onRebuild(std::span<const glm::vec3> points = {});
+  // New state before a refit, with the points in the same order as the ones of onRebuild: shouldRebuild() then tells
+  // whether to rebuild instead
+  void onUpdate(std::span<const glm::vec3> points = {});
+  // GPU time of the tracing of a frame using the acceleration structure
+  void addTraceTime(double milliseconds);
+  // The traced view changed (camera, resolution): the reference cost is measured again over the next frames
+  void resetTraceBaseline();
+
+  bool        shouldRebuild() const { return m_reason != nullptr; }
+  const char* getReason() const { return m_reason; }  // Threshold crossed, nullptr if none
+
+  uint32_t getUpdateCount() const { return m_updateCount; }
+  uint32_t getRebuildCount() const { return m_rebuildCount; }
+  float    getMotion() const { return m_motion; }
+  float    getBoundsGrowth() const { return m_boundsGrowth; }
+  float    getTraceGrowth() const { return m_traceGrowth; }
+
+  Settings& settings() { return m_settings; }
+
+private:
+  void evaluate();
+
+  Settings               m_settings;
+  std::vector<glm::vec3> m_buildPoints;
+  float                  m_buildDiagonal    = 0;
+  float                  m_buildSurfaceArea = 0;
+  double                 m_baselineSum      = 0;
+  uint32_t               m_baselineCount    = 0;
+  double                 m_traceAverage     = 0;
+  uint32_t               m_updateCount      = 0;
+  uint32_t               m_rebuildCount     = 0;
+  float                  m_motion           = 0;
+  float                  m_boundsGrowth     = 1;
+  float                  m_traceGrowth      = 1;
+  const char*            m_reason           = nullptr;
+};
+
+}  // namespace nvsamples
@@ -25,6 +25,7 @@
 // Derived classes should implement specific features and rendering logic for each tutorial step.
 //
 
+#include <fmt/format.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <imgui/imgui.h>
@@ -57,9 +58,19 @@
 #include <nvutils/parameter_parser.hpp>      // Parameter parser
 
 
-#include "common/gltf_utils.hpp"  // GLTF utilities for loading and importing GLTF models
-#include "common/utils.hpp"       // Common utilities for the sample application
-#include "common/path_utils.hpp"  // Path utilities for handling resources file paths
+#include "common/as_cache.hpp"             // On-disk cache of the bottom-level acceleration structures
+#include "common/async_uploader.hpp"       // Uploads on the transfer queue
+#include "common/blas_batch_builder.hpp"   // Batched builds of the bottom-level acceleration structures
+#include "common/blas_compactor.hpp"       // Compaction of the bottom-level acceleration structures
+#include "common/blas_profile.hpp"         // Per-scene choice of the BLAS build flags
+#include "common/cpu_raytracer.hpp"        // Ray tracing on the host, without ray tracing support
+#include "common/frame_ring.hpp"           // Staging ring for the per-frame uploads
+#include "common/gltf_utils.hpp"           // GLTF utilities for loading and importing GLTF models
+#include "common/instance_conversion.hpp"  // Batch conversion of the instances to TLAS instances
+#include "common/utils.hpp"                // Common utilities for the sample application
+#include "common/path_utils.hpp"           // Path utilities for handling resources file paths
+#include "common/texture_table.hpp"        // Bindless texture table
+#include "common/tlas_instances.hpp"       // Incremental uploads of the TLAS instances
 #include "slang.h"
 
 
@@ -78,6 +89,12 @@ public:
     eImgTonemapped
   };
 
+  // Queue of the application used by the AsyncUploader, requested by createVulkanContext
+  static constexpr uint32_t kTransferQueueIndex = 1;
+
+  // Alignment of the scene information slots in the frame ring, matching minUniformBufferOffsetAlignment on all GPUs
+  static constexpr VkDeviceSize kSceneInfoAlignment = 256;
+
   //-------------------------------------------------------------------------------
   // Virtual methods that must be overridden by derived classes
   //-------------------------------------------------------------------------------
@@ -141,6 +158,19 @@ public:
     // The VMA allocator is used for all allocations, the staging uploader will use it for staging buffers and images
     m_stagingUploader.init(&m_allocator, true);
 
+    // Large scene data can be streamed on the transfer queue, overlapping the file reads, see acquireAsyncUploads
+    m_asyncUploader.init(&m_allocator, app->getQueue(kTransferQueueIndex), app->getQueue(0).familyIndex, m_uploadStagingBudget);
+
+    // Without ray tracing the device has no acceleration structure extension, the buffers must not be build inputs
+    const VkBufferUsageFlags2 asInputBit = VK_BUFFER_USAGE_2_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR;
+    const VkBufferUsageFlags2 dropUsage  = m_cpuRaytracing ? asInputBit : 0;
+
+    // Data updated every frame is staged in the region of the frame in flight, without allocations in the frame loop
+    m_frameRing.init(&m_allocator, app->getFrameCycleSize(), nvsamples::FrameRing::kDefaultUsage & ~dropUsage);
+
+    // The geometry of the scenes created below goes in the arena, see allocateGeometry
+    m_sceneResource.geometryArena.init(&m_allocator, nvsamples::GeometryArena::kDefaultUsage & ~dropUsage);
+
     // Setting up the Slang compiler for hot reload shader
     m_slangCompiler.addSearchPaths(nvsamples::getShaderDirs());
     m_slangCompiler.defaultTarget();
@@ -167,6 +197,7 @@ public:
     createGBuffers(linearSampler);
 
     createScene();                        // Create the scene with a teapot and a plane
+    acquireAsyncUploads();                // Wait for the data streamed on the transfer queue
     createGraphicsDescriptorSetLayout();  // Create the descriptor set layout for the graphics pipeline
     createGraphicsPipelineLayout();       // Create the graphics pipeline layout
     updateTextures();                     // Update the textures in the descriptor set (if any)
@@ -177,28 +208,44 @@ public:
     // Initialize the tonemapper also with proe-compiled shader
     m_tonemapper.init(&m_allocator, std::span(tonemapper_slang));
 
-    // Get ray tracing properties
-    VkPhysicalDeviceProperties2 prop2{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2};
-    prop2.pNext = &m_rtProperties;
-    vkGetPhysicalDeviceProperties2(m_app->getPhysicalDevice(), &prop2);
+    if(m_cpuRaytracing)
+    {
+      // No acceleration structures nor ray tracing pipeline, the scene is traced on the host (see cpuRaytraceScene)
+      m_cpuRaytracer.init();
+      createCpuScene();
+    }
+    else
+    {
+      // Get ray tracing and acceleration structure properties
+      VkPhysicalDeviceProperties2 prop2{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2};
+      prop2.pNext          = &m_rtProperties;
+      m_rtProperties.pNext = &m_asProperties;
+      vkGetPhysicalDeviceProperties2(m_app->getPhysicalDevice(), &prop2);
 
-    // Initialize acceleration structure builder
-    m_asBuilder.init(&m_allocator, &m_stagingUploader, m_app->getQueue(0));
+      // Initialize acceleration structure builder
+      m_asBuilder.init(&m_allocator, &m_stagingUploader, m_app->getQueue(0));
 
-    // Initialize SBT generator
-    m_sbtGenerator.init(m_app->getDevice(), m_rtProperties);
+      // Initialize SBT generator
+      m_sbtGenerator.init(m_app->getDevice(), m_rtProperties);
 
 
-    // Set up acceleration structure infrastructure
-    createBottomLevelAS();  // Set up BLAS infrastructure
-    createTopLevelAS();     // Set up TLAS infrastructure
+      // Set up acceleration structure infrastructure
+      createBottomLevelAS();  // Set up BLAS infrastructure
+      createTopLevelAS();     // Set up TLAS infrastructure
 
-    // Set up ray tracing pipeline infrastructure
-    createRaytraceDescriptorLayout();  // Create descriptor layout
-    createRayTracingPipeline();        // Create pipeline structure and SBT
+      // Set up ray tracing pipeline infrastructure
+      createRaytraceDescriptorLayout();  // Create descriptor layout
+      createRayTracingPipeline();        // Create pipeline structure and SBT
+    }
 
     // Set up rasterization infrastructure (optional)
     createRasterizationShaders();  // Create rasterization shaders
+
+    // Comparing the BLAS variants needs the ray tracing pipeline
+    if(m_blasTuning == BlasTuning::eTune && !m_cpuRaytracing)
+    {
+      tuneBottomLevelAS();
+    }
   }
 
   //-------------------------------------------------------------------------------
@@ -214,6 +261,7 @@ public:
     // Base cleanup
     VkDevice device = m_app->getDevice();
 
+    m_textureTable.deinit();
     m_descPack.deinit();
     vkDestroyPipelineLayout(device, m_graphicPipelineLayout, nullptr);
 
@@ -221,10 +269,7 @@ public:
     m_allocator.destroyBuffer(m_sceneResource.bMeshes);
     m_allocator.destroyBuffer(m_sceneResource.bMaterials);
     m_allocator.destroyBuffer(m_sceneResource.bInstances);
-    for(auto& gltfData : m_sceneResource.bGltfDatas)
-    {
-      m_allocator.destroyBuffer(gltfData);
-    }
+    m_sceneResource.geometryArena.deinit();
     for(auto& texture : m_textures)
     {
       m_allocator.destroyImage(texture);
@@ -232,6 +277,8 @@ public:
 
     m_gBuffers.deinit();
     m_stagingUploader.deinit();
+    m_asyncUploader.deinit();
+    m_frameRing.deinit();
     m_skySimple.deinit();
     m_tonemapper.deinit();
     m_samplerPool.deinit();
@@ -242,9 +289,19 @@ public:
     m_rtDescPack.deinit();
     m_allocator.destroyBuffer(m_sbtBuffer);
 
-    m_asBuilder.deinitAccelerationStructures();
-    m_asBuilder.deinit();
-    m_sbtGenerator.deinit();
+    if(m_cpuRaytracing)
+    {
+      m_allocator.destroyBuffer(m_cpuImageBuffer);
+      m_cpuRaytracer.deinit();
+    }
+    else
+    {
+      releaseSharedBlas();
+      m_progressiveBlas.builder.deinit();
+      m_asBuilder.deinitAccelerationStructures();
+      m_asBuilder.deinit();
+      m_sbtGenerator.deinit();
+    }
 
     m_allocator.deinit();
   }
@@ -321,6 +378,13 @@ public:
         // Tonemapper settings
         nvgui::tonemapperWidget(m_tonemapperData);
       }
+      if(m_cpuRaytracing && ImGui::CollapsingHeader("CPU Ray Tracer"))
+      {
+        const nvsamples::CpuRaytracer::Stats& stats = m_cpuRaytracer.getStats();
+        ImGui::Text("Frame: %.2f ms", stats.renderTime);
+        ImGui::Text("Rays: %.2f Mrays/s", stats.renderTime > 0 ? double(stats.numRays) / (stats.renderTime * 1000.0) : 0.0);
+        ImGui::Text("Threads: %u, steals: %u", stats.numThreads, stats.numSteals);
+      }
       ImGui::Separator();
       PE::begin();
       modified |= PE::SliderFloat2("Metallic/Roughness Override", glm::value_ptr(m_metallicRoughnessOverride), -0.01f, 1.0f,
@@ -345,11 +409,36 @@ public:
   {
     NVVK_DBG_SCOPE(cmd);  // <-- Helps to debug in NSight
 
+    // Derived classes uploading data before calling this function have already started the frame
+    m_frameRing.beginFrame(m_app->getFrameCycleIndex());
+
+    // The staging buffers of the uploads that did not fit in the frame ring are released once their frame is done
+    if(m_stagingReleaseFrames > 0 && --m_stagingReleaseFrames == 0)
+    {
+      m_stagingUploader.releaseStaging();
+    }
+
+    // Building the next BLAS of the scene, if they are not all ready
+    if(m_progressiveBlas.numBuilt < m_progressiveBlas.inputs.size())
+    {
+      buildProgressiveBlas(cmd);
+    }
+
+    // Instances changed since the previous frame, the CPU ray tracer compares them itself
+    if(!m_cpuRaytracing && m_tlasInstances.isDirty())
+    {
+      cmdUpdateTopLevelAS(cmd);
+    }
+
     // Update the scene information buffer, this cannot be done in between dynamic rendering
     updateSceneBuffer(cmd);
 
     // Render scene (either rasterization or ray tracing)
-    if(m_useRayTracing)
+    if(m_useRayTracing && m_cpuRaytracing)
+    {
+      cpuRaytraceScene(cmd);  // Ray tracing on the host
+    }
+    else if(m_useRayTracing)
     {
       raytraceScene(cmd);  // Use ray tracing
     }
@@ -359,6 +448,8 @@ public:
     }
 
     postProcess(cmd);
+
+    m_frameRing.endFrame();
   }
 
   // Override to customize post-processing
@@ -386,7 +477,7 @@ public:
       ImGui::EndMenu();
     }
     reload |= ImGui::IsKeyPressed(ImGuiKey_F5);
-    if(reload)
+    if(reload && !m_cpuRaytracing)
     {
       vkQueueWaitIdle(m_app->getQueue(0).queue);
       createRayTracingPipeline();
@@ -398,6 +489,12 @@ public:
   {
     nvvk::addSurfaceExtensions(vkSetup.instanceExtensions);
 
+    // Additional queue, used by the AsyncUploader
+    if(vkSetup.queues.size() == kTransferQueueIndex)
+    {
+      vkSetup.queues.push_back(VK_QUEUE_TRANSFER_BIT);
+    }
+
     // Adding control on the validation layers
     nvvk::ValidationSettings validationSettings;
     validationSettings.setPreset(nvvk::ValidationSettings::LayerPresets::eStandard);
@@ -442,9 +539,11 @@ public:
 
   void createGraphicsDescriptorSetLayout()
   {
+    // Bindless textures: the array is as large as the device allows, textures are added and removed one slot at a time
+    const uint32_t maxTextures = nvsamples::TextureTable::getMaxTextureCount(m_app->getPhysicalDevice());
     m_bindings.addBinding({.binding         = shaderio::BindingPoints::eTextures,
                            .descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                           .descriptorCount = 10,
+                           .descriptorCount = maxTextures,
                            .stageFlags      = VK_SHADER_STAGE_ALL},
                           VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT
                               | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT);
@@ -453,6 +552,8 @@ public:
     NVVK_DBG_NAME(m_descPack.getLayout());
     NVVK_DBG_NAME(m_descPack.getPool());
     NVVK_DBG_NAME(m_descPack.getSet(0));
+
+    m_textureTable.init(m_app->getDevice(), m_descPack.getSet(0), shaderio::BindingPoints::eTextures, maxTextures);
   }
 
   //--------------------------------------------------------------------------------------------------
@@ -481,20 +582,30 @@ public:
 
 
   //--------------------------------------------------------------------------------------------------
-  // Update the textures: this is called when the scene is loaded
-  // Textures are updated in the descriptor set (0)
-  void updateTextures()
+  // The buffers streamed by m_asyncUploader during createScene are owned by the transfer queue: once the uploads
+  // are done, they are acquired by the graphics queue before the acceleration structures are built.
+  void acquireAsyncUploads()
   {
-    if(m_textures.empty())
+    const uint64_t uploadValue = m_asyncUploader.flush();
+    if(uploadValue == 0)
       return;
 
-    // Update the descriptor set with the textures
-    nvvk::WriteSetContainer write{};
-    VkWriteDescriptorSet    allTextures =
-        m_descPack.makeWrite(shaderio::BindingPoints::eTextures, 0, 1, uint32_t(m_textures.size()));
-    nvvk::Image* allImages = m_textures.data();
-    write.append(allTextures, allImages);
-    vkUpdateDescriptorSets(m_app->getDevice(), write.size(), write.data(), 0, nullptr);
+    VkCommandBuffer cmd = m_app->createTempCmdBuffer();
+    m_asyncUploader.cmdAcquire(cmd, uploadValue);
+    m_asyncUploader.wait(uploadValue);
+    m_app->submitAndWaitTempCmdBuffer(cmd);
+  }
+
+  //--------------------------------------------------------------------------------------------------
+  // Update the textures: this is called when the scene is loaded
+  // Only the textures appended to m_textures since the last call are written to the descriptor set (0),
+  // the slots of the first textures are 1, 2, ... matching the texture indices of the materials.
+  void updateTextures()
+  {
+    for(size_t i = m_textureSlots.size(); i < m_textures.size(); i++)
+    {
+      m_textureSlots.push_back(m_textureTable.add(m_textures[i].descriptor));
+    }
   }
 
   // This function is used to compile the Slang shader, and when it fails, it will use the pre-compiled shaders
@@ -521,7 +632,10 @@ public:
     return shaderCode;
   }
   //---------------------------------------------------------------------------------------------------------------
-  // The update of scene information buffer (UBO)
+  // The update of scene information
+  // The scene information of each frame in flight is written in its own slot of the frame ring, and the shaders find
+  // it through the push constant (getSceneInfoAddress): the CPU writes the next frame while the GPU reads the previous
+  // one, without a copy or a barrier. bSceneInfo, updated on the GPU timeline, is only used when the ring is full.
   //
   void updateSceneBuffer(VkCommandBuffer cmd)
   {
@@ -537,21 +651,65 @@ public:
     m_sceneResource.sceneInfo.meshes = (shaderio::GltfMesh*)m_sceneResource.bMeshes.address;  // Get the address of the mesh buffer
     m_sceneResource.sceneInfo.materials = (shaderio::GltfMetallicRoughness*)m_sceneResource.bMaterials.address;  // Get the address of the material buffer
 
+    // The slot of this frame is no longer read by the GPU, endFrame() flushes the host write before the submission
+    nvsamples::FrameRing::Allocation slot;
+    if(m_frameRing.allocate(sizeof(shaderio::GltfSceneInfo), slot, kSceneInfoAlignment))
+    {
+      std::memcpy(slot.data, &m_sceneResource.sceneInfo, sizeof(shaderio::GltfSceneInfo));
+      m_sceneInfoAddress = slot.address;
+      return;
+    }
+
     // Making sure the scene information buffer is updated before rendering
-    // Wait that the fragment shader is done reading the previous scene information and wait for the transfer to complete
-    nvvk::cmdBufferMemoryBarrier(cmd, {m_sceneResource.bSceneInfo.buffer, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+    // Wait that the shaders are done reading the previous scene information and wait for the transfer to complete
+    nvvk::cmdBufferMemoryBarrier(cmd, {m_sceneResource.bSceneInfo.buffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
                                        VK_PIPELINE_STAGE_2_TRANSFER_BIT});
     vkCmdUpdateBuffer(cmd, m_sceneResource.bSceneInfo.buffer, 0, sizeof(shaderio::GltfSceneInfo), &m_sceneResource.sceneInfo);
     nvvk::cmdBufferMemoryBarrier(cmd, {m_sceneResource.bSceneInfo.buffer, VK_PIPELINE_STAGE_2_TRANSFER_BIT,
-                                       VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT});
+                                       VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT});
+    m_sceneInfoAddress = m_sceneResource.bSceneInfo.address;
   }
 
+  // Address of the scene information of the current frame, to pass in the push constants
+  shaderio::GltfSceneInfo* getSceneInfoAddress() const { return (shaderio::GltfSceneInfo*)m_sceneInfoAddress; }
+
   void onLastHeadlessFrame() override
   {
     m_app->saveImageToFile(m_gBuffers.getColorImage(eImgTonemapped), m_gBuffers.getSize(),
                            nvutils::getExecutablePath().replace_extension(".jpg").string());
   }
 
+  // Compacts the bottom-level acceleration structures after their build, must be set before onAttach
+  void setCompactBlas(bool compact) { m_compactBlas = compact; }
+
+  // Loads the bottom-level acceleration structures from an on-disk cache when it was written by a previous run on the
+  // same device and driver, otherwise writes it after building them. Must be set before onAttach.
+  void setBlasCache(bool useCache) { m_blasCache = useCache; }
+
+  // Build flags of the bottom-level acceleration structures, see tuneBottomLevelAS. Must be set before onAttach.
+  enum class BlasTuning
+  {
+    eOff,          // PREFER_FAST_TRACE for all the BLAS
+    eLoadProfile,  // Variant of each BLAS from the profile written by a previous tuning, if any
+    eTune,         // Measures the variants of each BLAS and writes the profile
+  };
+  void setBlasTuning(BlasTuning tuning) { m_blasTuning = tuning; }
+
+  // Builds the bottom-level acceleration structures over the first frames, `trianglesPerFrame` at a time, instead of
+  // before the first frame. Only for the samples using the default createBottomLevelAS and createTopLevelAS, must be
+  // set before onAttach. Not combined with the compaction.
+  void setProgressiveBlas(bool progressive, uint32_t trianglesPerFrame = 1 << 20)
+  {
+    m_progressiveBlas.enabled           = progressive;
+    m_progressiveBlas.trianglesPerFrame = trianglesPerFrame;
+  }
+
+  // Traces the scene on the host instead of the ray tracing pipeline, for the devices without ray tracing support (see
+  // CpuRaytracer): no acceleration structure is created and the device does not need the ray tracing extensions.
+  // Shades like 05_shadow_miss, whatever the shaders of the sample, which is why only 05_shadow_miss exposes it
+  // (--cpuRaytracing). Must be set before onAttach.
+  void setCpuRaytracing(bool cpuRaytracing) { m_cpuRaytracing = cpuRaytracing; }
+
   // Accessor for camera manipulator
   std::shared_ptr<nvutils::CameraManipulator> getCameraManipulator() const { return m_cameraManip; }
 
@@ -576,6 +734,14 @@ public:
         .indexData    = {.deviceAddress = VkDeviceAddress(gltfMesh.gltfBuffer) + triMesh.indices.offset},
     };
 
+    // Quantized positions: R16G16B16A16_SNORM is a mandatory acceleration structure vertex format,
+    // and the dequantization transform stored with the mesh brings the vertices back to object space during the build
+    if(triMesh.positions.format == shaderio::eVertexFormatSnorm16)
+    {
+      triangles.vertexFormat  = VK_FORMAT_R16G16B16A16_SNORM;
+      triangles.transformData = {.deviceAddress = VkDeviceAddress(gltfMesh.gltfBuffer) + gltfMesh.dequantTransform};
+    }
+
     // Identify the above data as containing opaque triangles.
     result.geometry = VkAccelerationStructureGeometryKHR{
         .sType        = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
@@ -595,15 +761,506 @@ public:
   {
     SCOPED_TIMER(__FUNCTION__);
 
-    // Prepare geometry information for all meshes
-    std::vector<nvvk::AccelerationStructureGeometryInfo> geoInfos(m_sceneResource.meshes.size());
+    // Prepare geometry information for all meshes, aliased meshes use the BLAS of the mesh owning their geometry
+    std::vector<nvvk::AccelerationStructureGeometryInfo> geoInfos;
+    std::vector<uint32_t>                                blasIndices(m_sceneResource.meshes.size());
     for(uint32_t p_idx = 0; p_idx < m_sceneResource.meshes.size(); p_idx++)
     {
-      geoInfos[p_idx] = primitiveToGeometry(m_sceneResource.meshes[p_idx]);
+      const uint32_t geometryMesh = m_sceneResource.getGeometryMesh(p_idx);
+      if(geometryMesh != p_idx)
+      {
+        blasIndices[p_idx] = blasIndices[geometryMesh];
+        continue;
+      }
+      blasIndices[p_idx] = uint32_t(geoInfos.size());
+      geoInfos.push_back(primitiveToGeometry(m_sceneResource.meshes[p_idx]));
+    }
+
+    // The BLAS are built over the first frames instead, see buildProgressiveBlas
+    if(m_progressiveBlas.enabled)
+    {
+      prepareProgressiveBlas(geoInfos, blasIndices);
+      return;
+    }
+
+    // Build flags of each BLAS, from the profile of the scene when tuned
+    std::vector<VkBuildAccelerationStructureFlagsKHR> blasFlags(geoInfos.size(),
+                                                                VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR);
+    if(m_blasTuning != BlasTuning::eOff)
+    {
+      nvsamples::BlasProfile profile;
+      if(profile.load(nvsamples::BlasProfile::getFilename(nvsamples::getCacheDir(), m_sceneResource.meshHashes)))
+      {
+        for(uint32_t p_idx = 0; p_idx < m_sceneResource.meshes.size(); p_idx++)
+        {
+          const uint64_t geometryHash = p_idx < m_sceneResource.meshHashes.size() ? m_sceneResource.meshHashes[p_idx] : 0;
+          if(m_sceneResource.getGeometryMesh(p_idx) == p_idx && geometryHash != 0)
+          {
+            blasFlags[blasIndices[p_idx]] =
+                nvsamples::getBlasVariantFlags(profile.get(geometryHash, nvsamples::BlasVariant::eFastTrace));
+          }
+        }
+      }
+    }
+    if(m_compactBlas)
+    {
+      for(VkBuildAccelerationStructureFlagsKHR& flags : blasFlags)
+      {
+        flags |= VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR;
+      }
+    }
+
+    // Key of each BLAS in the on-disk cache, empty if the geometry of a mesh is not hashed
+    std::vector<uint64_t> blasKeys;
+    if(m_blasCache)
+    {
+      for(uint32_t p_idx = 0; p_idx < m_sceneResource.meshes.size(); p_idx++)
+      {
+        const uint64_t geometryHash = p_idx < m_sceneResource.meshHashes.size() ? m_sceneResource.meshHashes[p_idx] : 0;
+        if(m_sceneResource.getGeometryMesh(p_idx) != p_idx)
+          continue;
+        if(geometryHash == 0)
+        {
+          blasKeys.clear();
+          break;
+        }
+        const nvvk::AccelerationStructureGeometryInfo& geoInfo = geoInfos[blasIndices[p_idx]];
+        blasKeys.push_back(nvsamples::AccelerationStructureCache::makeBlasKey(geometryHash, blasFlags[blasIndices[p_idx]],
+                                                                              geoInfo.geometry, geoInfo.rangeInfo));
+      }
+    }
+    if(!blasKeys.empty() && loadBottomLevelAS(blasKeys))
+    {
+      shareBlas(blasIndices);
+      return;
+    }
+
+    // The BLAS built with the same flags go through the builder of the tutorials, otherwise they are built in batches
+    auto sameFlags = [&](VkBuildAccelerationStructureFlagsKHR flags) { return flags == blasFlags[0]; };
+    if(std::ranges::all_of(blasFlags, sameFlags))
+    {
+      m_asBuilder.blasSubmitBuildAndWait(geoInfos, blasFlags.empty() ? 0 : blasFlags[0]);
+    }
+    else
+    {
+      buildBottomLevelAS(geoInfos, blasFlags);
+    }
+
+    // Compacting the BLAS which allow it
+    std::vector<nvvk::AccelerationStructure> compactedSet;
+    for(size_t i = 0; i < blasFlags.size(); i++)
+    {
+      if(blasFlags[i] & VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR)
+        compactedSet.push_back(m_asBuilder.blasSet[i]);
+    }
+    if(!compactedSet.empty())
+    {
+      compactBottomLevelAS(compactedSet);
+      for(size_t i = 0, c = 0; i < blasFlags.size(); i++)
+      {
+        if(blasFlags[i] & VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR)
+          m_asBuilder.blasSet[i] = compactedSet[c++];
+      }
+    }
+
+    if(!blasKeys.empty())
+    {
+      saveBottomLevelAS(blasKeys);
+    }
+    shareBlas(blasIndices);
+  }
+
+  //---------------------------------------------------------------------------------------------------------------
+  // On-disk cache of the BLAS, see setBlasCache
+  // The BLAS are deserialized from the cache file written by a previous run on the same device and driver, instead of
+  // being built. Returns false on a cache miss.
+  bool loadBottomLevelAS(std::span<const uint64_t> blasKeys)
+  {
+    SCOPED_TIMER(__FUNCTION__);
+    nvsamples::AccelerationStructureCache cache;
+    cache.init(&m_allocator, m_app->getPhysicalDevice(), nvsamples::getCacheDir());
+
+    std::vector<nvvk::AccelerationStructure> blasSet(blasKeys.size());
+    VkCommandBuffer                          cmd    = m_app->createTempCmdBuffer();
+    const bool                               loaded = cache.cmdLoad(cmd, blasKeys, blasSet);
+    m_app->submitAndWaitTempCmdBuffer(cmd);
+    if(loaded)
+    {
+      m_asBuilder.blasSet = std::move(blasSet);
+    }
+    cache.deinit();
+    return loaded;
+  }
+
+  // Writes the built (and compacted) BLAS to the on-disk cache
+  void saveBottomLevelAS(std::span<const uint64_t> blasKeys)
+  {
+    SCOPED_TIMER(__FUNCTION__);
+    nvsamples::AccelerationStructureCache cache;
+    cache.init(&m_allocator, m_app->getPhysicalDevice(), nvsamples::getCacheDir());
+
+    VkCommandBuffer cmd = m_app->createTempCmdBuffer();
+    cache.cmdQuerySizes(cmd, m_asBuilder.blasSet);
+    m_app->submitAndWaitTempCmdBuffer(cmd);
+
+    cmd = m_app->createTempCmdBuffer();
+    cache.cmdSerialize(cmd, m_asBuilder.blasSet);
+    m_app->submitAndWaitTempCmdBuffer(cmd);
+
+    cache.save(blasKeys);
+    cache.deinit();
+  }
+
+  //---------------------------------------------------------------------------------------------------------------
+  // Builds the BLAS with their own flags, see setBlasTuning
+  void buildBottomLevelAS(std::span<const nvvk::AccelerationStructureGeometryInfo> geoInfos,
+                          std::span<const VkBuildAccelerationStructureFlagsKHR>     blasFlags)
+  {
+    std::vector<nvsamples::BlasBatchBuilder::Input> inputs(geoInfos.size());
+    for(size_t i = 0; i < geoInfos.size(); i++)
+    {
+      inputs[i] = {.geometry = geoInfos[i].geometry, .rangeInfo = geoInfos[i].rangeInfo, .flags = blasFlags[i]};
+    }
+
+    nvsamples::BlasBatchBuilder builder;
+    builder.init(&m_allocator, m_asProperties.minAccelerationStructureScratchOffsetAlignment);
+    m_asBuilder.blasSet.assign(geoInfos.size(), {});
+    VkCommandBuffer cmd = m_app->createTempCmdBuffer();
+    builder.cmdCreateAndBuild(cmd, inputs, m_asBuilder.blasSet);
+    m_app->submitAndWaitTempCmdBuffer(cmd);
+    builder.deinit();
+  }
+
+  //---------------------------------------------------------------------------------------------------------------
+  // Replaces the built BLAS by compacted copies, see setCompactBlas
+  // The BLAS must have been built with VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR.
+  void compactBottomLevelAS(std::span<nvvk::AccelerationStructure> blasSet)
+  {
+    SCOPED_TIMER(__FUNCTION__);
+    nvsamples::BlasCompactor compactor;
+    compactor.init(&m_allocator);
+
+    VkCommandBuffer cmd = m_app->createTempCmdBuffer();
+    compactor.cmdQuerySizes(cmd, blasSet);
+    m_app->submitAndWaitTempCmdBuffer(cmd);
+
+    cmd = m_app->createTempCmdBuffer();
+    compactor.cmdCompact(cmd, blasSet);
+    m_app->submitAndWaitTempCmdBuffer(cmd);
+
+    compactor.destroyOriginals();
+    compactor.deinit();
+  }
+
+  // Number of rebuilds per frame of the BLAS of a mesh, weighting its build time in tuneBottomLevelAS
+  virtual float getBlasRebuildsPerFrame(uint32_t /*meshIndex*/) const { return 0.0f; }
+
+  //---------------------------------------------------------------------------------------------------------------
+  // BLAS tuning, see setBlasTuning
+  // Each variant of each BLAS (see nvsamples::BlasVariant) is built and swapped in the TLAS, then the frame is ray
+  // traced a few times from the initial camera. The cost of a variant is its tracing time, plus its build time for the
+  // geometry rebuilt every frame (see getBlasRebuildsPerFrame); the smallest variant within kCostTolerance of the
+  // lowest cost is kept for the mesh and written in the profile of the scene, loaded by the next runs.
+  // Only for the samples using the default createBottomLevelAS and createTopLevelAS.
+  void tuneBottomLevelAS()
+  {
+    SCOPED_TIMER(__FUNCTION__);
+    if(m_progressiveBlas.enabled || m_tlasInstances.size() != m_sceneResource.instances.size()
+       || m_asBuilder.blasSet.size() != m_sceneResource.meshes.size())
+    {
+      LOGW("BLAS tuning needs the default createBottomLevelAS and createTopLevelAS, without progressive building\n");
+      return;
+    }
+
+    constexpr uint32_t kTraceCount    = 8;     // Traces of the frame for each variant, the fastest one is kept
+    constexpr double   kCostTolerance = 0.02;  // Relative cost difference under which the smallest variant is preferred
+    constexpr uint32_t kNumVariants   = uint32_t(nvsamples::BlasVariant::eCount);
+    VkDevice           device         = m_app->getDevice();
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(m_app->getPhysicalDevice(), &properties);
+    const double msPerTick = properties.limits.timestampPeriod * 1e-6;
+
+    const VkQueryPoolCreateInfo queryPoolInfo{
+        .sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType  = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = kTraceCount + 1,
+    };
+    VkQueryPool queryPool{};
+    NVVK_CHECK(vkCreateQueryPool(device, &queryPoolInfo, nullptr, &queryPool));
+    NVVK_DBG_NAME(queryPool);
+
+    // Records `record` `count` times in a frame with a timestamp after each one, returns the fastest one in ms
+    auto measure = [&](uint32_t count, const auto& record) {
+      VkCommandBuffer cmd = m_app->createTempCmdBuffer();
+      m_frameRing.beginFrame(m_app->getFrameCycleIndex());
+      vkCmdResetQueryPool(cmd, queryPool, 0, count + 1);
+      vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, queryPool, 0);
+      for(uint32_t i = 0; i < count; i++)
+      {
+        record(cmd);
+        vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, queryPool, i + 1);
+      }
+      m_frameRing.endFrame();
+      m_app->submitAndWaitTempCmdBuffer(cmd);
+
+      std::array<uint64_t, kTraceCount + 1> ticks{};
+      NVVK_CHECK(vkGetQueryPoolResults(device, queryPool, 0, count + 1, sizeof(ticks), ticks.data(), sizeof(uint64_t),
+                                       VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+      double fastest = std::numeric_limits<double>::max();
+      for(uint32_t i = 0; i < count; i++)
+      {
+        fastest = std::min(fastest, double(ticks[i + 1] - ticks[i]) * msPerTick);
+      }
+      return fastest;
+    };
+
+    // The BLAS of a mesh is shared by the meshes aliasing its geometry
+    auto setMeshBlas = [&](uint32_t geometryMesh, const nvvk::AccelerationStructure& blas) {
+      for(uint32_t meshIndex = 0; meshIndex < m_sceneResource.meshes.size(); meshIndex++)
+      {
+        if(m_sceneResource.getGeometryMesh(meshIndex) == geometryMesh)
+          m_asBuilder.blasSet[meshIndex] = blas;
+      }
+      updateInstanceReferences();
+      VkCommandBuffer cmd = m_app->createTempCmdBuffer();
+      m_frameRing.beginFrame(m_app->getFrameCycleIndex());
+      cmdUpdateTopLevelAS(cmd, true);
+      m_frameRing.endFrame();
+      m_app->submitAndWaitTempCmdBuffer(cmd);
+    };
+
+    nvsamples::BlasBatchBuilder builder;
+    builder.init(&m_allocator, m_asProperties.minAccelerationStructureScratchOffsetAlignment);
+    nvsamples::BlasProfile profile;
+
+    for(uint32_t meshIndex = 0; meshIndex < m_sceneResource.meshes.size(); meshIndex++)
+    {
+      const uint64_t geometryHash = meshIndex < m_sceneResource.meshHashes.size() ? m_sceneResource.meshHashes[meshIndex] : 0;
+      if(m_sceneResource.getGeometryMesh(meshIndex) != meshIndex || geometryHash == 0)
+        continue;
+
+      // Geometry rebuilt every frame cannot wait for the compacted size on the host
+      const float rebuildsPerFrame = getBlasRebuildsPerFrame(meshIndex);
+      const nvvk::AccelerationStructureGeometryInfo geoInfo = primitiveToGeometry(m_sceneResource.meshes[meshIndex]);
+
+      struct Candidate
+      {
+        nvvk::AccelerationStructure blas;
+        double                      buildTime = 0;
+        double                      traceTime = 0;
+        double                      cost      = std::numeric_limits<double>::max();
+      };
+      std::array<Candidate, kNumVariants> candidates{};
+      nvvk::AccelerationStructure         original = m_asBuilder.blasSet[meshIndex];
+      for(uint32_t v = 0; v < kNumVariants; v++)
+      {
+        const nvsamples::BlasVariant variant = nvsamples::BlasVariant(v);
+        if(variant == nvsamples::BlasVariant::eCompacted && rebuildsPerFrame > 0.0f)
+          continue;
+
+        Candidate&                                candidate = candidates[v];
+        const nvsamples::BlasBatchBuilder::Input input{.geometry  = geoInfo.geometry,
+                                                       .rangeInfo = geoInfo.rangeInfo,
+                                                       .flags     = nvsamples::getBlasVariantFlags(variant)};
+        candidate.buildTime = measure(1, [&](VkCommandBuffer cmd) {
+          builder.cmdCreateAndBuild(cmd, std::span(&input, 1), std::span(&candidate.blas, 1));
+        });
+        if(variant == nvsamples::BlasVariant::eCompacted)
+        {
+          compactBottomLevelAS(std::span(&candidate.blas, 1));
+        }
+
+        setMeshBlas(meshIndex, candidate.blas);
+        candidate.traceTime = measure(kTraceCount, [&](VkCommandBuffer cmd) {
+          updateSceneBuffer(cmd);
+          raytraceScene(cmd);
+        });
+        candidate.cost = candidate.traceTime + rebuildsPerFrame * candidate.buildTime;
+      }
+
+      // The smallest of the variants close to the lowest cost
+      double lowestCost = std::numeric_limits<double>::max();
+      for(const Candidate& candidate : candidates)
+      {
+        lowestCost = std::min(lowestCost, candidate.cost);
+      }
+      uint32_t best = 0;
+      for(uint32_t v = 0; v < kNumVariants; v++)
+      {
+        if(candidates[v].cost <= lowestCost * (1.0 + kCostTolerance)
+           && (candidates[best].cost > lowestCost * (1.0 + kCostTolerance)
+               || candidates[v].blas.buffer.bufferSize < candidates[best].blas.buffer.bufferSize))
+        {
+          best = v;
+        }
+      }
+
+      std::string report;
+      for(uint32_t v = 0; v < kNumVariants; v++)
+      {
+        if(candidates[v].blas.accel == VK_NULL_HANDLE)
+          continue;
+        report += fmt::format("\n  {:<10} trace {:.3f} ms, build {:.3f} ms, {:.2f} MB{}",
+                              nvsamples::getBlasVariantName(nvsamples::BlasVariant(v)), candidates[v].traceTime,
+                              candidates[v].buildTime, candidates[v].blas.buffer.bufferSize / (1024.0 * 1024.0),
+                              v == best ? " <-" : "");
+      }
+      LOGI("BLAS tuning: mesh %u, %u triangles%s\n", meshIndex, geoInfo.rangeInfo.primitiveCount, report.c_str());
+
+      // Keeping the chosen variant for the mesh, in place of the BLAS it was built with
+      setMeshBlas(meshIndex, candidates[best].blas);
+      for(uint32_t v = 0; v < kNumVariants; v++)
+      {
+        if(v != best)
+          m_allocator.destroyAcceleration(candidates[v].blas);
+      }
+      m_allocator.destroyAcceleration(original);
+      profile.set(geometryHash, nvsamples::BlasVariant(best));
+    }
+
+    builder.deinit();
+    vkDestroyQueryPool(device, queryPool, nullptr);
+
+    const std::filesystem::path profileFilename =
+        nvsamples::BlasProfile::getFilename(nvsamples::getCacheDir(), m_sceneResource.meshHashes);
+    if(profile.save(profileFilename))
+    {
+      LOGI("BLAS profile saved: %s\n", nvutils::utf8FromPath(profileFilename).c_str());
+    }
+  }
+
+  //---------------------------------------------------------------------------------------------------------------
+  // Progressive BLAS building, see setProgressiveBlas
+  // No BLAS is built before the first frame: each frame builds the next ones, up to a budget of triangles, and
+  // rebuilds the TLAS. The instances of the BLAS not built yet have a null reference, which makes them inactive.
+  void prepareProgressiveBlas(std::span<const nvvk::AccelerationStructureGeometryInfo> geoInfos, std::span<const uint32_t> blasIndices)
+  {
+    m_progressiveBlas.inputs.resize(geoInfos.size());
+    for(size_t i = 0; i < geoInfos.size(); i++)
+    {
+      m_progressiveBlas.inputs[i] = {.geometry = geoInfos[i].geometry, .rangeInfo = geoInfos[i].rangeInfo};
     }
+    m_progressiveBlas.blasSet.assign(geoInfos.size(), {});
+    m_progressiveBlas.blasIndices.assign(blasIndices.begin(), blasIndices.end());
+    m_progressiveBlas.numBuilt = 0;
+    m_progressiveBlas.builder.init(&m_allocator, m_asProperties.minAccelerationStructureScratchOffsetAlignment);
 
-    // Build the bottom-level acceleration structures
-    m_asBuilder.blasSubmitBuildAndWait(geoInfos, VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR);
+    // One empty entry per mesh until its BLAS is built
+    m_asBuilder.blasSet.assign(blasIndices.size(), {});
+  }
+
+  void buildProgressiveBlas(VkCommandBuffer cmd)
+  {
+    NVVK_DBG_SCOPE(cmd);  // <-- Helps to debug in NSight
+    ProgressiveBlas& progressive = m_progressiveBlas;
+
+    // The next BLAS fitting in the budget of the frame, at least one
+    const uint32_t first = progressive.numBuilt;
+    uint32_t       last  = first;
+    uint64_t       numTriangles = 0;
+    while(last < progressive.inputs.size()
+          && (last == first || numTriangles + progressive.inputs[last].rangeInfo.primitiveCount <= progressive.trianglesPerFrame))
+    {
+      numTriangles += progressive.inputs[last].rangeInfo.primitiveCount;
+      last++;
+    }
+
+    // The previous frames may still trace the TLAS and read its instances
+    nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                           VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR | VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+
+    progressive.builder.cmdCreateAndBuild(cmd, std::span(progressive.inputs).subspan(first, last - first),
+                                          std::span(progressive.blasSet).subspan(first, last - first));
+    progressive.numBuilt = last;
+
+    // Making the new BLAS visible to the meshes using them, and to their instances
+    for(size_t meshIndex = 0; meshIndex < progressive.blasIndices.size(); meshIndex++)
+    {
+      m_asBuilder.blasSet[meshIndex] = progressive.blasSet[progressive.blasIndices[meshIndex]];
+    }
+
+    // Rebuilding the TLAS with the instances whose BLAS is ready, an update cannot activate instances
+    updateInstanceReferences();
+    cmdUpdateTopLevelAS(cmd, true);
+
+    if(progressive.numBuilt == progressive.inputs.size())
+    {
+      LOGI("Progressive BLAS: %zu BLAS built\n", progressive.inputs.size());
+    }
+  }
+
+  //---------------------------------------------------------------------------------------------------------------
+  // Points the instances of the default createTopLevelAS to the current BLAS of their mesh
+  void updateInstanceReferences()
+  {
+    for(uint32_t i = 0; i < m_tlasInstances.size(); i++)
+    {
+      m_tlasInstances.setReference(i, m_asBuilder.blasSet[m_sceneResource.instances[i].meshIndex].address);
+    }
+  }
+
+  //---------------------------------------------------------------------------------------------------------------
+  // Uploads the instances changed in m_tlasInstances and updates the TLAS in place, or rebuilds it when `rebuild` is
+  // set or when it was not built with ALLOW_UPDATE. Only the changed instances are copied, see TlasInstanceManager.
+  // The instances are uploaded through the frame ring, the frame must have been started.
+  void cmdUpdateTopLevelAS(VkCommandBuffer cmd, bool rebuild = false)
+  {
+    NVVK_DBG_SCOPE(cmd);  // <-- Helps to debug in NSight
+
+    // The previous frames may still trace the TLAS and read its instances
+    nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                           VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR | VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+    if(m_tlasInstances.cmdUpload(cmd, m_asBuilder.tlasInstancesBuffer, m_frameRing, m_stagingUploader))
+    {
+      // The application waits for this frame before reusing its slot, a frame cycle later. One more frame, as derived
+      // classes can update the TLAS before RtBase::onRender counts the frame.
+      m_stagingReleaseFrames = m_app->getFrameCycleSize() + 1;
+    }
+
+    if(m_asBuilder.tlasScratchBuffer.buffer == VK_NULL_HANDLE)
+    {
+      NVVK_CHECK(m_allocator.createBuffer(m_asBuilder.tlasScratchBuffer, m_asBuilder.tlasBuildData.sizeInfo.buildScratchSize,
+                                          VK_BUFFER_USAGE_2_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT,
+                                          VMA_MEMORY_USAGE_AUTO, {}, m_asProperties.minAccelerationStructureScratchOffsetAlignment));
+      NVVK_DBG_NAME(m_asBuilder.tlasScratchBuffer.buffer);
+    }
+    if(rebuild || !m_tlasInstances.allowsUpdate())
+    {
+      m_asBuilder.tlasBuildData.cmdBuildAccelerationStructure(cmd, m_asBuilder.tlas.accel, m_asBuilder.tlasScratchBuffer.address);
+    }
+    else
+    {
+      m_asBuilder.tlasBuildData.cmdUpdateAccelerationStructure(cmd, m_asBuilder.tlas.accel, m_asBuilder.tlasScratchBuffer.address);
+    }
+    nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+  }
+
+  //---------------------------------------------------------------------------------------------------------------
+  // Expands the built BLAS to one entry per mesh: blasSet[meshIndex] = built BLAS blasIndices[meshIndex].
+  // Several entries can then share the same acceleration structure, see releaseSharedBlas.
+  void shareBlas(std::span<const uint32_t> blasIndices)
+  {
+    std::vector<nvvk::AccelerationStructure> blasSet(blasIndices.size());
+    for(size_t i = 0; i < blasIndices.size(); i++)
+    {
+      blasSet[i] = m_asBuilder.blasSet[blasIndices[i]];
+    }
+    m_asBuilder.blasSet = std::move(blasSet);
+  }
+
+  //---------------------------------------------------------------------------------------------------------------
+  // Clears the BLAS entries shared with a previous mesh, so that each acceleration structure is destroyed once
+  void releaseSharedBlas()
+  {
+    for(size_t i = 0; i < m_asBuilder.blasSet.size(); i++)
+    {
+      const uint32_t geometryMesh = m_sceneResource.getGeometryMesh(uint32_t(i));
+      if(geometryMesh != i && m_asBuilder.blasSet[i].accel == m_asBuilder.blasSet[geometryMesh].accel)
+      {
+        m_asBuilder.blasSet[i] = {};
+      }
+    }
   }
 
 
@@ -614,25 +1271,17 @@ public:
   {
     SCOPED_TIMER(__FUNCTION__);
 
-    // Prepare instance data for TLAS
-    std::vector<VkAccelerationStructureInstanceKHR> tlasInstances;
-    tlasInstances.reserve(m_sceneResource.instances.size());
-    const VkGeometryInstanceFlagsKHR flags{VK_GEOMETRY_INSTANCE_TRIANGLE_CULL_DISABLE_BIT_NV};
-
-    for(const shaderio::GltfInstance& instance : m_sceneResource.instances)
-    {
-      VkAccelerationStructureInstanceKHR ray_inst{};
-      ray_inst.transform           = nvvk::toTransformMatrixKHR(instance.transform);  // Position of the instance
-      ray_inst.instanceCustomIndex = instance.meshIndex;                              // gl_InstanceCustomIndexEXT
-      ray_inst.accelerationStructureReference         = m_asBuilder.blasSet[instance.meshIndex].address;
-      ray_inst.instanceShaderBindingTableRecordOffset = 0;  // We will use the same hit group for all objects
-      ray_inst.flags                                  = flags;
-      ray_inst.mask                                   = 0xFF;
-      tlasInstances.emplace_back(ray_inst);
-    }
+    // Prepare instance data for TLAS: position of the instance, mesh index as gl_InstanceCustomIndexEXT and the same
+    // hit group for all objects
+    std::vector<VkAccelerationStructureInstanceKHR> tlasInstances(m_sceneResource.instances.size());
+    nvsamples::convertInstances(m_sceneResource.instances, {.blasSet = m_asBuilder.blasSet}, tlasInstances);
 
     // Build the top-level acceleration structure
-    m_asBuilder.tlasSubmitBuildAndWait(tlasInstances, VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR);
+    const VkBuildAccelerationStructureFlagsKHR buildFlags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+    m_asBuilder.tlasSubmitBuildAndWait(tlasInstances, buildFlags);
+
+    // Kept to update the TLAS as the instances or the BLAS change, see cmdUpdateTopLevelAS
+    m_tlasInstances.assign(tlasInstances, buildFlags);
   }
 
   //--------------------------------------------------------------------------------------------------
@@ -738,7 +1387,7 @@ public:
     vkCmdPushDescriptorSetKHR(cmd, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_rtPipelineLayout, 1, write.size(), write.data());
 
     // Push constant information, see usage later
-    m_pushValues.sceneInfoAddress = (shaderio::GltfSceneInfo*)m_sceneResource.bSceneInfo.address;  // Pass the address of the scene information buffer to the shader
+    m_pushValues.sceneInfoAddress = getSceneInfoAddress();  // Pass the address of the scene information of this frame to the shader
     m_pushValues.metallicRoughnessOverride = m_metallicRoughnessOverride;  // Override the metallic and roughness values
 
     const VkPushConstantsInfo pushInfo{.sType      = VK_STRUCTURE_TYPE_PUSH_CONSTANTS_INFO,
@@ -758,6 +1407,83 @@ public:
     nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
   }
 
+  //---------------------------------------------------------------------------------------------------------------
+  // Reads the geometry of the scene back to the host once, to build the BVH of the CPU ray tracer
+  void createCpuScene()
+  {
+    SCOPED_TIMER(__FUNCTION__);
+    const nvsamples::GeometryArena& arena = m_sceneResource.geometryArena;
+
+    std::vector<nvvk::Buffer> readbackBuffers(arena.getBlockCount());
+    VkCommandBuffer           cmd = m_app->createTempCmdBuffer();
+    for(uint32_t block = 0; block < arena.getBlockCount(); block++)
+    {
+      const nvvk::Buffer& blockBuffer = arena.getBuffer(block);
+      NVVK_CHECK(m_allocator.createBuffer(readbackBuffers[block], blockBuffer.bufferSize, VK_BUFFER_USAGE_2_TRANSFER_DST_BIT,
+                                          VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+                                          VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT));
+      NVVK_DBG_NAME(readbackBuffers[block].buffer);
+      const VkBufferCopy region{.size = blockBuffer.bufferSize};
+      vkCmdCopyBuffer(cmd, blockBuffer.buffer, readbackBuffers[block].buffer, 1, &region);
+    }
+    nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_PIPELINE_STAGE_2_HOST_BIT);
+    m_app->submitAndWaitTempCmdBuffer(cmd);
+
+    for(nvvk::Buffer& buffer : readbackBuffers)
+    {
+      vmaInvalidateAllocation(m_allocator, buffer.allocation, 0, VK_WHOLE_SIZE);
+    }
+    m_cpuRaytracer.createScene(m_sceneResource, [&](uint32_t meshIndex) {
+      const nvvk::Buffer& buffer = readbackBuffers[m_sceneResource.meshToBufferIndex[meshIndex]];
+      return static_cast<const uint8_t*>(buffer.mapping) + m_sceneResource.getMeshBufferOffset(meshIndex);
+    });
+
+    // The CPU ray tracer keeps its own copy of the geometry
+    for(nvvk::Buffer& buffer : readbackBuffers)
+    {
+      m_allocator.destroyBuffer(buffer);
+    }
+  }
+
+  //---------------------------------------------------------------------------------------------------------------
+  // Ray tracing on the host: the image is rendered in the region of the frame of a mapped buffer, then copied where
+  // the ray tracing pipeline writes it, for the tonemapper
+  void cpuRaytraceScene(VkCommandBuffer cmd)
+  {
+    NVVK_DBG_SCOPE(cmd);  // <-- Helps to debug in NSight
+
+    const VkExtent2D   size       = m_gBuffers.getSize();
+    const VkDeviceSize regionSize = VkDeviceSize(size.width) * size.height * sizeof(glm::vec4);
+    const VkDeviceSize totalSize  = regionSize * m_app->getFrameCycleSize();
+    if(m_cpuImageBuffer.bufferSize < totalSize)
+    {
+      // The other frames in flight may still copy from the buffer
+      NVVK_CHECK(vkQueueWaitIdle(m_app->getQueue(0).queue));
+      m_allocator.destroyBuffer(m_cpuImageBuffer);
+      NVVK_CHECK(m_allocator.createBuffer(m_cpuImageBuffer, totalSize, VK_BUFFER_USAGE_2_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+                                          VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT));
+      NVVK_DBG_NAME(m_cpuImageBuffer.buffer);
+    }
+
+    // The region of this frame is no longer read by the GPU, see FrameRing
+    const VkDeviceSize regionOffset = regionSize * m_app->getFrameCycleIndex();
+    glm::vec4*         image = reinterpret_cast<glm::vec4*>(static_cast<uint8_t*>(m_cpuImageBuffer.mapping) + regionOffset);
+    m_cpuRaytracer.render(m_sceneResource, m_metallicRoughnessOverride, {size.width, size.height}, image);
+    vmaFlushAllocation(m_allocator, m_cpuImageBuffer.allocation, regionOffset, regionSize);
+
+    // The previous frame tonemapped the image
+    nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+    const VkBufferImageCopy region{
+        .bufferOffset     = regionOffset,
+        .imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .layerCount = 1},
+        .imageExtent      = {size.width, size.height, 1},
+    };
+    vkCmdCopyBufferToImage(cmd, m_cpuImageBuffer.buffer, m_gBuffers.getColorImage(eImgRendered), VK_IMAGE_LAYOUT_GENERAL, 1, &region);
+
+    // Barrier to make sure the image is ready for Tonemapping
+    nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+  }
+
   //---------------------------------------------------------------------------------------------------------------
   // Rasterization rendering method (base implementation)
   // This provides basic rasterization support for tutorials that need G-buffer generation
@@ -827,7 +1553,7 @@ public:
 
     // Push constant information
     shaderio::TutoPushConstant pushValues{
-        .sceneInfoAddress          = (shaderio::GltfSceneInfo*)m_sceneResource.bSceneInfo.address,
+        .sceneInfoAddress          = getSceneInfoAddress(),
         .metallicRoughnessOverride = m_metallicRoughnessOverride,
     };
     const VkPushConstantsInfo pushInfo{
@@ -839,6 +1565,12 @@ public:
         .pValues    = &pushValues,
     };
 
+    // The meshes share the blocks of the geometry arena: the index buffer is only bound when the block or the index
+    // type changes, and the draws start at the first index of the mesh
+    VkBuffer    boundIndexBuffer = VK_NULL_HANDLE;
+    VkIndexType boundIndexType   = VK_INDEX_TYPE_MAX_ENUM;
+    m_normalMatrices.resize(m_sceneResource.instances.size());
+    nvsamples::computeNormalMatrices(m_sceneResource.instances, m_normalMatrices);
     for(size_t i = 0; i < m_sceneResource.instances.size(); i++)
     {
       uint32_t                      meshIndex = m_sceneResource.instances[i].meshIndex;
@@ -846,19 +1578,24 @@ public:
       const shaderio::TriangleMesh& triMesh   = gltfMesh.triMesh;
 
       // Push constant is information that is passed to the shader at each draw call.
-      pushValues.normalMatrix  = glm::transpose(glm::inverse(glm::mat3(m_sceneResource.instances[i].transform)));
+      pushValues.normalMatrix  = m_normalMatrices[i];
       pushValues.instanceIndex = int(i);  // The index of the instance in the m_instances vector
       vkCmdPushConstants2(cmd, &pushInfo);
 
       // Get the buffer directly using the pre-computed mapping
-      uint32_t            bufferIndex = m_sceneResource.meshToBufferIndex[meshIndex];
-      const nvvk::Buffer& v           = m_sceneResource.bGltfDatas[bufferIndex];
-
-      // Bind index buffers
-      vkCmdBindIndexBuffer(cmd, v.buffer, triMesh.indices.offset, VkIndexType(gltfMesh.indexType));
+      const nvvk::Buffer& v         = m_sceneResource.getMeshBuffer(meshIndex);
+      const VkIndexType   indexType = VkIndexType(gltfMesh.indexType);
+      if(v.buffer != boundIndexBuffer || indexType != boundIndexType)
+      {
+        vkCmdBindIndexBuffer(cmd, v.buffer, 0, indexType);
+        boundIndexBuffer = v.buffer;
+        boundIndexType   = indexType;
+      }
 
-      // Draw the mesh
-      vkCmdDrawIndexed(cmd, triMesh.indices.count, 1, 0, 0, 0);  // All indices
+      // Draw the mesh, the index offset is aligned to the index size
+      const VkDeviceSize indexOffset = m_sceneResource.getMeshBufferOffset(meshIndex) + triMesh.indices.offset;
+      const uint32_t     indexSize   = indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4;
+      vkCmdDrawIndexed(cmd, triMesh.indices.count, 1, uint32_t(indexOffset / indexSize), 0, 0);  // All indices
     }
 
     // ** END RENDERING **
@@ -882,6 +1619,28 @@ protected:
   nvapp::Application*     m_app{};             // The application framework
   nvvk::ResourceAllocator m_allocator{};       // Resource allocator for Vulkan resources, used for buffers and images
   nvvk::StagingUploader  m_stagingUploader{};  // Utility to upload data to the GPU, used for staging buffers and images
+  nvsamples::AsyncUploader m_asyncUploader{};  // Streams buffers on the transfer queue, see acquireAsyncUploads
+  VkDeviceSize m_uploadStagingBudget = VkDeviceSize(64) << 20;  // Size of the staging ring of m_asyncUploader, set before onAttach
+  nvsamples::FrameRing   m_frameRing{};        // Staging memory of the per-frame uploads, see FrameRing
+  VkDeviceAddress        m_sceneInfoAddress{};  // Scene information of the current frame, see updateSceneBuffer
+  uint32_t m_stagingReleaseFrames = 0;  // Frames before releasing the staging buffers of m_stagingUploader, see onRender
+  bool                   m_compactBlas = false;  // Compact the BLAS after their build, see compactBottomLevelAS
+  bool                   m_blasCache   = false;  // Load or save the BLAS through the on-disk cache, see loadBottomLevelAS
+  BlasTuning             m_blasTuning  = BlasTuning::eOff;  // Build flags of each BLAS, see tuneBottomLevelAS
+  nvsamples::TlasInstanceManager m_tlasInstances;  // Instances of the TLAS, uploaded when changed, see cmdUpdateTopLevelAS
+  std::vector<glm::mat3>         m_normalMatrices;  // Of each instance, for the rasterization
+
+  // Progressive BLAS building, see setProgressiveBlas
+  struct ProgressiveBlas
+  {
+    bool                                            enabled           = false;
+    uint32_t                                        trianglesPerFrame = 1 << 20;  // Build budget of a frame
+    std::vector<nvsamples::BlasBatchBuilder::Input> inputs;       // Geometry of each BLAS, in build order
+    std::vector<nvvk::AccelerationStructure>        blasSet;      // BLAS, the first `numBuilt` are built
+    std::vector<uint32_t>                           blasIndices;  // BLAS of each mesh
+    uint32_t                                        numBuilt = 0;
+    nvsamples::BlasBatchBuilder                     builder;
+  } m_progressiveBlas;
   nvvk::SamplerPool      m_samplerPool{};      // Texture sampler pool, used to acquire texture samplers for images
   nvvk::GBuffer          m_gBuffers{};         // The G-Buffer
   nvslang::SlangCompiler m_slangCompiler{};    // The Slang compiler used to compile the shaders
@@ -905,6 +1664,8 @@ protected:
   // Scene information buffer (UBO)
   nvsamples::GltfSceneResource m_sceneResource{};  // The GLTF scene resource, contains all the buffers and data for the scene
   std::vector<nvvk::Image> m_textures{};           // Textures used in the scene
+  nvsamples::TextureTable  m_textureTable{};       // Bindless table of the textures, in descriptor set (0)
+  std::vector<uint32_t>    m_textureSlots{};       // Slot of each texture in the table
 
   nvshaders::SkySimple     m_skySimple{};       // Sky rendering
   nvshaders::Tonemapper    m_tonemapper{};      // Tonemapper for post-processing effects
@@ -924,6 +1685,12 @@ protected:
   nvvk::SBTGenerator                m_sbtGenerator;  // Shader binding table wrapper
   nvvk::Buffer                      m_sbtBuffer;     // Buffer for shader binding table
 
+  // Ray tracing on the host, see setCpuRaytracing
+  bool                    m_cpuRaytracing = false;
+  nvsamples::CpuRaytracer m_cpuRaytracer;
+  nvvk::Buffer            m_cpuImageBuffer;  // Image rendered on the host, one region per frame in flight
+
   // Ray Tracing Properties
   VkPhysicalDeviceRayTracingPipelinePropertiesKHR m_rtProperties{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_PROPERTIES_KHR};
+  VkPhysicalDeviceAccelerationStructurePropertiesKHR m_asProperties{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR};
 };
\ No newline at end of file
@@ -0,0 +1,421 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "sah_bvh.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+
+#include "nvutils/parallel_work.hpp"
+
+namespace {
+
+// Nodes with more primitives are split with parallel binning, the smaller ones are the roots of the parallel subtrees
+constexpr uint32_t kParallelNodeSize = 1 << 14;
+// Primitives binned by each worker thread
+constexpr uint32_t kBinningBlockSize = 1 << 14;
+
+using nvsamples::BvhBounds;
+using Node     = nvsamples::SahBvh::Node;
+using Settings = nvsamples::SahBvh::Settings;
+
+struct Bin
+{
+  BvhBounds bounds;
+  uint32_t  count = 0;
+};
+
+struct Split
+{
+  int      axis = -1;  // -1: no split found, all the centroids are at the same place
+  uint32_t bin  = 0;   // First bin of the right child
+  float    cost = FLT_MAX;
+};
+
+class Builder
+{
+public:
+  Builder(std::span<const BvhBounds> primitiveBounds, std::vector<uint32_t>& indices, const Settings& settings)
+      : m_bounds(primitiveBounds)
+      , m_indices(indices)
+      , m_settings(settings)
+      , m_centroids(primitiveBounds.size())
+  {
+    nvutils::parallel_batches<4096>(m_bounds.size(), [&](uint64_t i) { m_centroids[i] = m_bounds[i].getCenter(); });
+  }
+
+  // Splits nodes[nodeIndex], at `depth` in the tree, if worth it. Its children are added at the end of `nodes`.
+  // Returns false for a leaf.
+  bool splitNode(std::vector<Node>& nodes, uint32_t nodeIndex, uint32_t depth, bool parallel)
+  {
+    const uint32_t first = nodes[nodeIndex].first;
+    const uint32_t count = nodes[nodeIndex].count;
+    if(count <= 1)
+      return false;
+
+    const BvhBounds centroidBounds = getCentroidBounds(first, count, parallel);
+    if(depth >= kMedianSplitDepth)
+    {
+      return count > m_settings.maxLeafSize && splitMedian(nodes, nodeIndex, centroidBounds, parallel);
+    }
+    const Split split = findSplit(first, count, nodes[nodeIndex].bounds, centroidBounds, parallel);
+
+    // A small node stays a leaf when no split is cheaper than intersecting all its primitives
+    const float leafCost = m_settings.intersectionCost * float(count);
+    if(count <= m_settings.maxLeafSize && (split.axis < 0 || split.cost >= leafCost))
+      return false;
+
+    uint32_t leftCount = count / 2;  // Centroids at the same place: halved
+    if(split.axis >= 0)
+    {
+      const int   axis  = split.axis;
+      const float scale = float(m_settings.numBins) / (centroidBounds.max[axis] - centroidBounds.min[axis]);
+      const auto  begin = m_indices.begin() + first;
+      const auto  mid   = std::partition(begin, begin + count, [&](uint32_t prim) {
+        return getBin(m_centroids[prim][axis], centroidBounds.min[axis], scale) < split.bin;
+      });
+      leftCount         = uint32_t(mid - begin);
+      if(leftCount == 0 || leftCount == count)
+        leftCount = count / 2;
+    }
+
+    addChildren(nodes, nodeIndex, leftCount, parallel);
+    return true;
+  }
+
+  // Builds the whole subtree of nodes[rootIndex], at `rootDepth` in the tree, on the calling thread
+  void buildSubtree(std::vector<Node>& nodes, uint32_t rootIndex, uint32_t rootDepth)
+  {
+    std::vector<std::pair<uint32_t, uint32_t>> stack{{rootIndex, rootDepth}};  // Node and depth
+    while(!stack.empty())
+    {
+      const auto [nodeIndex, depth] = stack.back();
+      stack.pop_back();
+      if(splitNode(nodes, nodeIndex, depth, false))
+      {
+        stack.emplace_back(nodes[nodeIndex].first, depth + 1);
+        stack.emplace_back(nodes[nodeIndex].first + 1, depth + 1);
+      }
+    }
+  }
+
+  BvhBounds getBounds(uint32_t first, uint32_t count, bool parallel) const
+  {
+    return reduceBounds(first, count, parallel, [&](uint32_t prim) -> const BvhBounds& { return m_bounds[prim]; });
+  }
+
+private:
+  // Below kMedianSplitDepth, the nodes are halved at the median centroid of their widest axis: the primitive count,
+  // below 2^32, is at most 1 after 32 halvings, and no leaf is deeper than SahBvh::kMaxDepth
+  static constexpr uint32_t kMedianSplitDepth = nvsamples::SahBvh::kMaxDepth - 32;
+
+  bool splitMedian(std::vector<Node>& nodes, uint32_t nodeIndex, const BvhBounds& centroidBounds, bool parallel)
+  {
+    const glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+    const int       axis   = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+    const auto      begin  = m_indices.begin() + nodes[nodeIndex].first;
+    const uint32_t  count  = nodes[nodeIndex].count;
+    std::nth_element(begin, begin + count / 2, begin + count,
+                     [&](uint32_t a, uint32_t b) { return m_centroids[a][axis] < m_centroids[b][axis]; });
+    addChildren(nodes, nodeIndex, count / 2, parallel);
+    return true;
+  }
+
+  // Turns nodes[nodeIndex] into an inner node, its first `leftCount` primitives going to the left child
+  void addChildren(std::vector<Node>& nodes, uint32_t nodeIndex, uint32_t leftCount, bool parallel)
+  {
+    const uint32_t first      = nodes[nodeIndex].first;
+    const uint32_t leftIndex  = uint32_t(nodes.size());
+    const uint32_t rightCount = nodes[nodeIndex].count - leftCount;
+    nodes.push_back({.bounds = getBounds(first, leftCount, parallel), .first = first, .count = leftCount});
+    nodes.push_back(
+        {.bounds = getBounds(first + leftCount, rightCount, parallel), .first = first + leftCount, .count = rightCount});
+    nodes[nodeIndex].first = leftIndex;
+    nodes[nodeIndex].count = 0;
+  }
+
+  uint32_t getBin(float centroid, float minimum, float scale) const
+  {
+    return std::min(uint32_t(std::max((centroid - minimum) * scale, 0.0f)), m_settings.numBins - 1);
+  }
+
+  BvhBounds getCentroidBounds(uint32_t first, uint32_t count, bool parallel) const
+  {
+    return reduceBounds(first, count, parallel, [&](uint32_t prim) {
+      const glm::vec3& c = m_centroids[prim];
+      return BvhBounds{c, c};
+    });
+  }
+
+  // Union of the bounds returned by `get` for the primitives [first, first + count), by blocks of kBinningBlockSize
+  template <typename F>
+  BvhBounds reduceBounds(uint32_t first, uint32_t count, bool parallel, const F& get) const
+  {
+    auto reduceBlock = [&](uint32_t blockFirst, uint32_t blockCount) {
+      BvhBounds bounds;
+      for(uint32_t i = blockFirst; i < blockFirst + blockCount; i++)
+        bounds.grow(get(m_indices[i]));
+      return bounds;
+    };
+    if(!parallel || count <= kBinningBlockSize)
+      return reduceBlock(first, count);
+
+    const uint32_t         numBlocks = (count + kBinningBlockSize - 1) / kBinningBlockSize;
+    std::vector<BvhBounds> blockBounds(numBlocks);
+    nvutils::parallel_batches<1>(numBlocks, [&](uint64_t b) {
+      const uint32_t blockFirst = first + uint32_t(b) * kBinningBlockSize;
+      blockBounds[b]            = reduceBlock(blockFirst, std::min(kBinningBlockSize, first + count - blockFirst));
+    });
+    BvhBounds bounds;
+    for(const BvhBounds& b : blockBounds)
+      bounds.grow(b);
+    return bounds;
+  }
+
+  // Lowest SAH cost among the planes between the bins, on the three axes
+  Split findSplit(uint32_t first, uint32_t count, const BvhBounds& nodeBounds, const BvhBounds& centroidBounds, bool parallel) const
+  {
+    const uint32_t numBins = m_settings.numBins;
+    glm::vec3      scale(0.0f);
+    for(int axis = 0; axis < 3; axis++)
+    {
+      const float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+      scale[axis]        = extent > 0.0f ? float(numBins) / extent : 0.0f;
+    }
+
+    // The bins of the three axes, filled by blocks of primitives and summed
+    auto fillBins = [&](uint32_t blockFirst, uint32_t blockCount, std::vector<Bin>& bins) {
+      bins.assign(3 * numBins, {});
+      for(uint32_t i = blockFirst; i < blockFirst + blockCount; i++)
+      {
+        const uint32_t   prim     = m_indices[i];
+        const glm::vec3& centroid = m_centroids[prim];
+        for(int axis = 0; axis < 3; axis++)
+        {
+          Bin& bin = bins[axis * numBins + getBin(centroid[axis], centroidBounds.min[axis], scale[axis])];
+          bin.bounds.grow(m_bounds[prim]);
+          bin.count++;
+        }
+      }
+    };
+
+    std::vector<Bin> bins;
+    if(!parallel || count <= kBinningBlockSize)
+    {
+      fillBins(first, count, bins);
+    }
+    else
+    {
+      const uint32_t                numBlocks = (count + kBinningBlockSize - 1) / kBinningBlockSize;
+      std::vector<std::vector<Bin>> blockBins(numBlocks);
+      nvutils::parallel_batches<1>(numBlocks, [&](uint64_t b) {
+        const uint32_t blockFirst = first + uint32_t(b) * kBinningBlockSize;
+        fillBins(blockFirst, std::min(kBinningBlockSize, first + count - blockFirst), blockBins[b]);
+      });
+      bins.assign(3 * numBins, {});
+      for(const std::vector<Bin>& block : blockBins)
+      {
+        for(size_t i = 0; i < bins.size(); i++)
+        {
+          bins[i].bounds.grow(block[i].bounds);
+          bins[i].count += block[i].count;
+        }
+      }
+    }
+
+    // Sweeping the planes: areas and counts of the left side from the left, of the right side from the right
+    Split             best;
+    const float       invArea = 1.0f / std::max(nodeBounds.getArea(), FLT_MIN);
+    std::vector<float> rightCost(numBins);
+    for(int axis = 0; axis < 3; axis++)
+    {
+      if(scale[axis] == 0.0f)
+        continue;
+      const Bin* axisBins = &bins[axis * numBins];
+
+      BvhBounds right;
+      uint32_t  rightCount = 0;
+      for(uint32_t b = numBins - 1; b > 0; b--)
+      {
+        right.grow(axisBins[b].bounds);
+        rightCount += axisBins[b].count;
+        rightCost[b] = right.getArea() * float(rightCount);
+      }
+
+      BvhBounds left;
+      uint32_t  leftCount = 0;
+      for(uint32_t b = 1; b < numBins; b++)
+      {
+        left.grow(axisBins[b - 1].bounds);
+        leftCount += axisBins[b - 1].count;
+        if(leftCount == 0 || leftCount == count)
+          continue;
+        const float cost = m_settings.traversalCost
+                           + m_settings.intersectionCost * (left.getArea() * float(leftCount) + rightCost[b]) * invArea;
+        if(cost < best.cost)
+          best = {.axis = axis, .bin = b, .cost = cost};
+      }
+    }
+    return best;
+  }
+
+  std::span<const BvhBounds> m_bounds;
+  std::vector<uint32_t>&     m_indices;
+  const Settings&            m_settings;
+  std::vector<glm::vec3>     m_centroids;
+};
+
+}  // namespace
+
+void nvsamples::SahBvh::build(std::span<const BvhBounds> primitiveBounds, const Settings& settings)
+{
+  assert(settings.numBins >= 2 && settings.maxLeafSize >= 1);
+  m_settings = settings;
+  m_nodes.clear();
+  m_primitiveIndices.resize(primitiveBounds.size());
+  std::iota(m_primitiveIndices.begin(), m_primitiveIndices.end(), 0U);
+  if(primitiveBounds.empty())
+    return;
+
+  Builder builder(primitiveBounds, m_primitiveIndices, m_settings);
+  m_nodes.reserve(2 * primitiveBounds.size());
+  const uint32_t numPrimitives = uint32_t(primitiveBounds.size());
+  m_nodes.push_back({.bounds = builder.getBounds(0, numPrimitives, true), .first = 0, .count = numPrimitives});
+
+  // Top of the tree: the large nodes are split one after the other, each with all the threads
+  std::vector<std::pair<uint32_t, uint32_t>> subtreeRoots;  // Node and depth
+  std::vector<std::pair<uint32_t, uint32_t>> stack{{0, 0}};
+  while(!stack.empty())
+  {
+    const auto [nodeIndex, depth] = stack.back();
+    stack.pop_back();
+    if(m_nodes[nodeIndex].count <= kParallelNodeSize)
+    {
+      subtreeRoots.emplace_back(nodeIndex, depth);
+    }
+    else if(builder.splitNode(m_nodes, nodeIndex, depth, true))
+    {
+      stack.emplace_back(m_nodes[nodeIndex].first, depth + 1);
+      stack.emplace_back(m_nodes[nodeIndex].first + 1, depth + 1);
+    }
+  }
+
+  // Bottom of the tree: one subtree per thread, the subtrees own disjoint ranges of the primitive indices
+  std::vector<std::vector<Node>> subtrees(subtreeRoots.size());
+  nvutils::parallel_batches<1>(subtreeRoots.size(), [&](uint64_t i) {
+    subtrees[i] = {m_nodes[subtreeRoots[i].first]};
+    builder.buildSubtree(subtrees[i], 0, subtreeRoots[i].second);
+  });
+
+  // Appending the subtrees, their root replaces the node they were built from
+  for(size_t i = 0; i < subtrees.size(); i++)
+  {
+    const std::vector<Node>& subtree = subtrees[i];
+    const uint32_t           offset  = uint32_t(m_nodes.size()) - 1;  // Local node 0 is not copied
+    for(size_t n = 0; n < subtree.size(); n++)
+    {
+      Node node = subtree[n];
+      if(node.count == 0)
+        node.first += offset;
+      if(n == 0)
+        m_nodes[subtreeRoots[i].first] = node;
+      else
+        m_nodes.push_back(node);
+    }
+  }
+}
+
+nvsamples::SahBvh::Stats nvsamples::SahBvh::getStats() const
+{
+  Stats stats;
+  if(m_nodes.empty())
+    return stats;
+
+  const double rootArea = std::max(double(m_nodes[0].bounds.getArea()), double(FLT_MIN));
+  uint32_t     numInner = 0;
+  uint64_t     sumDepth = 0;
+
+  std::vector<std::pair<uint32_t, uint32_t>> stack{{0, 0}};  // Node and depth
+  while(!stack.empty())
+  {
+    const auto [nodeIndex, depth] = stack.back();
+    stack.pop_back();
+    const Node&  node = m_nodes[nodeIndex];
+    const double area = double(node.bounds.getArea()) / rootArea;
+    stats.nodeCount++;
+    stats.maxDepth = std::max(stats.maxDepth, depth);
+
+    if(node.count > 0)
+    {
+      stats.sahCost += m_settings.intersectionCost * node.count * area;
+      stats.leafCount++;
+      sumDepth += depth;
+      if(stats.leafSizeHistogram.size() <= node.count)
+        stats.leafSizeHistogram.resize(node.count + 1);
+      stats.leafSizeHistogram[node.count]++;
+      continue;
+    }
+
+    const Node&     left    = m_nodes[node.first];
+    const Node&     right   = m_nodes[node.first + 1];
+    const BvhBounds overlap = left.bounds.intersect(right.bounds);
+    stats.sahCost += m_settings.traversalCost * area;
+    stats.overlapCost += double(overlap.getArea()) / rootArea;
+    stats.averageOverlap += double(overlap.getArea()) / std::max(double(node.bounds.getArea()), double(FLT_MIN));
+    numInner++;
+    stack.push_back({node.first, depth + 1});
+    stack.push_back({node.first + 1, depth + 1});
+  }
+
+  stats.averageOverlap   = numInner > 0 ? stats.averageOverlap / numInner : 0.0;
+  stats.averageLeafDepth = double(sumDepth) / stats.leafCount;
+  return stats;
+}
+
+void nvsamples::SahBvh::query(const BvhBounds&          bounds,
+                              std::span<const BvhBounds> primitiveBounds,
+                              std::vector<uint32_t>&     result) const
+{
+  result.clear();
+  auto overlaps = [&](const BvhBounds& b) { return !bounds.intersect(b).isEmpty(); };
+  if(m_nodes.empty() || !overlaps(m_nodes[0].bounds))
+    return;
+
+  std::vector<uint32_t> stack{0};
+  while(!stack.empty())
+  {
+    const Node& node = m_nodes[stack.back()];
+    stack.pop_back();
+    if(node.count > 0)
+    {
+      for(uint32_t i = node.first; i < node.first + node.count; i++)
+      {
+        if(overlaps(primitiveBounds[m_primitiveIndices[i]]))
+          result.push_back(m_primitiveIndices[i]);
+      }
+      continue;
+    }
+    for(uint32_t child = node.first; child < node.first + 2; child++)
+    {
+      if(overlaps(m_nodes[child].bounds))
+        stack.push_back(child);
+    }
+  }
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <cfloat>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace nvsamples {
+
+// Axis aligned bounding box of the BVH nodes and primitives
+struct BvhBounds
+{
+  glm::vec3 min{FLT_MAX};
+  glm::vec3 max{-FLT_MAX};
+
+  void grow(const glm::vec3& p)
+  {
+    min = glm::min(min, p);
+    max = glm::max(max, p);
+  }
+  void grow(const BvhBounds& b)
+  {
+    min = glm::min(min, b.min);
+    max = glm::max(max, b.max);
+  }
+  bool      isEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+  glm::vec3 getCenter() const { return (min + max) * 0.5f; }
+  float     getArea() const
+  {
+    if(isEmpty())
+      return 0.0f;
+    const glm::vec3 e = max - min;
+    return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+  }
+  BvhBounds intersect(const BvhBounds& b) const { return {glm::max(min, b.min), glm::min(max, b.max)}; }
+};
+
+//--------------------------------------------------------------------------------------------------
+// Bounding volume hierarchy built on the CPU with the binned surface area heuristic (SAH).
+//
+// The acceleration structures are built by the driver and cannot be inspected: this BVH is a reference of what a good
+// builder makes of the geometry, to measure its quality (see getStats) and find the meshes or instances which are
+// expensive to trace whatever the builder, e.g. long thin triangles or large overlapping instances.
+//
+// The nodes holding many primitives are split with the bins filled in parallel, then the subtrees are built in
+// parallel, one per worker thread. The depth is capped to kMaxDepth.
+//
+class SahBvh
+{
+public:
+  // Maximum depth of the leaves, the root being at depth 0: the deepest nodes are split at the median instead of with
+  // the SAH, which bounds the traversal stacks
+  static constexpr uint32_t kMaxDepth = 96;
+
+  struct Settings
+  {
+    uint32_t numBins          = 16;
+    uint32_t maxLeafSize      = 4;     // A node with more primitives is always split
+    float    traversalCost    = 1.0f;  // Cost of visiting an inner node, relative to intersecting a primitive
+    float    intersectionCost = 1.0f;
+  };
+
+  struct Node
+  {
+    BvhBounds bounds;
+    uint32_t  first = 0;  // Leaf: first primitive in getPrimitiveIndices(). Inner node: left child, right child next
+    uint32_t  count = 0;  // Primitives of a leaf, 0 for an inner node
+  };
+
+  struct Stats
+  {
+    double   sahCost          = 0;  // Expected cost of a ray through the root, in primitive intersections
+    double   overlapCost      = 0;  // Sum of the children overlap areas over the root area: extra nodes visited per ray
+    double   averageOverlap   = 0;  // Children overlap area over the parent area, averaged over the inner nodes
+    uint32_t nodeCount        = 0;
+    uint32_t leafCount        = 0;
+    uint32_t maxDepth         = 0;
+    double   averageLeafDepth = 0;
+
+    std::vector<uint32_t> leafSizeHistogram;  // [n] = number of leaves with n primitives
+  };
+
+  // Builds the BVH of the primitives of the given bounds, the primitives are referenced by their index
+  void build(std::span<const BvhBounds> primitiveBounds, const Settings& settings);
+
+  const std::vector<Node>&     getNodes() const { return m_nodes; }  // Root first
+  const std::vector<uint32_t>& getPrimitiveIndices() const { return m_primitiveIndices; }
+  const Settings&              getSettings() const { return m_settings; }
+  Stats                        getStats() const;
+
+  // Indices of the primitives whose bounds overlap `bounds`
+  void query(const BvhBounds& bounds, std::span<const BvhBounds> primitiveBounds, std::vector<uint32_t>& result) const;
+
+private:
+  std::vector<Node>     m_nodes;
+  std::vector<uint32_t> m_primitiveIndices;
+  Settings              m_settings;
+};
+
+}  // namespace nvsamples
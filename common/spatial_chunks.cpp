@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "spatial_chunks.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+#include "nvutils/parallel_work.hpp"
+
+namespace {
+
+// Spreads the 10 low bits of `v` to every third bit
+inline uint32_t expandBits(uint32_t v)
+{
+  v = (v * 0x00010001u) & 0xFF0000FFu;
+  v = (v * 0x00000101u) & 0x0F00F00Fu;
+  v = (v * 0x00000011u) & 0xC30C30C3u;
+  v = (v * 0x00000005u) & 0x49249249u;
+  return v;
+}
+
+constexpr int kMortonBits = 30;
+
+}  // namespace
+
+std::vector<uint32_t> nvsamples::sortByMortonCode(std::span<const glm::vec3> centers, std::vector<uint32_t>& sortedCodes)
+{
+  glm::vec3 bmin(std::numeric_limits<float>::max());
+  glm::vec3 bmax(-std::numeric_limits<float>::max());
+  for(const glm::vec3& c : centers)
+  {
+    bmin = glm::min(bmin, c);
+    bmax = glm::max(bmax, c);
+  }
+  const glm::vec3 extent = glm::max(bmax - bmin, glm::vec3(1e-20f));
+
+  // Code in the high bits, index in the low bits: one sort orders both
+  std::vector<uint64_t> keys(centers.size());
+  nvutils::parallel_batches<4096>(centers.size(), [&](uint64_t i) {
+    const glm::uvec3 cell = glm::uvec3(glm::clamp((centers[i] - bmin) / extent * 1024.0f, glm::vec3(0.0f), glm::vec3(1023.0f)));
+    const uint32_t code = (expandBits(cell.x) << 2) | (expandBits(cell.y) << 1) | expandBits(cell.z);
+    keys[i]             = (uint64_t(code) << 32) | i;
+  });
+  std::sort(keys.begin(), keys.end());
+
+  std::vector<uint32_t> order(keys.size());
+  sortedCodes.resize(keys.size());
+  for(size_t i = 0; i < keys.size(); i++)
+  {
+    order[i]       = uint32_t(keys[i]);
+    sortedCodes[i] = uint32_t(keys[i] >> 32);
+  }
+  return order;
+}
+
+std::vector<nvsamples::SpatialChunk> nvsamples::splitMortonChunks(std::span<const uint32_t> sortedCodes, uint32_t maxChunkSize)
+{
+  assert(maxChunkSize > 0);
+  std::vector<SpatialChunk> cells;
+
+  // Depth-first on the Morton grid, the second half pushed first keeps the cells in order
+  struct Cell
+  {
+    uint32_t first;
+    uint32_t count;
+    int      bit;  // Highest bit where the codes of the cell can differ
+  };
+  std::vector<Cell> stack;
+  if(!sortedCodes.empty())
+    stack.push_back({0, uint32_t(sortedCodes.size()), kMortonBits - 1});
+
+  while(!stack.empty())
+  {
+    Cell cell = stack.back();
+    stack.pop_back();
+    if(cell.count <= maxChunkSize)
+    {
+      cells.push_back({cell.first, cell.count});
+      continue;
+    }
+
+    // The codes are sorted: the first and last codes of the cell tell the first bit splitting it
+    const uint32_t firstCode = sortedCodes[cell.first];
+    const uint32_t lastCode  = sortedCodes[cell.first + cell.count - 1];
+    while(cell.bit >= 0 && ((firstCode ^ lastCode) >> cell.bit & 1) == 0)
+    {
+      cell.bit--;
+    }
+
+    uint32_t split = cell.count / 2;  // Same codes: halved in the order
+    if(cell.bit >= 0)
+    {
+      const auto begin = sortedCodes.begin() + cell.first;
+      const int  bit   = cell.bit;
+      split = uint32_t(std::partition_point(begin, begin + cell.count, [bit](uint32_t code) { return ((code >> bit) & 1) == 0; })
+                       - begin);
+    }
+    stack.push_back({cell.first + split, cell.count - split, cell.bit - 1});
+    stack.push_back({cell.first, split, cell.bit - 1});
+  }
+
+  // Merging the consecutive cells fitting in a chunk
+  std::vector<SpatialChunk> chunks;
+  for(const SpatialChunk& cell : cells)
+  {
+    if(!chunks.empty() && chunks.back().count + cell.count <= maxChunkSize)
+      chunks.back().count += cell.count;
+    else
+      chunks.push_back(cell);
+  }
+  return chunks;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace nvsamples {
+
+//--------------------------------------------------------------------------------------------------
+// Spatial partition of large primitive sets, to split them in several bottom-level acceleration structures.
+//
+// The primitives are ordered along a Morton curve of their centers, so that the primitives close in space are close
+// in the order. The order is then cut on the cells of the Morton grid (the bits of the codes), halving the largest
+// cells until they hold at most the chunk size: each chunk covers a compact region of the space, and the chunks
+// overlap much less than the same number of slices of the unsorted primitives.
+//
+
+// Range of the sorted primitives
+struct SpatialChunk
+{
+  uint32_t first = 0;
+  uint32_t count = 0;
+};
+
+// Returns the primitive indices in Morton order of their centers, and their 30-bit codes (10 bits per axis, in the
+// bounds of the centers) in that order
+std::vector<uint32_t> sortByMortonCode(std::span<const glm::vec3> centers, std::vector<uint32_t>& sortedCodes);
+
+// Splits the primitives sorted by sortByMortonCode in chunks of at most `maxChunkSize` primitives, following the cells
+// of the Morton grid. Consecutive cells are merged while they fit in a chunk, the sparse regions do not end up in many
+// tiny chunks.
+std::vector<SpatialChunk> splitMortonChunks(std::span<const uint32_t> sortedCodes, uint32_t maxChunkSize);
+
+}  // namespace nvsamples
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "texture_compression.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// 4x4 texels, RGBA8
+using Block = uint8_t[16][4];
+
+// Writes bits from the least significant bit of the block, as specified for BC6H and BC7
+struct BitWriter
+{
+  uint8_t* data;
+  uint32_t position = 0;
+
+  void write(uint32_t value, uint32_t numBits)
+  {
+    for(uint32_t i = 0; i < numBits; i++, position++)
+    {
+      if((value >> i) & 1)
+        data[position >> 3] |= uint8_t(1 << (position & 7));
+    }
+  }
+};
+
+void fetchBlock(std::span<const uint8_t> rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, Block& block)
+{
+  for(uint32_t y = 0; y < 4; y++)
+  {
+    const uint32_t py = std::min(blockY * 4 + y, height - 1);
+    for(uint32_t x = 0; x < 4; x++)
+    {
+      const uint32_t px = std::min(blockX * 4 + x, width - 1);
+      std::memcpy(block[y * 4 + x], &rgba[(size_t(py) * width + px) * 4], 4);
+    }
+  }
+}
+
+// BC7 mode 6: one subset, 7-bit RGBA endpoints with a p-bit each, 4-bit indices
+void encodeBlockBC7(const Block& block, uint8_t* output)
+{
+  // Principal axis of the colors, from a few power iterations on the covariance matrix
+  float mean[4]{};
+  for(const auto& texel : block)
+    for(int c = 0; c < 4; c++)
+      mean[c] += texel[c] / 16.0f;
+
+  float covariance[4][4]{};
+  for(const auto& texel : block)
+  {
+    for(int i = 0; i < 4; i++)
+      for(int j = 0; j < 4; j++)
+        covariance[i][j] += (texel[i] - mean[i]) * (texel[j] - mean[j]);
+  }
+
+  float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+  for(int iteration = 0; iteration < 8; iteration++)
+  {
+    float next[4]{};
+    for(int i = 0; i < 4; i++)
+      for(int j = 0; j < 4; j++)
+        next[i] += covariance[i][j] * axis[j];
+    const float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+    if(length < 1e-6f)
+      break;
+    for(int i = 0; i < 4; i++)
+      axis[i] = next[i] / length;
+  }
+
+  // Endpoints at the extents of the colors along the axis
+  float minProjection = 0.0f, maxProjection = 0.0f;
+  for(const auto& texel : block)
+  {
+    float projection = 0.0f;
+    for(int c = 0; c < 4; c++)
+      projection += (texel[c] - mean[c]) * axis[c];
+    minProjection = std::min(minProjection, projection);
+    maxProjection = std::max(maxProjection, projection);
+  }
+
+  // Quantize the endpoints to 7 bits + p-bit, choosing the p-bit giving the smallest error
+  uint32_t quantized[2][4]{};
+  uint32_t pBits[2]{};
+  int      endpoints[2][4]{};
+  for(int e = 0; e < 2; e++)
+  {
+    const float projection = e == 0 ? minProjection : maxProjection;
+    float       bestError  = 1e30f;
+    for(uint32_t p = 0; p < 2; p++)
+    {
+      uint32_t q[4];
+      float    error = 0.0f;
+      for(int c = 0; c < 4; c++)
+      {
+        const float value = std::clamp(mean[c] + axis[c] * projection, 0.0f, 255.0f);
+        q[c]              = uint32_t(std::clamp(std::lround((value - float(p)) / 2.0f), 0L, 127L));
+        const float delta = float(q[c] * 2 + p) - value;
+        error += delta * delta;
+      }
+      if(error < bestError)
+      {
+        bestError = error;
+        pBits[e]  = p;
+        std::memcpy(quantized[e], q, sizeof(q));
+      }
+    }
+    for(int c = 0; c < 4; c++)
+      endpoints[e][c] = int(quantized[e][c] * 2 + pBits[e]);
+  }
+
+  // Closest palette entry for each texel
+  constexpr int kWeights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+  int           palette[16][4];
+  for(int i = 0; i < 16; i++)
+    for(int c = 0; c < 4; c++)
+      palette[i][c] = ((64 - kWeights[i]) * endpoints[0][c] + kWeights[i] * endpoints[1][c] + 32) >> 6;
+
+  uint32_t indices[16];
+  for(int t = 0; t < 16; t++)
+  {
+    int bestError = INT32_MAX;
+    for(uint32_t i = 0; i < 16; i++)
+    {
+      int error = 0;
+      for(int c = 0; c < 4; c++)
+      {
+        const int delta = palette[i][c] - int(block[t][c]);
+        error += delta * delta;
+      }
+      if(error < bestError)
+      {
+        bestError  = error;
+        indices[t] = i;
+      }
+    }
+  }
+
+  // The most significant bit of the first index is implicit and must be 0
+  if(indices[0] & 8)
+  {
+    std::swap(quantized[0], quantized[1]);
+    std::swap(pBits[0], pBits[1]);
+    for(uint32_t& index : indices)
+      index = 15 - index;
+  }
+
+  std::memset(output, 0, 16);
+  BitWriter writer{output};
+  writer.write(1 << 6, 7);  // Mode 6
+  for(int c = 0; c < 4; c++)
+  {
+    writer.write(quantized[0][c], 7);
+    writer.write(quantized[1][c], 7);
+  }
+  writer.write(pBits[0], 1);
+  writer.write(pBits[1], 1);
+  writer.write(indices[0], 3);
+  for(int t = 1; t < 16; t++)
+    writer.write(indices[t], 4);
+}
+
+// BC4: one channel, 8-bit endpoints and 3-bit indices, using the 8 values interpolation mode
+void encodeBlockBC4(const Block& block, int channel, uint8_t* output)
+{
+  uint8_t minValue = 255, maxValue = 0;
+  for(const auto& texel : block)
+  {
+    minValue = std::min(minValue, texel[channel]);
+    maxValue = std::max(maxValue, texel[channel]);
+  }
+
+  int palette[8] = {maxValue, minValue};
+  for(int i = 2; i < 8; i++)
+    palette[i] = ((8 - i) * maxValue + (i - 1) * minValue + 3) / 7;
+
+  uint64_t bits = 0;
+  for(int t = 0; t < 16 && maxValue != minValue; t++)
+  {
+    uint64_t bestIndex = 0;
+    int      bestError = INT32_MAX;
+    for(uint64_t i = 0; i < 8; i++)
+    {
+      const int error = std::abs(palette[i] - int(block[t][channel]));
+      if(error < bestError)
+      {
+        bestError = error;
+        bestIndex = i;
+      }
+    }
+    bits |= bestIndex << (3 * t);
+  }
+
+  output[0] = maxValue;
+  output[1] = minValue;
+  for(int i = 0; i < 6; i++)
+    output[2 + i] = uint8_t(bits >> (8 * i));
+}
+
+template <typename EncodeBlock>
+std::vector<uint8_t> compressBlocks(std::span<const uint8_t> rgba, uint32_t width, uint32_t height, EncodeBlock&& encodeBlock)
+{
+  const uint32_t       blocksX = (width + 3) / 4;
+  const uint32_t       blocksY = (height + 3) / 4;
+  std::vector<uint8_t> result(nvsamples::getBlockCompressedSize(width, height));
+  for(uint32_t by = 0; by < blocksY; by++)
+  {
+    for(uint32_t bx = 0; bx < blocksX; bx++)
+    {
+      Block block;
+      fetchBlock(rgba, width, height, bx, by, block);
+      encodeBlock(block, &result[(size_t(by) * blocksX + bx) * 16]);
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+std::vector<uint8_t> nvsamples::compressBC7(std::span<const uint8_t> rgba, uint32_t width, uint32_t height)
+{
+  return compressBlocks(rgba, width, height, [](const Block& block, uint8_t* output) { encodeBlockBC7(block, output); });
+}
+
+std::vector<uint8_t> nvsamples::compressBC5(std::span<const uint8_t> rgba, uint32_t width, uint32_t height)
+{
+  return compressBlocks(rgba, width, height, [](const Block& block, uint8_t* output) {
+    encodeBlockBC4(block, 0, output);
+    encodeBlockBC4(block, 1, output + 8);
+  });
+}
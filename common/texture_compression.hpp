@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+// Simple host block compressors, used to build the compressed texture cache (see texture_utils.hpp).
+// They favor speed and simplicity over quality: BC7 uses mode 6 only, with endpoints along the principal axis.
+// The input is RGBA8, the output is the 16-byte blocks of the image, in rows of 4x4 blocks.
+// Images that are not a multiple of 4 are padded by replicating the last row and column.
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace nvsamples {
+
+// Size in bytes of a BC1-7 compressed image
+inline size_t getBlockCompressedSize(uint32_t width, uint32_t height)
+{
+  return size_t((width + 3) / 4) * size_t((height + 3) / 4) * 16;
+}
+
+// RGBA, for VK_FORMAT_BC7_UNORM_BLOCK or VK_FORMAT_BC7_SRGB_BLOCK
+std::vector<uint8_t> compressBC7(std::span<const uint8_t> rgba, uint32_t width, uint32_t height);
+
+// Red and green channels only, for VK_FORMAT_BC5_UNORM_BLOCK (tangent space normal maps)
+std::vector<uint8_t> compressBC5(std::span<const uint8_t> rgba, uint32_t width, uint32_t height);
+
+}  // namespace nvsamples
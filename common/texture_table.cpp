@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "texture_table.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include <nvutils/logger.hpp>
+
+uint32_t nvsamples::TextureTable::getMaxTextureCount(VkPhysicalDevice physicalDevice, uint32_t maxCount /*= 1 << 16*/)
+{
+  VkPhysicalDeviceVulkan12Properties props12{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES};
+  VkPhysicalDeviceProperties2        props{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, .pNext = &props12};
+  vkGetPhysicalDeviceProperties2(physicalDevice, &props);
+
+  // A combined image sampler counts as a sampled image and as a sampler, in each stage and in the whole set
+  return std::min({maxCount, props12.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                   props12.maxPerStageDescriptorUpdateAfterBindSamplers, props12.maxDescriptorSetUpdateAfterBindSampledImages,
+                   props12.maxDescriptorSetUpdateAfterBindSamplers, props12.maxPerStageUpdateAfterBindResources});
+}
+
+void nvsamples::TextureTable::init(VkDevice device, VkDescriptorSet set, uint32_t binding, uint32_t capacity)
+{
+  m_device   = device;
+  m_set      = set;
+  m_binding  = binding;
+  m_capacity = capacity;
+  m_nextSlot = 1;
+  m_freeSlots.clear();
+}
+
+void nvsamples::TextureTable::deinit()
+{
+  *this = {};
+}
+
+uint32_t nvsamples::TextureTable::add(const VkDescriptorImageInfo& imageInfo)
+{
+  uint32_t slot = ~0U;
+  if(!m_freeSlots.empty())
+  {
+    slot = m_freeSlots.back();
+    m_freeSlots.pop_back();
+  }
+  else if(m_nextSlot < m_capacity)
+  {
+    slot = m_nextSlot++;
+  }
+  else
+  {
+    LOGW("Texture table is full (%u textures)\n", m_capacity - 1);
+    return ~0U;
+  }
+
+  update(slot, imageInfo);
+  return slot;
+}
+
+void nvsamples::TextureTable::update(uint32_t slot, const VkDescriptorImageInfo& imageInfo)
+{
+  assert(slot > 0 && slot < m_nextSlot);
+  const VkWriteDescriptorSet write{
+      .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+      .dstSet          = m_set,
+      .dstBinding      = m_binding,
+      .dstArrayElement = slot,
+      .descriptorCount = 1,
+      .descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+      .pImageInfo      = &imageInfo,
+  };
+  vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+}
+
+void nvsamples::TextureTable::remove(uint32_t slot)
+{
+  assert(slot > 0 && slot < m_nextSlot);
+  assert(std::find(m_freeSlots.begin(), m_freeSlots.end(), slot) == m_freeSlots.end() && "Slot already free");
+  m_freeSlots.push_back(slot);
+}
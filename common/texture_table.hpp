@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+namespace nvsamples {
+
+//--------------------------------------------------------------------------------------------------
+// Bindless table of textures: slots of a combined image sampler array binding, allocated and freed one by one.
+//
+// The binding must be created with VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT, UPDATE_UNUSED_WHILE_PENDING_BIT and
+// PARTIALLY_BOUND_BIT: a slot can then be written while the descriptor set is in use, as long as the shaders in
+// flight do not access it. Slot 0 is reserved, a texture index of 0 means "no texture" in the shaders.
+//
+// Freeing a slot does not wait for the GPU: the caller must make sure the frames in flight no longer use the
+// texture before destroying it or reusing the slot for another texture.
+//
+class TextureTable
+{
+public:
+  // Largest number of textures the device can hold in one update-after-bind binding, clamped to `maxCount`
+  static uint32_t getMaxTextureCount(VkPhysicalDevice physicalDevice, uint32_t maxCount = 1 << 16);
+
+  void init(VkDevice device, VkDescriptorSet set, uint32_t binding, uint32_t capacity);
+  void deinit();
+
+  // Writes the texture in a free slot, returns the slot or ~0U if the table is full
+  uint32_t add(const VkDescriptorImageInfo& imageInfo);
+  // Replaces the texture of an allocated slot
+  void update(uint32_t slot, const VkDescriptorImageInfo& imageInfo);
+  // Returns the slot to the free list
+  void remove(uint32_t slot);
+
+  uint32_t getCapacity() const { return m_capacity; }
+  uint32_t getCount() const { return m_nextSlot - 1 - uint32_t(m_freeSlots.size()); }
+
+private:
+  VkDevice              m_device   = VK_NULL_HANDLE;
+  VkDescriptorSet       m_set      = VK_NULL_HANDLE;
+  uint32_t              m_binding  = 0;
+  uint32_t              m_capacity = 0;
+  uint32_t              m_nextSlot = 1;  // First slot never allocated
+  std::vector<uint32_t> m_freeSlots;     // Slots freed by remove(), reused first
+};
+
+}  // namespace nvsamples
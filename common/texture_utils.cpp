@@ -0,0 +1,362 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "texture_utils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#include <fmt/format.h>
+#include <nvutils/file_mapping.hpp>
+#include <nvutils/file_operations.hpp>
+#include <nvutils/logger.hpp>
+#include <nvutils/parallel_work.hpp>
+#include <nvutils/timers.hpp>
+#include <nvvk/check_error.hpp>
+#include <nvvk/default_structs.hpp>
+
+#include <stb/stb_image.h>
+
+#include "texture_compression.hpp"
+#include "utils.hpp"
+
+namespace {
+
+// Layout of a texture cache file:
+// - TextureCacheHeader
+// - the data of each mip level, from the largest, tightly packed
+struct TextureCacheHeader
+{
+  uint32_t magic     = 0;
+  uint32_t version   = 0;
+  uint64_t key       = 0;  // Hash of the source file and of the processing options
+  uint32_t format    = 0;  // VkFormat
+  uint32_t width     = 0;
+  uint32_t height    = 0;
+  uint32_t mipLevels = 0;
+};
+
+constexpr uint32_t kTextureCacheMagic   = 0x58545452;  // "RTTX"
+constexpr uint32_t kTextureCacheVersion = 1;
+
+// Texture ready to be uploaded: all the mip levels in their final format
+struct TextureData
+{
+  VkFormat                          format = VK_FORMAT_UNDEFINED;
+  uint32_t                          width  = 0;
+  uint32_t                          height = 0;
+  std::vector<std::vector<uint8_t>> levels;
+};
+
+bool isBlockCompressed(VkFormat format)
+{
+  return format == VK_FORMAT_BC7_UNORM_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK || format == VK_FORMAT_BC5_UNORM_BLOCK;
+}
+
+size_t getLevelSize(VkFormat format, uint32_t width, uint32_t height)
+{
+  return isBlockCompressed(format) ? nvsamples::getBlockCompressedSize(width, height) : size_t(width) * height * 4;
+}
+
+uint32_t getMipSize(uint32_t size, uint32_t level)
+{
+  return std::max(size >> level, 1U);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Mip chain generation
+//
+
+// sRGB <-> linear conversions through lookup tables
+struct SrgbTables
+{
+  std::array<float, 256>    toLinear{};
+  std::array<uint8_t, 4096> fromLinear{};  // Indexed by the linear value in 12 bits
+
+  SrgbTables()
+  {
+    for(int i = 0; i < 256; i++)
+    {
+      const float c = float(i) / 255.0f;
+      toLinear[i]   = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+    for(int i = 0; i < 4096; i++)
+    {
+      const float l = float(i) / 4095.0f;
+      const float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+      fromLinear[i] = uint8_t(std::lround(std::clamp(c, 0.0f, 1.0f) * 255.0f));
+    }
+  }
+};
+
+// 2x2 box filter of a RGBA8 level. For odd sizes, the last row or column is used twice.
+// The linear path is a plain loop over the channels, which the compiler vectorizes.
+void downsampleLevel(const uint8_t* src, uint32_t width, uint32_t height, uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight, bool sRgb)
+{
+  static const SrgbTables tables;
+
+  for(uint32_t y = 0; y < dstHeight; y++)
+  {
+    const uint8_t* row0   = src + size_t(std::min(y * 2, height - 1)) * width * 4;
+    const uint8_t* row1   = src + size_t(std::min(y * 2 + 1, height - 1)) * width * 4;
+    uint8_t*       dstRow = dst + size_t(y) * dstWidth * 4;
+
+    if(!sRgb && width == dstWidth * 2)
+    {
+      for(uint32_t i = 0; i < dstWidth * 4; i++)
+      {
+        const uint32_t x = (i / 4) * 8 + (i % 4);
+        dstRow[i]        = uint8_t((row0[x] + row0[x + 4] + row1[x] + row1[x + 4] + 2) >> 2);
+      }
+      continue;
+    }
+
+    for(uint32_t x = 0; x < dstWidth; x++)
+    {
+      const uint32_t x0 = std::min(x * 2, width - 1) * 4;
+      const uint32_t x1 = std::min(x * 2 + 1, width - 1) * 4;
+      for(uint32_t c = 0; c < 4; c++)
+      {
+        if(sRgb && c < 3)
+        {
+          const float sum = tables.toLinear[row0[x0 + c]] + tables.toLinear[row0[x1 + c]] + tables.toLinear[row1[x0 + c]]
+                            + tables.toLinear[row1[x1 + c]];
+          dstRow[x * 4 + c] = tables.fromLinear[uint32_t(sum * (4095.0f / 4.0f) + 0.5f)];
+        }
+        else
+        {
+          dstRow[x * 4 + c] = uint8_t((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+        }
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Cache
+//
+
+uint64_t getTextureCacheKey(std::span<const uint8_t> fileData, const nvsamples::TextureRequest& request, const nvsamples::TextureLoadOptions& options)
+{
+  const uint32_t settings[] = {kTextureCacheVersion, uint32_t(request.sRgb), uint32_t(request.normalMap),
+                               uint32_t(options.generateMips), uint32_t(options.compress)};
+  return nvsamples::hashBytes({reinterpret_cast<const uint8_t*>(settings), sizeof(settings)}, nvsamples::hashBytes(fileData));
+}
+
+bool loadTextureCache(const std::filesystem::path& cacheFilename, uint64_t key, TextureData& texture)
+{
+  nvutils::FileReadMapping mapping;
+  if(!mapping.open(cacheFilename) || mapping.size() < sizeof(TextureCacheHeader))
+  {
+    return false;
+  }
+
+  const uint8_t*     data = static_cast<const uint8_t*>(mapping.data());
+  TextureCacheHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  if(header.magic != kTextureCacheMagic || header.version != kTextureCacheVersion || header.key != key || header.mipLevels == 0)
+  {
+    return false;
+  }
+
+  size_t offset = sizeof(header);
+  texture       = {VkFormat(header.format), header.width, header.height};
+  for(uint32_t level = 0; level < header.mipLevels; level++)
+  {
+    const size_t size = getLevelSize(texture.format, getMipSize(header.width, level), getMipSize(header.height, level));
+    if(offset + size > mapping.size())
+    {
+      return false;
+    }
+    texture.levels.emplace_back(data + offset, data + offset + size);
+    offset += size;
+  }
+  return true;
+}
+
+void saveTextureCache(const std::filesystem::path& cacheFilename, uint64_t key, const TextureData& texture)
+{
+  const TextureCacheHeader header{
+      .magic     = kTextureCacheMagic,
+      .version   = kTextureCacheVersion,
+      .key       = key,
+      .format    = uint32_t(texture.format),
+      .width     = texture.width,
+      .height    = texture.height,
+      .mipLevels = uint32_t(texture.levels.size()),
+  };
+
+  // Write to a temporary file first, so that concurrent processes never see a partial cache
+  std::error_code             ec;
+  const std::filesystem::path tempFilename = nvsamples::getTempFilename(cacheFilename);
+  std::filesystem::create_directories(cacheFilename.parent_path(), ec);
+  {
+    std::ofstream file(tempFilename, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for(const std::vector<uint8_t>& level : texture.levels)
+    {
+      file.write(reinterpret_cast<const char*>(level.data()), std::streamsize(level.size()));
+    }
+    if(!file)
+    {
+      LOGW("Could not write the texture cache: %s\n", nvutils::utf8FromPath(tempFilename).c_str());
+      return;
+    }
+  }
+  std::filesystem::rename(tempFilename, cacheFilename, ec);
+  if(ec)
+  {
+    std::filesystem::remove(tempFilename, ec);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Decodes an image file to its final mip chain, or gets it from the cache. Called concurrently.
+//
+bool loadTexture(const nvsamples::TextureRequest& request, const nvsamples::TextureLoadOptions& options, TextureData& texture, bool& fromCache)
+{
+  const std::string        filenameUtf8 = nvutils::utf8FromPath(request.filename);
+  nvutils::FileReadMapping mapping;
+  if(!mapping.open(request.filename))
+  {
+    LOGE("Could not open texture image: %s\n", filenameUtf8.c_str());
+    return false;
+  }
+  const std::span<const uint8_t> fileData(static_cast<const uint8_t*>(mapping.data()), mapping.size());
+
+  uint64_t              key = 0;
+  std::filesystem::path cacheFilename;
+  if(!options.cacheDirectory.empty())
+  {
+    key           = getTextureCacheKey(fileData, request, options);
+    cacheFilename = options.cacheDirectory / fmt::format("{}_{:016x}.texcache", nvutils::utf8FromPath(request.filename.stem()), key);
+    fromCache     = loadTextureCache(cacheFilename, key, texture);
+    if(fromCache)
+    {
+      return true;
+    }
+  }
+
+  int      w = 0, h = 0, comp = 0;
+  stbi_uc* pixels = stbi_load_from_memory(fileData.data(), int(fileData.size()), &w, &h, &comp, 4);
+  if(pixels == nullptr)
+  {
+    LOGE("Could not load texture image: %s (%s)\n", filenameUtf8.c_str(), stbi_failure_reason());
+    return false;
+  }
+  texture.width  = uint32_t(w);
+  texture.height = uint32_t(h);
+  texture.levels.emplace_back(pixels, pixels + size_t(w) * h * 4);
+  stbi_image_free(pixels);
+
+  // Mip chain, down to 1x1
+  const bool     sRgb      = request.sRgb && !request.normalMap;
+  const uint32_t mipLevels = options.generateMips ? uint32_t(std::floor(std::log2(std::max(w, h)))) + 1 : 1;
+  for(uint32_t level = 1; level < mipLevels; level++)
+  {
+    const uint32_t srcWidth  = getMipSize(texture.width, level - 1);
+    const uint32_t srcHeight = getMipSize(texture.height, level - 1);
+    const uint32_t dstWidth  = getMipSize(texture.width, level);
+    const uint32_t dstHeight = getMipSize(texture.height, level);
+    std::vector<uint8_t> mip(size_t(dstWidth) * dstHeight * 4);
+    downsampleLevel(texture.levels.back().data(), srcWidth, srcHeight, mip.data(), dstWidth, dstHeight, sRgb);
+    texture.levels.emplace_back(std::move(mip));
+  }
+
+  texture.format = request.normalMap ? VK_FORMAT_R8G8B8A8_UNORM : sRgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+  if(options.compress)
+  {
+    texture.format = request.normalMap ? VK_FORMAT_BC5_UNORM_BLOCK : sRgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+    for(uint32_t level = 0; level < mipLevels; level++)
+    {
+      const uint32_t width  = getMipSize(texture.width, level);
+      const uint32_t height = getMipSize(texture.height, level);
+      texture.levels[level] = request.normalMap ? nvsamples::compressBC5(texture.levels[level], width, height) :
+                                                  nvsamples::compressBC7(texture.levels[level], width, height);
+    }
+  }
+
+  if(!cacheFilename.empty())
+  {
+    saveTextureCache(cacheFilename, key, texture);
+  }
+  return true;
+}
+
+}  // namespace
+
+
+std::vector<nvvk::Image> nvsamples::loadAndCreateImages(nvvk::StagingUploader&          staging,
+                                                        std::span<const TextureRequest> requests,
+                                                        const TextureLoadOptions&       options /*= {}*/)
+{
+  nvutils::ScopedTimer _st(__FUNCTION__);
+
+  // Decoding, mip generation and compression, one image per task
+  std::vector<TextureData> textures(requests.size());
+  std::atomic_uint32_t     numFromCache{0};
+  nvutils::parallel_batches<1>(requests.size(), [&](uint64_t i) {
+    bool fromCache = false;
+    if(!loadTexture(requests[i], options, textures[i], fromCache))
+    {
+      textures[i] = {};
+    }
+    numFromCache += fromCache ? 1 : 0;
+  });
+
+  // Images creation and upload of all the mip levels
+  nvvk::ResourceAllocator* allocator = staging.getResourceAllocator();
+  std::vector<nvvk::Image> images(requests.size());
+  for(size_t i = 0; i < textures.size(); i++)
+  {
+    TextureData& texture = textures[i];
+    if(texture.levels.empty())
+    {
+      continue;
+    }
+
+    VkImageCreateInfo imageInfo = DEFAULT_VkImageCreateInfo;
+    imageInfo.format            = texture.format;
+    imageInfo.usage             = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageInfo.extent            = {texture.width, texture.height, 1};
+    imageInfo.mipLevels         = uint32_t(texture.levels.size());
+
+    VkImageViewCreateInfo viewInfo       = DEFAULT_VkImageViewCreateInfo;
+    viewInfo.subresourceRange.levelCount = imageInfo.mipLevels;
+
+    NVVK_CHECK(allocator->createImage(images[i], imageInfo, viewInfo));
+    for(uint32_t level = 0; level < imageInfo.mipLevels; level++)
+    {
+      // The image stays in transfer layout until its last level is copied
+      const bool          lastLevel = level + 1 == imageInfo.mipLevels;
+      const VkImageLayout layout    = lastLevel ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+      const VkExtent3D    extent{getMipSize(texture.width, level), getMipSize(texture.height, level), 1};
+      NVVK_CHECK(staging.appendImageSub(images[i], {0, 0, 0}, extent, {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1},
+                                        texture.levels[level].size(), texture.levels[level].data(), layout));
+    }
+    texture = {};  // The data is in the staging buffer
+  }
+
+  LOGI("%s", fmt::format("\n{}Loaded {} textures ({} from cache)", _st.indent(), requests.size(), numFromCache.load()).c_str());
+  return images;
+}
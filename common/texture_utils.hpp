@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include <nvvk/resources.hpp>
+#include <nvvk/staging.hpp>
+
+namespace nvsamples {
+
+// Image file to load as a texture
+struct TextureRequest
+{
+  std::filesystem::path filename;
+  bool                  sRgb      = true;   // Color data, filtered and stored as sRGB
+  bool                  normalMap = false;  // Tangent space normal map, only the XY channels are kept when compressed
+};
+
+struct TextureLoadOptions
+{
+  bool generateMips = true;   // Full mip chain, box filtered on the host
+  bool compress     = false;  // BC7 (BC5 for normal maps), requires the textureCompressionBC device feature
+  // Directory of the texture cache, holding the final mip chain of each texture: warm loads skip the decoding,
+  // the mip generation and the compression. No cache if empty.
+  std::filesystem::path cacheDirectory;
+};
+
+// Loads the images in parallel and creates the textures, the mip levels are appended to the staging uploader.
+// The textures are in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL after the upload.
+// A texture that cannot be loaded is returned empty (null image).
+std::vector<nvvk::Image> loadAndCreateImages(nvvk::StagingUploader&          staging,
+                                             std::span<const TextureRequest> requests,
+                                             const TextureLoadOptions&       options = {});
+
+}  // namespace nvsamples
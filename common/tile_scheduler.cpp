@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "tile_scheduler.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+void nvsamples::TileScheduler::init(uint32_t numWorkers /*= 0*/)
+{
+  assert(m_numWorkers == 0);
+  m_numWorkers = numWorkers ? numWorkers : std::max(std::thread::hardware_concurrency(), 1U);
+  m_queues     = std::make_unique<Queue[]>(m_numWorkers);
+  m_exit       = false;
+  for(uint32_t worker = 1; worker < m_numWorkers; worker++)
+  {
+    m_threads.emplace_back(&TileScheduler::workerThread, this, worker);
+  }
+}
+
+void nvsamples::TileScheduler::deinit()
+{
+  {
+    std::lock_guard lock(m_mutex);
+    m_exit = true;
+  }
+  m_started.notify_all();
+  for(std::thread& thread : m_threads)
+  {
+    thread.join();
+  }
+  m_threads.clear();
+  m_queues.reset();
+  m_numWorkers = 0;
+}
+
+void nvsamples::TileScheduler::run(uint32_t numTiles, const TileFunction& fn)
+{
+  assert(m_numWorkers > 0);
+  if(numTiles == 0)
+    return;
+
+  // Contiguous ranges of the same size, the stealing balances the actual cost of the tiles
+  for(uint32_t worker = 0; worker < m_numWorkers; worker++)
+  {
+    Queue& queue = m_queues[worker];
+    queue.begin  = uint32_t(uint64_t(numTiles) * worker / m_numWorkers);
+    queue.end    = uint32_t(uint64_t(numTiles) * (worker + 1) / m_numWorkers);
+  }
+  m_stealCount = 0;
+
+  {
+    std::lock_guard lock(m_mutex);
+    m_function    = &fn;
+    m_busyThreads = uint32_t(m_threads.size());
+    m_generation++;
+  }
+  m_started.notify_all();
+
+  processTiles(0);
+
+  std::unique_lock lock(m_mutex);
+  m_finished.wait(lock, [&] { return m_busyThreads == 0; });
+  m_function = nullptr;
+}
+
+void nvsamples::TileScheduler::workerThread(uint32_t worker)
+{
+  uint64_t generation = 0;
+  while(true)
+  {
+    {
+      std::unique_lock lock(m_mutex);
+      m_started.wait(lock, [&] { return m_exit || m_generation != generation; });
+      if(m_exit)
+        return;
+      generation = m_generation;
+    }
+
+    processTiles(worker);
+
+    std::lock_guard lock(m_mutex);
+    if(--m_busyThreads == 0)
+    {
+      m_finished.notify_one();
+    }
+  }
+}
+
+void nvsamples::TileScheduler::processTiles(uint32_t worker)
+{
+  Queue& queue = m_queues[worker];
+  while(true)
+  {
+    uint32_t tile = ~0U;
+    {
+      std::lock_guard lock(queue.mutex);
+      if(queue.begin < queue.end)
+      {
+        tile = queue.begin++;
+      }
+    }
+    if(tile != ~0U)
+    {
+      (*m_function)(tile, worker);
+    }
+    else if(!steal(worker))
+    {
+      // The tiles left are in the ranges of workers still running, they will take them
+      return;
+    }
+  }
+}
+
+// Moves the back half of the largest range to the range of `worker`, which is empty.
+// Both queues are locked during the move, so the tiles are always in a range or being processed: a worker seeing all
+// the ranges empty can stop.
+bool nvsamples::TileScheduler::steal(uint32_t worker)
+{
+  while(true)
+  {
+    uint32_t victim = ~0U, largest = 0;
+    for(uint32_t other = 0; other < m_numWorkers; other++)
+    {
+      if(other == worker)
+        continue;
+      Queue&          queue = m_queues[other];
+      std::lock_guard lock(queue.mutex);
+      if(queue.end - queue.begin > largest)
+      {
+        victim  = other;
+        largest = queue.end - queue.begin;
+      }
+    }
+    if(victim == ~0U)
+      return false;
+
+    Queue&           thief = m_queues[worker];
+    Queue&           queue = m_queues[victim];
+    std::scoped_lock lock(thief.mutex, queue.mutex);
+    const uint32_t   size = queue.end - queue.begin;
+    if(size == 0)
+      continue;  // Emptied in the meantime, look for another victim
+
+    const uint32_t half = (size + 1) / 2;
+    thief.begin         = queue.end - half;
+    thief.end           = queue.end;
+    queue.end -= half;
+    m_stealCount++;
+    return true;
+  }
+}
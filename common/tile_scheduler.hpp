@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nvsamples {
+
+//--------------------------------------------------------------------------------------------------
+// Runs the tiles of an image on worker threads, with work stealing.
+//
+// Each worker owns a contiguous range of tiles and takes them from the front. A worker whose range is empty steals
+// the back half of the largest range left: the threads stay busy until the end of the frame even when some tiles are
+// much more expensive than others, and each thread keeps working on neighboring tiles.
+//
+// The threads are created by init() and wait between the calls to run(), the calling thread is worker 0.
+//
+class TileScheduler
+{
+public:
+  // Processes a tile, `worker` is in [0, getWorkerCount())
+  using TileFunction = std::function<void(uint32_t tile, uint32_t worker)>;
+
+  void init(uint32_t numWorkers = 0);  // 0: one per hardware thread
+  void deinit();
+
+  // Calls `fn` once for each tile in [0, numTiles), returns when all the tiles are done
+  void run(uint32_t numTiles, const TileFunction& fn);
+
+  uint32_t getWorkerCount() const { return m_numWorkers; }
+  uint32_t getStealCount() const { return m_stealCount; }  // Ranges stolen during the last run
+
+private:
+  struct alignas(64) Queue
+  {
+    std::mutex mutex;
+    uint32_t   begin = 0;  // Tiles [begin, end) not started yet
+    uint32_t   end   = 0;
+  };
+
+  void workerThread(uint32_t worker);
+  void processTiles(uint32_t worker);
+  bool steal(uint32_t worker);
+
+  uint32_t                 m_numWorkers = 0;
+  std::unique_ptr<Queue[]> m_queues;
+  std::vector<std::thread> m_threads;
+
+  std::mutex              m_mutex;
+  std::condition_variable m_started;
+  std::condition_variable m_finished;
+  const TileFunction*     m_function    = nullptr;
+  uint64_t                m_generation  = 0;  // Incremented by each run, wakes up the threads
+  uint32_t                m_busyThreads = 0;
+  bool                    m_exit        = false;
+  std::atomic<uint32_t>   m_stealCount{0};
+};
+
+}  // namespace nvsamples
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "tlas_instances.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "instance_conversion.hpp"
+
+#include "nvvk/barriers.hpp"
+#include "nvvk/check_error.hpp"
+
+namespace {
+
+// Clean instances between two dirty ones below which both are copied in the same range: fewer, larger copies
+constexpr uint32_t kMergeGap = 4;
+
+struct InstanceRange
+{
+  uint32_t first = 0;
+  uint32_t count = 0;
+};
+
+}  // namespace
+
+void nvsamples::TlasInstanceManager::assign(std::span<const VkAccelerationStructureInstanceKHR> instances,
+                                            VkBuildAccelerationStructureFlagsKHR                buildFlags)
+{
+  m_instances.assign(instances.begin(), instances.end());
+  m_dirty.clear();
+  m_dirtyFlags.assign(instances.size(), false);
+  m_allDirty   = false;
+  m_buildFlags = buildFlags;
+}
+
+void nvsamples::TlasInstanceManager::clear()
+{
+  assign({}, 0);
+}
+
+VkAccelerationStructureInstanceKHR& nvsamples::TlasInstanceManager::edit(uint32_t index)
+{
+  markDirty(index);
+  return m_instances[index];
+}
+
+void nvsamples::TlasInstanceManager::setTransform(uint32_t index, const VkTransformMatrixKHR& transform)
+{
+  if(std::memcmp(&m_instances[index].transform, &transform, sizeof(VkTransformMatrixKHR)) != 0)
+  {
+    m_instances[index].transform = transform;
+    markDirty(index);
+  }
+}
+
+void nvsamples::TlasInstanceManager::setTransforms(uint32_t first, std::span<const shaderio::GltfInstance> instances)
+{
+  assert(first + instances.size() <= m_instances.size());
+  convertInstanceTransforms(instances, std::span(m_instances).subspan(first, instances.size()));
+  if(first == 0 && instances.size() == m_instances.size())
+  {
+    markAllDirty();
+    return;
+  }
+  for(uint32_t i = 0; i < uint32_t(instances.size()); i++)
+  {
+    markDirty(first + i);
+  }
+}
+
+void nvsamples::TlasInstanceManager::setReference(uint32_t index, uint64_t accelerationStructureReference)
+{
+  if(m_instances[index].accelerationStructureReference != accelerationStructureReference)
+  {
+    m_instances[index].accelerationStructureReference = accelerationStructureReference;
+    markDirty(index);
+  }
+}
+
+void nvsamples::TlasInstanceManager::markDirty(uint32_t index)
+{
+  if(!m_dirtyFlags[index])
+  {
+    m_dirtyFlags[index] = true;
+    m_dirty.push_back(index);
+  }
+}
+
+bool nvsamples::TlasInstanceManager::cmdUpload(VkCommandBuffer        cmd,
+                                               const nvvk::Buffer&    instanceBuffer,
+                                               FrameRing&             frameRing,
+                                               nvvk::StagingUploader& stagingUploader)
+{
+  m_lastUploadCount = 0;
+  m_lastRangeCount  = 0;
+  if(!isDirty())
+    return false;
+
+  // Ranges of dirty instances, in order
+  std::vector<InstanceRange> ranges;
+  if(m_allDirty)
+  {
+    ranges.push_back({0, size()});
+  }
+  else
+  {
+    std::sort(m_dirty.begin(), m_dirty.end());
+    for(uint32_t index : m_dirty)
+    {
+      if(!ranges.empty() && index <= ranges.back().first + ranges.back().count + kMergeGap)
+        ranges.back().count = index + 1 - ranges.back().first;
+      else
+        ranges.push_back({index, 1});
+    }
+  }
+  for(const InstanceRange& range : ranges)
+  {
+    m_lastUploadCount += range.count;
+  }
+  m_lastRangeCount = uint32_t(ranges.size());
+
+  // All the ranges packed in one staging allocation, and copied with one region each
+  const VkDeviceSize    stagingSize = VkDeviceSize(m_lastUploadCount) * sizeof(VkAccelerationStructureInstanceKHR);
+  FrameRing::Allocation staging;
+  const bool            useFrameRing = frameRing.isInitialized()
+                          && stagingSize <= frameRing.getFrameSize() - frameRing.getFrameUsage()
+                          && frameRing.allocate(stagingSize, staging);
+  if(useFrameRing)
+  {
+    std::vector<VkBufferCopy> regions(ranges.size());
+    VkDeviceSize              stagingOffset = 0;
+    for(size_t i = 0; i < ranges.size(); i++)
+    {
+      const VkDeviceSize rangeSize = VkDeviceSize(ranges[i].count) * sizeof(VkAccelerationStructureInstanceKHR);
+      std::memcpy(staging.data + stagingOffset, &m_instances[ranges[i].first], rangeSize);
+      regions[i] = {.srcOffset = staging.offset + stagingOffset,
+                    .dstOffset = ranges[i].first * sizeof(VkAccelerationStructureInstanceKHR),
+                    .size      = rangeSize};
+      stagingOffset += rangeSize;
+    }
+    vkCmdCopyBuffer(cmd, staging.buffer, instanceBuffer.buffer, uint32_t(regions.size()), regions.data());
+  }
+  else
+  {
+    for(const InstanceRange& range : ranges)
+    {
+      NVVK_CHECK(stagingUploader.appendBuffer(instanceBuffer, range.first * sizeof(VkAccelerationStructureInstanceKHR),
+                                              getInstances().subspan(range.first, range.count)));
+    }
+    stagingUploader.cmdUploadAppended(cmd);
+  }
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR);
+
+  for(uint32_t index : m_dirty)
+  {
+    m_dirtyFlags[index] = false;
+  }
+  m_dirty.clear();
+  m_allDirty = false;
+  return !useFrameRing;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include <nvvk/resources.hpp>
+#include <nvvk/staging.hpp>
+
+#include "frame_ring.hpp"
+#include "io_gltf.h"
+
+namespace nvsamples {
+
+//--------------------------------------------------------------------------------------------------
+// Host copy of the instances of a TLAS, tracking the ones changed since their last upload.
+//
+// The instances are changed through edit(), setTransform(), setTransforms() or setReference(), which mark them dirty.
+// cmdUpload() then records the copy of the dirty instances only, to the persistent instance buffer of the TLAS: the
+// consecutive dirty instances are merged in ranges and all the ranges are staged in one allocation of the frame ring,
+// the cost follows the number of changed instances instead of the size of the scene.
+//
+class TlasInstanceManager
+{
+public:
+  // Instances already in the instance buffer (e.g. uploaded by the TLAS build), none of them is dirty
+  void assign(std::span<const VkAccelerationStructureInstanceKHR> instances,
+              VkBuildAccelerationStructureFlagsKHR                buildFlags);
+  void clear();
+
+  uint32_t size() const { return uint32_t(m_instances.size()); }
+  bool     allowsUpdate() const { return (m_buildFlags & VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR) != 0; }
+  const VkAccelerationStructureInstanceKHR&           get(uint32_t index) const { return m_instances[index]; }
+  std::span<const VkAccelerationStructureInstanceKHR> getInstances() const { return m_instances; }
+
+  VkAccelerationStructureInstanceKHR& edit(uint32_t index);
+  void                                setTransform(uint32_t index, const VkTransformMatrixKHR& transform);
+  void                                setReference(uint32_t index, uint64_t accelerationStructureReference);
+  // Transforms of the instances starting at `first`, converted in batch (see convertInstanceTransforms), all dirty
+  void                                setTransforms(uint32_t first, std::span<const shaderio::GltfInstance> instances);
+  void                                markAllDirty() { m_allDirty = !m_instances.empty(); }
+
+  bool     isDirty() const { return m_allDirty || !m_dirty.empty(); }
+  uint32_t getLastUploadCount() const { return m_lastUploadCount; }  // Instances copied by the last cmdUpload
+  uint32_t getLastRangeCount() const { return m_lastRangeCount; }    // Copy regions of the last cmdUpload
+
+  // Records the copy of the dirty instances to `instanceBuffer`, which holds all the instances in order, through the
+  // frame ring, or the staging uploader when the frame ring is too small. Followed by a barrier before the TLAS build.
+  // Returns true when the staging uploader was used: its staging buffers must be released once `cmd` completes.
+  bool cmdUpload(VkCommandBuffer        cmd,
+                 const nvvk::Buffer&    instanceBuffer,
+                 FrameRing&             frameRing,
+                 nvvk::StagingUploader& stagingUploader);
+
+private:
+  void markDirty(uint32_t index);
+
+  std::vector<VkAccelerationStructureInstanceKHR> m_instances;
+  std::vector<uint32_t>                           m_dirty;       // Indices of the dirty instances, unordered
+  std::vector<bool>                               m_dirtyFlags;  // Per instance, to add each index once
+  bool                                            m_allDirty        = false;
+  VkBuildAccelerationStructureFlagsKHR            m_buildFlags      = 0;
+  uint32_t                                        m_lastUploadCount = 0;
+  uint32_t                                        m_lastRangeCount  = 0;
+};
+
+}  // namespace nvsamples
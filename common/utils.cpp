@@ -18,40 +18,89 @@
  */
 
 #include <nvvk/staging.hpp>
-#include <nvvk/default_structs.hpp>
 #include <nvvk/check_error.hpp>
 #include <nvutils/timers.hpp>
 #include <nvutils/file_operations.hpp>
+#include <nvutils/file_mapping.hpp>
 
-#include <stb/stb_image.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <random>
 
+#include <fmt/format.h>
+
+#include "texture_utils.hpp"
 #include "utils.hpp"
 
 
 namespace nvsamples {
 
-nvvk::Image loadAndCreateImage(VkCommandBuffer cmd, nvvk::StagingUploader& staging, VkDevice device, const std::filesystem::path& filename, bool sRgb)
+// Multiply-xorshift hash consuming 8 bytes per step, with a murmur3-style finalizer
+uint64_t hashBytes(std::span<const uint8_t> data, uint64_t seed)
 {
-  // Load the image from disk
-  int            w, h, comp, req_comp{4};
-  std::string    filenameUtf8 = nvutils::utf8FromPath(filename);
-  const stbi_uc* data         = stbi_load(filenameUtf8.c_str(), &w, &h, &comp, req_comp);
-  assert((data != nullptr) && "Could not load texture image!");
-
-  // Define how to create the image
-  VkImageCreateInfo imageInfo = DEFAULT_VkImageCreateInfo;
-  imageInfo.format            = sRgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
-  imageInfo.usage             = VK_IMAGE_USAGE_SAMPLED_BIT;
-  imageInfo.extent            = {uint32_t(w), uint32_t(h), 1};
-
-  nvvk::ResourceAllocator* allocator = staging.getResourceAllocator();
-
-  // Use the VMA allocator to create the image
-  const std::span dataSpan(data, w * h * req_comp);
-  nvvk::Image     texture;
-  NVVK_CHECK(allocator->createImage(texture, imageInfo, DEFAULT_VkImageViewCreateInfo));
-  NVVK_CHECK(staging.appendImage(texture, dataSpan, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+  constexpr uint64_t kMul0 = 0x9E3779B97F4A7C15ull;
+  constexpr uint64_t kMul1 = 0xFF51AFD7ED558CCDull;
+  constexpr uint64_t kMul2 = 0xC4CEB9FE1A85EC53ull;
+
+  auto mix = [&](uint64_t h, uint64_t word) {
+    word *= kMul0;
+    word ^= word >> 32;
+    h = (h ^ word) * kMul1;
+    return h ^ (h >> 29);
+  };
 
+  uint64_t     h    = seed ^ (uint64_t(data.size()) * kMul0);
+  const size_t size = data.size();
+  size_t       i    = 0;
+  for(; i + 8 <= size; i += 8)
+  {
+    uint64_t word;
+    std::memcpy(&word, data.data() + i, sizeof(word));
+    h = mix(h, word);
+  }
+  if(i < size)
+  {
+    uint64_t word = 0;
+    std::memcpy(&word, data.data() + i, size - i);
+    h = mix(h, word);
+  }
+
+  h ^= h >> 33;
+  h *= kMul2;
+  h ^= h >> 33;
+  return h;
+}
+
+bool hashFile(const std::filesystem::path& filename, uint64_t& hash)
+{
+  nvutils::FileReadMapping mapping;
+  if(!mapping.open(filename))
+  {
+    return false;
+  }
+  hash = hashBytes({static_cast<const uint8_t*>(mapping.data()), mapping.size()});
+  return true;
+}
+
+std::filesystem::path getTempFilename(const std::filesystem::path& filename)
+{
+  // Random key of the process, and a counter for the files written by its threads
+  static const uint64_t processKey = ((uint64_t(std::random_device{}()) << 32) | std::random_device{}())
+                                     ^ uint64_t(std::chrono::steady_clock::now().time_since_epoch().count());
+  static std::atomic<uint32_t> counter{0};
+
+  std::filesystem::path tempFilename = filename;
+  tempFilename += fmt::format(".{:016x}_{}.tmp", processKey, counter++);
+  return tempFilename;
+}
+
+// Single texture version of loadAndCreateImages, with a full mip chain
+nvvk::Image loadAndCreateImage(nvvk::StagingUploader& staging, const std::filesystem::path& filename, bool sRgb)
+{
+  const TextureRequest request{.filename = filename, .sRgb = sRgb};
+  nvvk::Image          texture = loadAndCreateImages(staging, std::span(&request, 1)).front();
+  assert((texture.image != VK_NULL_HANDLE) && "Could not load texture image!");
   return texture;
 }
 
@@ -39,10 +39,17 @@ inline static VkShaderModuleCreateInfo getShaderModuleCreateInfo(const std::span
   };
 }
 
-nvvk::Image loadAndCreateImage(VkCommandBuffer              cmd,
-                               nvvk::StagingUploader&       staging,
-                               VkDevice                     device,
-                               const std::filesystem::path& filename,
-                               bool                         sRgb = true);
+// Fast non-cryptographic 64-bit hash, used to key the on-disk caches and to compare geometry
+uint64_t hashBytes(std::span<const uint8_t> data, uint64_t seed = 0);
+
+// Hash of the content of a file (read through a file mapping), returns false if the file cannot be read
+bool hashFile(const std::filesystem::path& filename, uint64_t& hash);
+
+// Unique temporary file next to `filename`, to write a cache file before renaming it to `filename`: the processes and
+// threads writing the same cache at the same time never share a temporary file
+std::filesystem::path getTempFilename(const std::filesystem::path& filename);
+
+// Loads an image file as a texture with its full mip chain (see loadAndCreateImages in texture_utils.hpp)
+nvvk::Image loadAndCreateImage(nvvk::StagingUploader& staging, const std::filesystem::path& filename, bool sRgb = true);
 
 }  // namespace nvsamples
\ No newline at end of file
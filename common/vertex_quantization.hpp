@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+// Host side encoding and decoding of the quantized vertex formats (shaderio::VertexFormat).
+// The shader side decoding is in shaders/vertex_attributes.h.slang and must stay in sync.
+
+#include <cmath>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+namespace nvsamples {
+
+inline int16_t quantizeSnorm16(float v)
+{
+  return int16_t(std::lround(glm::clamp(v, -1.0f, 1.0f) * 32767.0f));
+}
+
+inline float dequantizeSnorm16(int16_t v)
+{
+  return glm::max(float(v) / 32767.0f, -1.0f);
+}
+
+// Octahedral mapping of a unit vector to [-1,1]^2
+inline glm::vec2 octEncode(glm::vec3 n)
+{
+  n /= (std::abs(n.x) + std::abs(n.y) + std::abs(n.z)) + 1e-20f;
+  glm::vec2 p(n.x, n.y);
+  if(n.z < 0.0f)
+  {
+    const glm::vec2 signNotZero(p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f);
+    p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * signNotZero;
+  }
+  return p;
+}
+
+inline glm::vec3 octDecode(glm::vec2 p)
+{
+  glm::vec3 n(p.x, p.y, 1.0f - std::abs(p.x) - std::abs(p.y));
+  const float t = glm::max(-n.z, 0.0f);
+  n.x += n.x >= 0.0f ? -t : t;
+  n.y += n.y >= 0.0f ? -t : t;
+  return glm::normalize(n);
+}
+
+// eVertexFormatSnorm16 position, relative to the mesh dequantization: position = snorm * scale + offset
+struct QuantizedPosition
+{
+  int16_t x, y, z, w;
+};
+
+// eVertexFormatOct16 normal or tangent, the tangent sign (w) is stored in the lowest bit of y
+struct QuantizedDirection
+{
+  int16_t x, y;
+};
+
+// eVertexFormatFloat16 texture coordinates
+struct QuantizedTexCoord
+{
+  uint16_t u, v;
+};
+
+inline QuantizedPosition quantizePosition(const glm::vec3& pos, const glm::vec3& scale, const glm::vec3& offset)
+{
+  const glm::vec3 v = (pos - offset) / scale;
+  return {quantizeSnorm16(v.x), quantizeSnorm16(v.y), quantizeSnorm16(v.z), 0};
+}
+
+inline glm::vec3 dequantizePosition(const QuantizedPosition& q, const glm::vec3& scale, const glm::vec3& offset)
+{
+  return glm::vec3(dequantizeSnorm16(q.x), dequantizeSnorm16(q.y), dequantizeSnorm16(q.z)) * scale + offset;
+}
+
+inline QuantizedDirection quantizeDirection(const glm::vec3& dir, float sign = 1.0f)
+{
+  const glm::vec2 p = octEncode(dir);
+  QuantizedDirection q{quantizeSnorm16(p.x), quantizeSnorm16(p.y)};
+  q.y = int16_t((q.y & ~1) | (sign < 0.0f ? 1 : 0));
+  return q;
+}
+
+inline glm::vec4 dequantizeDirection(const QuantizedDirection& q)
+{
+  const glm::vec3 n = octDecode(glm::vec2(dequantizeSnorm16(q.x), dequantizeSnorm16(q.y)));
+  return glm::vec4(n, (q.y & 1) ? -1.0f : 1.0f);
+}
+
+inline QuantizedTexCoord quantizeTexCoord(const glm::vec2& uv)
+{
+  return {uint16_t(glm::packHalf1x16(uv.x)), uint16_t(glm::packHalf1x16(uv.y))};
+}
+
+inline glm::vec2 dequantizeTexCoord(const QuantizedTexCoord& q)
+{
+  return glm::vec2(glm::unpackHalf1x16(q.u), glm::unpackHalf1x16(q.v));
+}
+
+}  // namespace nvsamples
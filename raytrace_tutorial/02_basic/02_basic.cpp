@@ -81,9 +81,12 @@
 #include <nvutils/parameter_parser.hpp>    // Parameter parser
 
 
-#include "common/gltf_utils.hpp"  // GLTF utilities for loading and importing GLTF models
-#include "common/utils.hpp"       // Common utilities for the sample application
-#include "common/path_utils.hpp"  // Path utilities for handling resources file paths
+#include "common/blas_batch_builder.hpp"  // Batched builds of the bottom-level acceleration structures
+#include "common/blas_compactor.hpp"      // Compaction of the bottom-level acceleration structures
+#include "common/gltf_utils.hpp"          // GLTF utilities for loading and importing GLTF models
+#include "common/utils.hpp"               // Common utilities for the sample application
+#include "common/path_utils.hpp"          // Path utilities for handling resources file paths
+#include "common/texture_utils.hpp"       // Parallel loading of the textures
 
 //---------------------------------------------------------------------------------------
 // Ray Tracing Tutorial
@@ -203,10 +206,7 @@ public:
     m_allocator.destroyBuffer(m_sceneResource.bMeshes);
     m_allocator.destroyBuffer(m_sceneResource.bMaterials);
     m_allocator.destroyBuffer(m_sceneResource.bInstances);
-    for(auto& gltfData : m_sceneResource.bGltfDatas)
-    {
-      m_allocator.destroyBuffer(gltfData);
-    }
+    m_sceneResource.geometryArena.deinit();
     for(auto& texture : m_textures)
     {
       m_allocator.destroyImage(texture);
@@ -392,13 +392,19 @@ public:
       tinygltf::Model planeModel =
           nvsamples::loadGltfResources(nvutils::findFile("plane.gltf", nvsamples::getResourcesDirs()));  // Load the GLTF resources from the file
 
-      // Textures
+      // Textures: decoded in parallel with their mip chain, which is kept in the texture cache for the next runs
       {
-        std::filesystem::path imageFilename = nvutils::findFile("tiled_floor.png", nvsamples::getResourcesDirs());
-        nvvk::Image texture = nvsamples::loadAndCreateImage(cmd, m_stagingUploader, m_app->getDevice(), imageFilename);  // Load the image from the file and create a texture from it
-        NVVK_DBG_NAME(texture.image);
-        m_samplerPool.acquireSampler(texture.descriptor.sampler);
-        m_textures.emplace_back(texture);  // Store the texture in the vector of textures
+        const nvsamples::TextureRequest textureRequests[] = {
+            {.filename = nvutils::findFile("tiled_floor.png", nvsamples::getResourcesDirs())},
+        };
+        const nvsamples::TextureLoadOptions textureOptions{.cacheDirectory = nvsamples::getCacheDir()};
+        for(nvvk::Image& texture : nvsamples::loadAndCreateImages(m_stagingUploader, textureRequests, textureOptions))
+        {
+          assert((texture.image != VK_NULL_HANDLE) && "Could not load texture image!");
+          NVVK_DBG_NAME(texture.image);
+          m_samplerPool.acquireSampler(texture.descriptor.sampler);
+          m_textures.emplace_back(texture);  // Store the texture in the vector of textures
+        }
       }
 
       // Upload the GLTF resources to the GPU
@@ -713,11 +719,11 @@ public:
       vkCmdPushConstants2(cmd, &pushInfo);
 
       // Get the buffer directly using the pre-computed mapping
-      uint32_t            bufferIndex = m_sceneResource.meshToBufferIndex[meshIndex];
-      const nvvk::Buffer& v           = m_sceneResource.bGltfDatas[bufferIndex];
+      const nvvk::Buffer& v = m_sceneResource.getMeshBuffer(meshIndex);
 
       // Bind index buffers
-      vkCmdBindIndexBuffer(cmd, v.buffer, triMesh.indices.offset, VkIndexType(gltfMesh.indexType));
+      vkCmdBindIndexBuffer(cmd, v.buffer, m_sceneResource.getMeshBufferOffset(meshIndex) + triMesh.indices.offset,
+                           VkIndexType(gltfMesh.indexType));
 
       // Draw the mesh
       vkCmdDrawIndexed(cmd, triMesh.indices.count, 1, 0, 0, 0);  // All indices
@@ -738,6 +744,9 @@ public:
   // Accessor for camera manipulator
   std::shared_ptr<nvutils::CameraManipulator> getCameraManipulator() const { return m_cameraManip; }
 
+  // Compacts the bottom-level acceleration structures after their build, must be set before onAttach
+  void setCompactBlas(bool compact) { m_compactBlas = compact; }
+
   //--------------------------------------------------------------------------------------------------
   // Converting a PrimitiveMesh as input for BLAS
   //
@@ -850,19 +859,50 @@ public:
     // Prepare geometry information for all meshes
     m_blasAccel.resize(m_sceneResource.meshes.size());
 
+    // Compaction needs to be allowed at build time
+    VkBuildAccelerationStructureFlagsKHR buildFlags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+    if(m_compactBlas)
+    {
+      buildFlags |= VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR;
+    }
+
     // One BLAS per primitive
+    std::vector<nvsamples::BlasBatchBuilder::Input> blasInputs(m_sceneResource.meshes.size());
     for(uint32_t blasId = 0; blasId < m_sceneResource.meshes.size(); blasId++)
     {
-      VkAccelerationStructureGeometryKHR       asGeometry{};
-      VkAccelerationStructureBuildRangeInfoKHR asBuildRangeInfo{};
-
       // Convert the primitive information to acceleration structure geometry
-      primitiveToGeometry(m_sceneResource.meshes[blasId], asGeometry, asBuildRangeInfo);
+      primitiveToGeometry(m_sceneResource.meshes[blasId], blasInputs[blasId].geometry, blasInputs[blasId].rangeInfo);
+      blasInputs[blasId].flags = buildFlags;
+    }
 
-      createAccelerationStructure(VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, m_blasAccel[blasId], asGeometry,
-                                  asBuildRangeInfo, VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR);
-      NVVK_DBG_NAME(m_blasAccel[blasId].accel);
+    // Unlike createAccelerationStructure, the builds are batched in a few vkCmdBuildAccelerationStructuresKHR calls
+    // sharing a bounded scratch buffer, with a single submit and wait for all of them
+    nvsamples::BlasBatchBuilder blasBuilder;
+    blasBuilder.init(&m_allocator, m_asProperties.minAccelerationStructureScratchOffsetAlignment);
+
+    nvsamples::BlasCompactor compactor;
+    compactor.init(&m_allocator);
+
+    VkCommandBuffer cmd = m_app->createTempCmdBuffer();
+    blasBuilder.cmdCreateAndBuild(cmd, blasInputs, m_blasAccel);
+    if(m_compactBlas)
+    {
+      // The compacted sizes are queried once the builds are done
+      compactor.cmdQuerySizes(cmd, m_blasAccel);
+    }
+    m_app->submitAndWaitTempCmdBuffer(cmd);
+    blasBuilder.deinit();
+
+    if(m_compactBlas)
+    {
+      // Each BLAS is copied in a right-sized acceleration structure and the original is released
+      cmd = m_app->createTempCmdBuffer();
+      compactor.cmdCompact(cmd, m_blasAccel);
+      m_app->submitAndWaitTempCmdBuffer(cmd);
+
+      compactor.destroyOriginals();
     }
+    compactor.deinit();
   }
 
 
@@ -1195,6 +1235,7 @@ private:
   // Acceleration Structure Components
   std::vector<nvvk::AccelerationStructure> m_blasAccel;
   nvvk::AccelerationStructure              m_tlasAccel;
+  bool                                     m_compactBlas = false;  // Compact the BLAS, see createBottomLevelAS
 
   // Direct SBT management
   nvvk::Buffer                    m_sbtBuffer;         // Buffer for shader binding table
@@ -1218,11 +1259,13 @@ private:
 int main(int argc, char** argv)
 {
   nvapp::ApplicationCreateInfo appInfo{};
+  bool                         compactBlas = false;
 
   // Parsing the command line
   nvutils::ParameterParser   cli(nvutils::getExecutablePath().stem().string());
   nvutils::ParameterRegistry reg;
   reg.add({"headless", "Run in headless mode"}, &appInfo.headless, true);
+  reg.add({"compactBlas", "Compact the bottom-level acceleration structures"}, &compactBlas, true);
   cli.add(reg);
   cli.parse(argc, argv);
 
@@ -1285,6 +1328,7 @@ int main(int argc, char** argv)
 
   // Elements added to the application
   auto tutorial   = std::make_shared<RtBasic>();               // Our tutorial element
+  tutorial->setCompactBlas(compactBlas);
   auto elemCamera = std::make_shared<nvapp::ElementCamera>();  // Element to control the camera movement
   auto windowTitle = std::make_shared<nvapp::ElementDefaultWindowTitle>();  // Element displaying the window title with application name and size
   auto windowMenu = std::make_shared<nvapp::ElementDefaultMenu>();  // Element displaying a menu, File->Exit ...
@@ -212,10 +212,7 @@ public:
     m_allocator.destroyBuffer(m_sceneResource.bMeshes);
     m_allocator.destroyBuffer(m_sceneResource.bMaterials);
     m_allocator.destroyBuffer(m_sceneResource.bInstances);
-    for(auto& gltfData : m_sceneResource.bGltfDatas)
-    {
-      m_allocator.destroyBuffer(gltfData);
-    }
+    m_sceneResource.geometryArena.deinit();
     for(auto& texture : m_textures)
     {
       m_allocator.destroyImage(texture);
@@ -403,7 +400,7 @@ public:
       // Textures
       {
         std::filesystem::path imageFilename = nvutils::findFile("tiled_floor.png", nvsamples::getResourcesDirs());
-        nvvk::Image texture = nvsamples::loadAndCreateImage(cmd, m_stagingUploader, m_app->getDevice(), imageFilename);  // Load the image from the file and create a texture from it
+        nvvk::Image texture = nvsamples::loadAndCreateImage(m_stagingUploader, imageFilename);  // Load the image from the file and create a texture from it
         NVVK_DBG_NAME(texture.image);
         m_samplerPool.acquireSampler(texture.descriptor.sampler);
         m_textures.emplace_back(texture);  // Store the texture in the vector of textures
@@ -721,11 +718,11 @@ public:
       vkCmdPushConstants2(cmd, &pushInfo);
 
       // Get the buffer directly using the pre-computed mapping
-      uint32_t            bufferIndex = m_sceneResource.meshToBufferIndex[meshIndex];
-      const nvvk::Buffer& v           = m_sceneResource.bGltfDatas[bufferIndex];
+      const nvvk::Buffer& v = m_sceneResource.getMeshBuffer(meshIndex);
 
       // Bind index buffers
-      vkCmdBindIndexBuffer(cmd, v.buffer, triMesh.indices.offset, VkIndexType(gltfMesh.indexType));
+      vkCmdBindIndexBuffer(cmd, v.buffer, m_sceneResource.getMeshBufferOffset(meshIndex) + triMesh.indices.offset,
+                           VkIndexType(gltfMesh.indexType));
 
       // Draw the mesh
       vkCmdDrawIndexed(cmd, triMesh.indices.count, 1, 0, 0, 0);  // All indices
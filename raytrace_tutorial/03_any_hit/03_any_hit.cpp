@@ -145,31 +145,11 @@ public:
   //
   nvvk::AccelerationStructureGeometryInfo primitiveToGeometry(const shaderio::GltfMesh& gltfMesh) override
   {
-    nvvk::AccelerationStructureGeometryInfo result = {};
-
-    const shaderio::TriangleMesh triMesh       = gltfMesh.triMesh;
-    const auto                   triangleCount = static_cast<uint32_t>(triMesh.indices.count / 3U);
-
-    // Describe buffer as array of VertexObj.
-    VkAccelerationStructureGeometryTrianglesDataKHR triangles{
-        .sType        = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR,
-        .vertexFormat = VK_FORMAT_R32G32B32_SFLOAT,  // vec3 vertex position data
-        .vertexData   = {.deviceAddress = VkDeviceAddress(gltfMesh.gltfBuffer) + triMesh.positions.offset},
-        .vertexStride = triMesh.positions.byteStride,
-        .maxVertex    = triMesh.positions.count - 1,
-        .indexType    = VkIndexType(gltfMesh.indexType),  // Index type (VK_INDEX_TYPE_UINT16 or VK_INDEX_TYPE_UINT32)
-        .indexData    = {.deviceAddress = VkDeviceAddress(gltfMesh.gltfBuffer) + triMesh.indices.offset},
-    };
-
-    // Identify the above data as containing opaque triangles.
-    result.geometry = VkAccelerationStructureGeometryKHR{
-        .sType        = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
-        .geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR,
-        .geometry     = {.triangles = triangles},
-        .flags = VK_GEOMETRY_NO_DUPLICATE_ANY_HIT_INVOCATION_BIT_KHR,  // Removed VK_GEOMETRY_OPAQUE_BIT_KHR so the Anyhit is called
-    };
+    // Same geometry as the base class (vertex format, quantized positions, ...)
+    nvvk::AccelerationStructureGeometryInfo result = RtBase::primitiveToGeometry(gltfMesh);
 
-    result.rangeInfo = VkAccelerationStructureBuildRangeInfoKHR{.primitiveCount = triangleCount};
+    // Removed VK_GEOMETRY_OPAQUE_BIT_KHR so the Anyhit is called
+    result.geometry.flags = VK_GEOMETRY_NO_DUPLICATE_ANY_HIT_INVOCATION_BIT_KHR;
 
     return result;
   }
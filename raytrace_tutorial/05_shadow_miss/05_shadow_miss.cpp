@@ -203,11 +203,13 @@ public:
 int main(int argc, char** argv)
 {
   nvapp::ApplicationCreateInfo appInfo{};
+  bool                         cpuRaytracing = false;
 
   // Parsing the command line
   nvutils::ParameterParser   cli(nvutils::getExecutablePath().stem().string());
   nvutils::ParameterRegistry reg;
   reg.add({"headless", "Run in headless mode"}, &appInfo.headless, true);
+  reg.add({"cpuRaytracing", "Trace the rays on the CPU, for the devices without ray tracing support"}, &cpuRaytracing, true);
   cli.add(reg);
   cli.parse(argc, argv);
 
@@ -222,12 +224,17 @@ int main(int argc, char** argv)
           {
               {VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME},
               {VK_EXT_SHADER_OBJECT_EXTENSION_NAME, &shaderObjectFeatures},
-              {VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME, &accelFeature},     // To build acceleration structures
-              {VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME, &rtPipelineFeature},  // To use vkCmdTraceRaysKHR
-              {VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME},                  // Required by ray tracing pipeline
           },
   };
 
+  // The CPU ray tracer needs no ray tracing support from the device
+  if(!cpuRaytracing)
+  {
+    vkSetup.deviceExtensions.push_back({VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME, &accelFeature});  // To build acceleration structures
+    vkSetup.deviceExtensions.push_back({VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME, &rtPipelineFeature});  // vkCmdTraceRaysKHR
+    vkSetup.deviceExtensions.push_back({VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME});  // Required by ray tracing pipeline
+  }
+
   if(!appInfo.headless)
   {
     nvvk::addSurfaceExtensions(vkSetup.instanceExtensions, &vkSetup.deviceExtensions);
@@ -253,6 +260,7 @@ int main(int argc, char** argv)
 
   // Elements added to the application
   auto tutorial    = std::make_shared<RtShadowMiss>();
+  tutorial->setCpuRaytracing(cpuRaytracing);
   auto elemCamera  = std::make_shared<nvapp::ElementCamera>();
   auto windowTitle = std::make_shared<nvapp::ElementDefaultWindowTitle>();
   auto windowMenu  = std::make_shared<nvapp::ElementDefaultMenu>();
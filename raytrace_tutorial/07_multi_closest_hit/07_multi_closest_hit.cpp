@@ -256,21 +256,11 @@ public:
   // This function was overload because we are modifying the shader binding table (SBT) offset
   void createTopLevelAS() override
   {
-    std::vector<VkAccelerationStructureInstanceKHR> tlasInstances;
-    tlasInstances.reserve(m_sceneResource.instances.size());
-    const VkGeometryInstanceFlagsKHR flags{VK_GEOMETRY_INSTANCE_TRIANGLE_CULL_DISABLE_BIT_NV};  // Makes the instance visible to all rays (double sided)
-    for(size_t i = 0; i < m_sceneResource.instances.size(); i++)
+    std::vector<VkAccelerationStructureInstanceKHR> tlasInstances(m_sceneResource.instances.size());
+    nvsamples::convertInstances(m_sceneResource.instances, {.blasSet = m_asBuilder.blasSet}, tlasInstances);
+    for(size_t i = 0; i < tlasInstances.size(); i++)
     {
-      const shaderio::GltfInstance&      instance = m_sceneResource.instances[i];
-      VkAccelerationStructureInstanceKHR tlasInst{};
-      tlasInst.transform                      = nvvk::toTransformMatrixKHR(instance.transform);
-      tlasInst.instanceCustomIndex            = instance.meshIndex;
-      tlasInst.accelerationStructureReference = m_asBuilder.blasSet[instance.meshIndex].address;
-
-      tlasInst.instanceShaderBindingTableRecordOffset = m_shaderGroupIndices[i];  // <-- here we set the shader group index for each instance
-      tlasInst.flags = flags;
-      tlasInst.mask  = 0xFF;
-      tlasInstances.emplace_back(tlasInst);
+      tlasInstances[i].instanceShaderBindingTableRecordOffset = m_shaderGroupIndices[i];  // <-- here we set the shader group index for each instance
     }
     m_asBuilder.tlasSubmitBuildAndWait(tlasInstances, VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR);
   }
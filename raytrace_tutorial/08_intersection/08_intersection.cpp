@@ -37,6 +37,7 @@
     printf("\n");                                                                                                      \
   }
 
+#include <functional>
 #include <random>
 
 #include "shaders/shaderio.h"
@@ -48,6 +49,7 @@
 
 // Common base class (see 02_basic)
 #include "common/rt_base.hpp"
+#include "common/spatial_chunks.hpp"  // Splitting the implicit objects in several BLAS
 
 
 class RtIntersection : public RtBase
@@ -56,6 +58,10 @@ public:
   RtIntersection()           = default;
   ~RtIntersection() override = default;
 
+  // Maximum number of implicit objects in a BLAS, 0 puts all of them in a single BLAS. Set before onAttach or through
+  // the UI.
+  void setChunkSize(uint32_t chunkSize) { m_chunkSize = chunkSize; }
+
   //-------------------------------------------------------------------------------
   // Override virtual methods from RtBase
   //-------------------------------------------------------------------------------
@@ -67,6 +73,57 @@ public:
       ImGui::SeparatorText("Intersection Shader");
       ImGui::Text("Rendering 2,000,000 implicit objects");
       ImGui::Text("Alternating spheres and cubes");
+
+      ImGui::SeparatorText("BLAS Chunks");
+      bool chunkSizeChanged = false;
+      if(ImGui::BeginCombo("Chunk size", getChunkSizeName(m_chunkSize).c_str()))
+      {
+        for(uint32_t chunkSize : kChunkSizes)
+        {
+          if(ImGui::Selectable(getChunkSizeName(chunkSize).c_str(), chunkSize == m_chunkSize))
+          {
+            chunkSizeChanged = chunkSize != m_chunkSize;
+            m_chunkSize      = chunkSize;
+          }
+        }
+        ImGui::EndCombo();
+      }
+      ImGui::Text("%u BLAS, build %.3f ms", uint32_t(m_sphereChunks.size()), m_chunkStats.buildTime);
+      if(m_chunkStats.traceTime > 0)
+        ImGui::Text("Trace %.3f ms", m_chunkStats.traceTime);
+      else
+        ImGui::TextUnformatted("Trace: not measured");
+      const bool measure = ImGui::Button("Measure");
+      if(chunkSizeChanged || measure)
+      {
+        rebuildChunks();
+      }
+      ImGui::SameLine();
+      if(ImGui::Button("Compare chunk sizes"))
+      {
+        compareChunkSizes();
+      }
+      if(!m_chunkComparison.empty() && ImGui::BeginTable("ChunkComparison", 4, ImGuiTableFlags_Borders))
+      {
+        ImGui::TableSetupColumn("Chunk size");
+        ImGui::TableSetupColumn("BLAS");
+        ImGui::TableSetupColumn("Build (ms)");
+        ImGui::TableSetupColumn("Trace (ms)");
+        ImGui::TableHeadersRow();
+        for(const ChunkStats& stats : m_chunkComparison)
+        {
+          ImGui::TableNextRow();
+          ImGui::TableNextColumn();
+          ImGui::TextUnformatted(getChunkSizeName(stats.chunkSize).c_str());
+          ImGui::TableNextColumn();
+          ImGui::Text("%u", stats.blasCount);
+          ImGui::TableNextColumn();
+          ImGui::Text("%.3f", stats.buildTime);
+          ImGui::TableNextColumn();
+          ImGui::Text("%.3f", stats.traceTime);
+        }
+        ImGui::EndTable();
+      }
     }
     ImGui::End();
     RtBase::onUIRender();
@@ -120,46 +177,50 @@ public:
     SCOPED_TIMER(__FUNCTION__);
 
     // Create BLAS for triangle meshes
-    std::vector<nvvk::AccelerationStructureGeometryInfo> geoInfos(m_sceneResource.meshes.size());
+    std::vector<nvsamples::BlasBatchBuilder::Input> blasInputs;
     for(uint32_t p_idx = 0; p_idx < m_sceneResource.meshes.size(); p_idx++)
     {
-      geoInfos[p_idx] = primitiveToGeometry(m_sceneResource.meshes[p_idx]);
+      const nvvk::AccelerationStructureGeometryInfo geo = primitiveToGeometry(m_sceneResource.meshes[p_idx]);
+      blasInputs.push_back({.geometry = geo.geometry, .rangeInfo = geo.rangeInfo});
     }
 
-    // Add BLAS for implicit objects (spheres/cubes)
+    // Add a BLAS for each chunk of implicit objects (spheres/cubes), the chunks are compact regions of the space
+    if(m_chunkSize == 0)
+      m_sphereChunks = {{.first = 0, .count = uint32_t(m_spheres.size())}};
+    else
+      m_sphereChunks = nvsamples::splitMortonChunks(m_sphereCodes, m_chunkSize);
+    for(const nvsamples::SpatialChunk& chunk : m_sphereChunks)
     {
-      nvvk::AccelerationStructureGeometryInfo blas = sphereToVkGeometryKHR();
-      geoInfos.emplace_back(blas);
+      const nvvk::AccelerationStructureGeometryInfo geo = sphereToVkGeometryKHR(chunk);
+      blasInputs.push_back({.geometry = geo.geometry, .rangeInfo = geo.rangeInfo});
     }
 
-    m_asBuilder.blasSubmitBuildAndWait(geoInfos, VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR);
+    // All the BLAS are built in one submit, timed on the GPU to compare the chunk sizes
+    nvsamples::BlasBatchBuilder blasBuilder;
+    blasBuilder.init(&m_allocator, m_asProperties.minAccelerationStructureScratchOffsetAlignment);
+    m_asBuilder.blasSet.resize(blasInputs.size());
+    m_chunkStats = {.chunkSize = m_chunkSize, .blasCount = uint32_t(m_sphereChunks.size())};
+    m_chunkStats.buildTime =
+        measureGpuTime(1, [&](VkCommandBuffer cmd) { blasBuilder.cmdCreateAndBuild(cmd, blasInputs, m_asBuilder.blasSet); });
+    blasBuilder.deinit();
   }
 
   void createTopLevelAS() override
   {
-    std::vector<VkAccelerationStructureInstanceKHR> tlasInstances;
-    tlasInstances.reserve(m_sceneResource.instances.size() + 1);  // +1 for implicit objects
-    const VkGeometryInstanceFlagsKHR flags{VK_GEOMETRY_INSTANCE_TRIANGLE_CULL_DISABLE_BIT_NV};
+    std::vector<VkAccelerationStructureInstanceKHR> tlasInstances(m_sceneResource.instances.size());
+    tlasInstances.reserve(m_sceneResource.instances.size() + m_sphereChunks.size());  // + chunks of implicit objects
 
     // Add triangle instances
-    for(const shaderio::GltfInstance& instance : m_sceneResource.instances)
-    {
-      VkAccelerationStructureInstanceKHR ray_inst{};
-      ray_inst.transform                              = nvvk::toTransformMatrixKHR(instance.transform);
-      ray_inst.instanceCustomIndex                    = instance.meshIndex;
-      ray_inst.accelerationStructureReference         = m_asBuilder.blasSet[instance.meshIndex].address;
-      ray_inst.instanceShaderBindingTableRecordOffset = 0;
-      ray_inst.flags                                  = flags;
-      ray_inst.mask                                   = 0xFF;
-      tlasInstances.emplace_back(ray_inst);
-    }
+    nvsamples::convertInstances(m_sceneResource.instances, {.blasSet = m_asBuilder.blasSet}, tlasInstances);
 
-    // Add the BLAS containing all implicit objects
+    // Add the BLAS of each chunk of implicit objects, the first object of the chunk is the custom index: the shaders
+    // find the object with InstanceID() + PrimitiveIndex()
+    for(size_t c = 0; c < m_sphereChunks.size(); c++)
     {
       VkAccelerationStructureInstanceKHR rayInst{};
       rayInst.transform           = nvvk::toTransformMatrixKHR(glm::mat4(1));
-      rayInst.instanceCustomIndex = static_cast<uint32_t>(m_sceneResource.instances.size());
-      rayInst.accelerationStructureReference = m_asBuilder.blasSet[static_cast<uint32_t>(m_sceneResource.meshes.size())].address;
+      rayInst.instanceCustomIndex = m_sphereChunks[c].first;
+      rayInst.accelerationStructureReference = m_asBuilder.blasSet[m_sceneResource.meshes.size() + c].address;
       rayInst.instanceShaderBindingTableRecordOffset = 1;  // Use hit group 1 for implicit objects
       rayInst.flags                                  = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
       rayInst.mask                                   = 0xFF;
@@ -276,9 +337,22 @@ public:
     m_allocator.destroyBuffer(m_spheresAabbBuffer);
     m_allocator.destroyBuffer(m_spheresMatColorBuffer);
     m_allocator.destroyBuffer(m_spheresMatIndexBuffer);
+    vkDestroyQueryPool(m_app->getDevice(), m_queryPool, nullptr);
   }
 
 private:
+  // Chunk sizes offered in the UI, 0 is a single BLAS
+  static constexpr std::array<uint32_t, 6> kChunkSizes = {0, 1 << 20, 1 << 18, 1 << 16, 1 << 14, 1 << 12};
+  static constexpr uint32_t                kTraceCount = 8;  // Traces measured for each chunk size
+
+  struct ChunkStats
+  {
+    uint32_t chunkSize = 0;
+    uint32_t blasCount = 0;
+    double   buildTime = 0;  // GPU time of all the BLAS builds, ms
+    double   traceTime = 0;  // GPU time of a frame, ms
+  };
+
   // Implicit object buffers
   std::vector<shaderio::Sphere> m_spheres;
   nvvk::Buffer                  m_spheresBuffer;
@@ -286,6 +360,14 @@ private:
   nvvk::Buffer                  m_spheresMatColorBuffer;
   nvvk::Buffer                  m_spheresMatIndexBuffer;
 
+  // Chunks of implicit objects, one BLAS each
+  std::vector<uint32_t>                m_sphereCodes;   // Morton codes of the spheres, which are sorted along them
+  std::vector<nvsamples::SpatialChunk> m_sphereChunks;  // Spheres of each BLAS
+  uint32_t                             m_chunkSize = 0;
+  ChunkStats                           m_chunkStats;       // Of the current chunk size
+  std::vector<ChunkStats>              m_chunkComparison;  // See compareChunkSizes
+  VkQueryPool                          m_queryPool{};
+
   //--------------------------------------------------------------------------------------------------
   // Creating all spheres
   //
@@ -298,13 +380,23 @@ private:
     std::uniform_real_distribution<float> radd{.05f, .2f};
 
     // All spheres
-    m_spheres.resize(nbSpheres);
+    std::vector<shaderio::Sphere> spheres(nbSpheres);
+    std::vector<glm::vec3>        centers(nbSpheres);
     for(uint32_t i = 0; i < nbSpheres; i++)
     {
       shaderio::Sphere s;
-      s.center     = glm::vec3(xzd(gen), yd(gen), xzd(gen));
-      s.radius     = radd(gen);
-      m_spheres[i] = std::move(s);
+      s.center   = glm::vec3(xzd(gen), yd(gen), xzd(gen));
+      s.radius   = radd(gen);
+      centers[i] = s.center;
+      spheres[i] = std::move(s);
+    }
+
+    // Sorted along a Morton curve: the spheres of a BLAS chunk are consecutive, see createBottomLevelAS
+    const std::vector<uint32_t> order = nvsamples::sortByMortonCode(centers, m_sphereCodes);
+    m_spheres.resize(nbSpheres);
+    for(uint32_t i = 0; i < nbSpheres; i++)
+    {
+      m_spheres[i] = spheres[order[i]];
     }
 
     // Axis aligned bounding box of each sphere
@@ -366,9 +458,9 @@ private:
   }
 
   //--------------------------------------------------------------------------------------------------
-  // Returning the ray tracing geometry used for the BLAS, containing all spheres
+  // Returning the ray tracing geometry used for the BLAS, containing the spheres of the chunk
   //
-  nvvk::AccelerationStructureGeometryInfo sphereToVkGeometryKHR() const
+  nvvk::AccelerationStructureGeometryInfo sphereToVkGeometryKHR(const nvsamples::SpatialChunk& chunk) const
   {
     // Setting up the build info of the acceleration for AABB
     VkAccelerationStructureGeometryKHR geometry{VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR};
@@ -376,12 +468,92 @@ private:
     geometry.flags                             = VK_GEOMETRY_OPAQUE_BIT_KHR;
     geometry.geometry.aabbs.sType              = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_AABBS_DATA_KHR;
     geometry.geometry.aabbs.stride             = sizeof(shaderio::Aabb);
-    geometry.geometry.aabbs.data.deviceAddress = m_spheresAabbBuffer.address;
+    geometry.geometry.aabbs.data.deviceAddress = m_spheresAabbBuffer.address + chunk.first * sizeof(shaderio::Aabb);
 
-    VkAccelerationStructureBuildRangeInfoKHR rangeInfo{.primitiveCount = uint32_t(m_spheres.size())};  // Nb aabb
+    VkAccelerationStructureBuildRangeInfoKHR rangeInfo{.primitiveCount = chunk.count};  // Nb aabb
 
     return {geometry, rangeInfo};
   }
+
+  std::string getChunkSizeName(uint32_t chunkSize) const
+  {
+    return chunkSize == 0 ? std::string("Single BLAS") : fmt::format("{}K", chunkSize >> 10);
+  }
+
+  //--------------------------------------------------------------------------------------------------
+  // Records `record` `count` times with a timestamp after each one, returns the average time in ms
+  //
+  double measureGpuTime(uint32_t count, const std::function<void(VkCommandBuffer)>& record)
+  {
+    assert(count <= kTraceCount);
+    VkDevice device = m_app->getDevice();
+    if(m_queryPool == VK_NULL_HANDLE)
+    {
+      const VkQueryPoolCreateInfo queryPoolInfo{
+          .sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+          .queryType  = VK_QUERY_TYPE_TIMESTAMP,
+          .queryCount = kTraceCount + 1,
+      };
+      NVVK_CHECK(vkCreateQueryPool(device, &queryPoolInfo, nullptr, &m_queryPool));
+      NVVK_DBG_NAME(m_queryPool);
+    }
+
+    VkCommandBuffer cmd = m_app->createTempCmdBuffer();
+    vkCmdResetQueryPool(cmd, m_queryPool, 0, count + 1);
+    vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, m_queryPool, 0);
+    for(uint32_t i = 0; i < count; i++)
+    {
+      record(cmd);
+      vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, m_queryPool, i + 1);
+    }
+    m_frameRing.flush();  // `record` may have written to the frame ring
+    m_app->submitAndWaitTempCmdBuffer(cmd);
+
+    std::array<uint64_t, kTraceCount + 1> ticks{};
+    NVVK_CHECK(vkGetQueryPoolResults(device, m_queryPool, 0, count + 1, sizeof(ticks), ticks.data(), sizeof(uint64_t),
+                                     VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(m_app->getPhysicalDevice(), &properties);
+    return double(ticks[count] - ticks[0]) * properties.limits.timestampPeriod * 1e-6 / count;
+  }
+
+  //--------------------------------------------------------------------------------------------------
+  // Recreates the acceleration structures with the current chunk size, and measures their build and trace times
+  //
+  void rebuildChunks()
+  {
+    vkDeviceWaitIdle(m_app->getDevice());
+    m_asBuilder.deinitAccelerationStructures();
+    createBottomLevelAS();
+    createTopLevelAS();
+
+    // The frame is not being recorded: its region of the frame ring is free
+    m_frameRing.beginFrame(m_app->getFrameCycleIndex());
+    m_chunkStats.traceTime = measureGpuTime(kTraceCount, [&](VkCommandBuffer cmd) {
+      updateSceneBuffer(cmd);
+      raytraceScene(cmd);
+    });
+    m_frameRing.endFrame();
+  }
+
+  //--------------------------------------------------------------------------------------------------
+  // Build and trace times of all the chunk sizes, the current one is restored
+  //
+  void compareChunkSizes()
+  {
+    const uint32_t currentChunkSize = m_chunkSize;
+    m_chunkComparison.clear();
+    for(uint32_t chunkSize : kChunkSizes)
+    {
+      m_chunkSize = chunkSize;
+      rebuildChunks();
+      m_chunkComparison.push_back(m_chunkStats);
+      LOGI("Chunk size %-12s %6u BLAS, build %8.3f ms, trace %8.3f ms\n", getChunkSizeName(chunkSize).c_str(),
+           m_chunkStats.blasCount, m_chunkStats.buildTime, m_chunkStats.traceTime);
+    }
+    m_chunkSize = currentChunkSize;
+    rebuildChunks();
+  }
 };
 
 //---------------------------------------------------------------------------------------------------------------
@@ -389,11 +561,13 @@ private:
 int main(int argc, char** argv)
 {
   nvapp::ApplicationCreateInfo appInfo{};
+  uint32_t                     chunkSize = 0;
 
   // Parsing the command line
   nvutils::ParameterParser   cli(nvutils::getExecutablePath().stem().string());
   nvutils::ParameterRegistry reg;
   reg.add({"headless", "Run in headless mode"}, &appInfo.headless, true);
+  reg.add({"chunkSize", "Maximum number of implicit objects in a BLAS, 0 for a single BLAS"}, &chunkSize);
   cli.add(reg);
   cli.parse(argc, argv);
 
@@ -439,6 +613,7 @@ int main(int argc, char** argv)
 
   // Elements added to the application
   auto tutorial    = std::make_shared<RtIntersection>();
+  tutorial->setChunkSize(chunkSize);
   auto elemCamera  = std::make_shared<nvapp::ElementCamera>();
   auto windowTitle = std::make_shared<nvapp::ElementDefaultWindowTitle>();
   auto windowMenu  = std::make_shared<nvapp::ElementDefaultMenu>();
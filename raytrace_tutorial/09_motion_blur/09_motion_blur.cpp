@@ -51,6 +51,7 @@
 
 // Common base class (see 02_basic)
 #include "common/rt_base.hpp"
+#include "common/blas_batch_builder.hpp"
 
 
 class RtMotionBlur : public RtBase
@@ -111,11 +112,6 @@ public:
   {
     SCOPED_TIMER(__FUNCTION__);
 
-    // Initialize acceleration structure properties for motion blur
-    VkPhysicalDeviceProperties2 prop2{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2};
-    prop2.pNext = &m_asProperties;
-    vkGetPhysicalDeviceProperties2(m_app->getPhysicalDevice(), &prop2);
-
     VkCommandBuffer cmd = m_app->createTempCmdBuffer();
 
     // Create a plane
@@ -250,29 +246,19 @@ public:
   {
     SCOPED_TIMER(__FUNCTION__);
 
-    std::vector<nvvk::AccelerationStructureBuildData> blasBuildData;
-
     // BLAS - Storing each mesh in a geometry
-    blasBuildData.resize(eMeshCount);
+    std::vector<nvsamples::BlasBatchBuilder::Input> blasInputs(eMeshCount);
     m_asBuilder.blasSet.resize(eMeshCount);
 
-    VkDeviceSize maxScratchSize{0};
-
     // Adding Plane mesh
     {
-      blasBuildData[eMeshPlane].asType = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-      blasBuildData[eMeshPlane].addGeometry(RtBase::primitiveToGeometry(m_sceneResource.meshes[eMeshPlane]));
-      auto sizeInfo  = blasBuildData[eMeshPlane].finalizeGeometry(m_app->getDevice(),
-                                                                  VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR);
-      maxScratchSize = std::max(maxScratchSize, sizeInfo.buildScratchSize);
+      const nvvk::AccelerationStructureGeometryInfo geo = RtBase::primitiveToGeometry(m_sceneResource.meshes[eMeshPlane]);
+      blasInputs[eMeshPlane] = {.geometry = geo.geometry, .rangeInfo = geo.rangeInfo};
     }
     // Adding Cube
     {
-      blasBuildData[eMeshCube].asType = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-      blasBuildData[eMeshCube].addGeometry(RtBase::primitiveToGeometry(m_sceneResource.meshes[eMeshCube]));
-      auto sizeInfo  = blasBuildData[eMeshCube].finalizeGeometry(m_app->getDevice(),
-                                                                 VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR);
-      maxScratchSize = std::max(maxScratchSize, sizeInfo.buildScratchSize);
+      const nvvk::AccelerationStructureGeometryInfo geo = RtBase::primitiveToGeometry(m_sceneResource.meshes[eMeshCube]);
+      blasInputs[eMeshCube] = {.geometry = geo.geometry, .rangeInfo = geo.rangeInfo};
     }
 
     // Motion-enabled BLAS for modified cube (vertex motion)
@@ -285,36 +271,23 @@ public:
       nvvk::AccelerationStructureGeometryInfo geo = primitiveToGeometry(m_sceneResource.meshes[eMeshModifiedCube]);  // T1 vertices (modified cube)
       geo.geometry.geometry.triangles.pNext = &motionTriangles;  // T0 vertices (original cube)
 
-      blasBuildData[eMeshModifiedCube].asType = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-      blasBuildData[eMeshModifiedCube].addGeometry(geo);
-      auto sizeInfo = blasBuildData[eMeshModifiedCube].finalizeGeometry(m_app->getDevice(), VK_BUILD_ACCELERATION_STRUCTURE_MOTION_BIT_NV);
-      maxScratchSize = std::max(maxScratchSize, sizeInfo.buildScratchSize);
+      blasInputs[eMeshModifiedCube] = {
+          .geometry  = geo.geometry,
+          .rangeInfo = geo.rangeInfo,
+          .flags     = VK_BUILD_ACCELERATION_STRUCTURE_MOTION_BIT_NV,
+      };
     }
 
-    // Create scratch buffer
-    nvvk::Buffer scratchBuffer;
-    NVVK_CHECK(m_allocator.createBuffer(scratchBuffer, maxScratchSize,
-                                        VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_SHADER_DEVICE_ADDRESS_BIT,
-                                        VMA_MEMORY_USAGE_AUTO, {}, m_asProperties.minAccelerationStructureScratchOffsetAlignment));
-    NVVK_DBG_NAME(scratchBuffer.buffer);
+    // Create the acceleration structures, all built by a single vkCmdBuildAccelerationStructuresKHR on their own
+    // scratch regions, instead of one after the other on a shared scratch buffer
+    nvsamples::BlasBatchBuilder blasBuilder;
+    blasBuilder.init(&m_allocator, m_asProperties.minAccelerationStructureScratchOffsetAlignment);
 
-    // Create the acceleration structures
     VkCommandBuffer cmd = m_app->createTempCmdBuffer();
-    {
-      for(size_t p_idx = 0; p_idx < blasBuildData.size(); p_idx++)
-      {
-        NVVK_CHECK(m_allocator.createAcceleration(m_asBuilder.blasSet[p_idx], blasBuildData[p_idx].makeCreateInfo()));
-        NVVK_DBG_NAME(m_asBuilder.blasSet[p_idx].accel);
-        blasBuildData[p_idx].cmdBuildAccelerationStructure(cmd, m_asBuilder.blasSet[p_idx].accel, scratchBuffer.address);
-
-        // Add barrier between BLAS builds to prevent WRITE_AFTER_WRITE hazard on scratch buffer
-        nvvk::accelerationStructureBarrier(cmd, VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
-                                           VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR);
-      }
-    }
+    blasBuilder.cmdCreateAndBuild(cmd, blasInputs, m_asBuilder.blasSet);
     m_app->submitAndWaitTempCmdBuffer(cmd);
 
-    m_allocator.destroyBuffer(scratchBuffer);
+    blasBuilder.deinit();
   }
 
   void createTopLevelAS() override
@@ -423,18 +396,16 @@ public:
     }
 
     // Build TLAS with motion blur support
-    VkCommandBuffer       cmd = m_app->createTempCmdBuffer();
-    nvvk::StagingUploader uploader;
-    uploader.init(&m_allocator);
+    VkCommandBuffer cmd = m_app->createTempCmdBuffer();
 
     // Create the instances buffer
     nvvk::Buffer instancesBuffer;
     NVVK_CHECK(m_allocator.createBuffer(instancesBuffer, std::span(motionInstances).size_bytes(),
                                         VK_BUFFER_USAGE_2_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR
                                             | VK_BUFFER_USAGE_2_SHADER_DEVICE_ADDRESS_BIT));
-    NVVK_CHECK(uploader.appendBuffer(instancesBuffer, 0, std::span(motionInstances)));
+    NVVK_CHECK(m_stagingUploader.appendBuffer(instancesBuffer, 0, std::span(motionInstances)));
     NVVK_DBG_NAME(instancesBuffer.buffer);
-    uploader.cmdUploadAppended(cmd);
+    m_stagingUploader.cmdUploadAppended(cmd);
     nvvk::accelerationStructureBarrier(cmd, VK_ACCESS_TRANSFER_WRITE_BIT,
                                        VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR | VK_ACCESS_2_SHADER_READ_BIT);
 
@@ -468,7 +439,7 @@ public:
 
 
     m_app->submitAndWaitTempCmdBuffer(cmd);
-    uploader.deinit();
+    m_stagingUploader.releaseStaging();
 
     m_allocator.destroyBuffer(scratchBuffer);
     m_allocator.destroyBuffer(instancesBuffer);
@@ -500,7 +471,7 @@ public:
     vkCmdPushDescriptorSetKHR(cmd, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_rtPipelineLayout, 1, write.size(), write.data());
 
     // Push constant information
-    m_pushValues.sceneInfoAddress          = (shaderio::GltfSceneInfo*)m_sceneResource.bSceneInfo.address;
+    m_pushValues.sceneInfoAddress          = getSceneInfoAddress();
     m_pushValues.metallicRoughnessOverride = m_metallicRoughnessOverride;
     m_pushValues.numSamples                = m_numSamples;
 
@@ -518,8 +489,6 @@ public:
   }
 
 private:
-  VkPhysicalDeviceAccelerationStructurePropertiesKHR m_asProperties{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR};
-
   // Motion blur settings
   int m_numSamples = 10;  // Number of samples for motion blur accumulation
 };
@@ -72,23 +72,16 @@ public:
       ImGui::Text("Object Materials:");
       if(PE::begin())
       {
-        bool materialsChanged = false;
         for(int i = 0; i < m_sceneResource.instances.size(); i++)
         {
           std::string label = "Object " + std::to_string(i);
           if(PE::Combo(label.c_str(), &m_objectMaterials[i], "Diffuse\0Plastic\0Glass\0Constant\0"))
           {
-            materialsChanged = true;
+            // Only this instance is uploaded, and the TLAS updated, at the next frame
+            m_tlasInstances.edit(i).instanceCustomIndex = m_objectMaterials[i];
           }
         }
         PE::end();
-
-        // Update TLAS when materials change
-        if(materialsChanged)
-        {
-          vkDeviceWaitIdle(m_app->getDevice());
-          createTopLevelAS();
-        }
       }
 
       ImGui::Separator();
@@ -310,37 +303,21 @@ public:
   {
     SCOPED_TIMER(__FUNCTION__);
 
-    std::vector<VkAccelerationStructureInstanceKHR> tlasInstances;
-    tlasInstances.reserve(m_sceneResource.instances.size());
-    const VkGeometryInstanceFlagsKHR flags{VK_GEOMETRY_INSTANCE_TRIANGLE_CULL_DISABLE_BIT_NV};
-
-    for(size_t i = 0; i < m_sceneResource.instances.size(); i++)
+    std::vector<VkAccelerationStructureInstanceKHR> tlasInstances(m_sceneResource.instances.size());
+    nvsamples::convertInstances(m_sceneResource.instances, {.blasSet = m_asBuilder.blasSet}, tlasInstances);
+    for(size_t i = 0; i < tlasInstances.size(); i++)
     {
-      const shaderio::GltfInstance&      instance = m_sceneResource.instances[i];
-      VkAccelerationStructureInstanceKHR ray_inst{};
-      ray_inst.transform                      = nvvk::toTransformMatrixKHR(instance.transform);
-      ray_inst.instanceCustomIndex            = m_objectMaterials[i];  // Use material type instead of mesh index
-      ray_inst.accelerationStructureReference = m_asBuilder.blasSet[instance.meshIndex].address;
-      ray_inst.instanceShaderBindingTableRecordOffset = 0;
-      ray_inst.flags                                  = flags;
-      ray_inst.mask                                   = 0xFF;
-      tlasInstances.emplace_back(ray_inst);
+      tlasInstances[i].instanceCustomIndex = m_objectMaterials[i];  // Use material type instead of mesh index
     }
 
     // Use appropriate build flags: allow updates and prefer fast trace
     VkBuildAccelerationStructureFlagsKHR buildFlags =
         VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
 
-    if(m_asBuilder.tlas.accel == VK_NULL_HANDLE)
-    {
-      // If TLAS is not created yet, create it
-      m_asBuilder.tlasSubmitBuildAndWait(tlasInstances, buildFlags);
-    }
-    else
-    {
-      // If TLAS already exists, update it
-      m_asBuilder.tlasSubmitUpdateAndWait(tlasInstances);
-    }
+    m_asBuilder.tlasSubmitBuildAndWait(tlasInstances, buildFlags);
+
+    // The material changes update the instances in place, see onUIRender
+    m_tlasInstances.assign(tlasInstances, buildFlags);
   }
 
   // Override the ray trace scene method to include our custom push constants
@@ -369,7 +346,7 @@ public:
     vkCmdPushDescriptorSetKHR(cmd, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_rtPipelineLayout, 1, write.size(), write.data());
 
     // Push constant information with our custom data
-    m_pushValues.sceneInfoAddress          = (shaderio::GltfSceneInfo*)m_sceneResource.bSceneInfo.address;
+    m_pushValues.sceneInfoAddress          = getSceneInfoAddress();
     m_pushValues.metallicRoughnessOverride = m_metallicRoughnessOverride;
     m_pushValues.time                      = m_time;
     m_pushValues.textureType               = m_textureType;
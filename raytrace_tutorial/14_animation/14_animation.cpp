@@ -48,6 +48,7 @@
 
 // Common base class (see 02_basic)
 #include "common/rt_base.hpp"
+#include "common/refit_policy.hpp"
 
 
 class Rt14Animation : public RtBase
@@ -73,8 +74,10 @@ public:
   {
     vkDestroyPipeline(m_app->getDevice(), m_pipeline, nullptr);
     vkDestroyPipelineLayout(m_app->getDevice(), m_pipelineLayout, nullptr);
+    vkDestroyQueryPool(m_app->getDevice(), m_traceQueries, nullptr);
     m_pipeline       = VK_NULL_HANDLE;
     m_pipelineLayout = VK_NULL_HANDLE;
+    m_traceQueries   = VK_NULL_HANDLE;
   }
 
   void onUIRender() override
@@ -88,6 +91,11 @@ public:
       ImGui::Checkbox("Enable Instance Animation", &m_enableInstanceAnimation);
       ImGui::Checkbox("Enable Geometry Animation", &m_enableGeometryAnimation);
       ImGui::SliderFloat("Animation Speed", &m_animationSpeed, 0.1f, 2.0f);
+      ImGui::Checkbox("Rebuild Degraded Acceleration Structures", &m_useRefitPolicy);
+      ImGui::Text("TLAS: %u updates, motion %.2f, %u rebuilds", m_tlasPolicy.getUpdateCount(), m_tlasPolicy.getMotion(),
+                  m_tlasPolicy.getRebuildCount());
+      ImGui::Text("BLAS: %u updates, trace cost x%.2f, %u rebuilds", m_blasPolicy.getUpdateCount(),
+                  m_blasPolicy.getTraceGrowth(), m_blasPolicy.getRebuildCount());
     }
     ImGui::End();
   }
@@ -286,6 +294,9 @@ public:
     float       deltaTime   = std::chrono::duration<float>(currentTime - startTime).count();
     m_animationTime         = deltaTime * m_animationSpeed;
 
+    // Per-frame uploads go through the frame ring, starting here as the animations are recorded before RtBase::onRender
+    m_frameRing.beginFrame(m_app->getFrameCycleIndex());
+
     // Perform animations
     if(m_enableInstanceAnimation)
     {
@@ -299,7 +310,68 @@ public:
     RtBase::onRender(cmd);
   }
 
+  // Ray tracing, timed for the refit policy of the animated sphere
+  void raytraceScene(VkCommandBuffer cmd) override
+  {
+    const uint32_t frame = m_app->getFrameCycleIndex();
+    if(m_traceQueries == VK_NULL_HANDLE)
+    {
+      const VkQueryPoolCreateInfo queryPoolInfo{
+          .sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+          .queryType  = VK_QUERY_TYPE_TIMESTAMP,
+          .queryCount = 2 * m_app->getFrameCycleSize(),
+      };
+      NVVK_CHECK(vkCreateQueryPool(m_app->getDevice(), &queryPoolInfo, nullptr, &m_traceQueries));
+      NVVK_DBG_NAME(m_traceQueries);
+      m_traceQueriesWritten.assign(m_app->getFrameCycleSize(), false);
+
+      VkPhysicalDeviceProperties properties{};
+      vkGetPhysicalDeviceProperties(m_app->getPhysicalDevice(), &properties);
+      m_timestampPeriod = properties.limits.timestampPeriod;
+    }
+
+    // The trace time depends on the view as much as on the BLAS: a new camera or resolution gets a new reference
+    const glm::mat4& viewMatrix = m_cameraManip->getViewMatrix();
+    const float      fov        = m_cameraManip->getFov();
+    if(viewMatrix != m_traceViewMatrix || fov != m_traceFov)
+    {
+      m_traceViewMatrix = viewMatrix;
+      m_traceFov        = fov;
+      resetTraceBaseline();
+    }
+
+    // The queries of this frame were written a frame cycle ago, their submission is complete
+    uint64_t ticks[2]{};
+    if(m_traceQueriesWritten[frame]
+       && vkGetQueryPoolResults(m_app->getDevice(), m_traceQueries, 2 * frame, 2, sizeof(ticks), ticks,
+                                sizeof(uint64_t), VK_QUERY_RESULT_64_BIT)
+              == VK_SUCCESS)
+    {
+      m_blasPolicy.addTraceTime(double(ticks[1] - ticks[0]) * m_timestampPeriod * 1e-6);
+    }
+
+    vkCmdResetQueryPool(cmd, m_traceQueries, 2 * frame, 2);
+    vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, m_traceQueries, 2 * frame);
+    RtBase::raytraceScene(cmd);
+    vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, m_traceQueries, 2 * frame + 1);
+    m_traceQueriesWritten[frame] = true;
+  }
+
+  // The trace time of the previous resolution is no reference for the sphere BLAS policy
+  void onResize(VkCommandBuffer cmd, const VkExtent2D& size) override
+  {
+    resetTraceBaseline();
+    RtBase::onResize(cmd, size);
+  }
+
 private:
+  // New reference trace cost for the sphere BLAS, the timestamps of the frames in flight being of the previous view
+  void resetTraceBaseline()
+  {
+    m_blasPolicy.resetTraceBaseline();
+    m_traceQueriesWritten.assign(m_traceQueriesWritten.size(), false);
+  }
+
   // Animation methods
   void animateInstances(VkCommandBuffer cmd)
   {
@@ -315,35 +387,23 @@ private:
       auto& transform = m_sceneResource.instances[wusonIdx].transform;
       transform       = glm::rotate(glm::mat4(1), i * deltaAngle + offset, glm::vec3(0.f, 1.f, 0.f))
                   * glm::translate(glm::mat4(1), glm::vec3(radius, 0.f, 0.f));
-
-      m_tlasInstances[i].transform = nvvk::toTransformMatrixKHR(transform);  // Update the TLAS instance transform
     }
 
+    // Update the TLAS instance transforms, converted in one batch
+    m_tlasInstances.setTransforms(0, std::span(m_sceneResource.instances).first(size_t(nbWuson)));
 
-    // Update the instance buffer
-    m_stagingUploader.appendBuffer(m_asBuilder.tlasInstancesBuffer, 0, std::span(m_tlasInstances));
-    m_stagingUploader.cmdUploadAppended(cmd);
-
-    // Make sure the copy of the instance buffer are copied before triggering the acceleration structure build
-    nvvk::accelerationStructureBarrier(cmd, VK_ACCESS_TRANSFER_WRITE_BIT,
-                                       VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR | VK_ACCESS_2_SHADER_READ_BIT);
+    // The moving instances drift away from the positions the TLAS was built with
+    const std::span<const glm::vec3> positions = getInstancePositions();
+    m_tlasPolicy.onUpdate(positions);
+    const bool rebuild = m_useRefitPolicy && m_tlasPolicy.shouldRebuild();
 
-    if(m_asBuilder.tlasScratchBuffer.buffer == VK_NULL_HANDLE)
+    // Uploading the moved instances and updating or rebuilding the top-level acceleration structure
+    if(rebuild)
     {
-      NVVK_CHECK(m_allocator.createBuffer(m_asBuilder.tlasScratchBuffer, m_asBuilder.tlasBuildData.sizeInfo.buildScratchSize,
-                                          VK_BUFFER_USAGE_2_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT));
-      NVVK_DBG_NAME(m_asBuilder.tlasScratchBuffer.buffer);
+      LOGI("TLAS rebuilt after %u updates (%s)\n", m_tlasPolicy.getUpdateCount(), m_tlasPolicy.getReason());
+      m_tlasPolicy.onRebuild(positions);
     }
-
-    // Building or updating the top-level acceleration structure
-    m_asBuilder.tlasBuildData.cmdUpdateAccelerationStructure(cmd, m_asBuilder.tlas.accel, m_asBuilder.tlasScratchBuffer.address);
-
-    // Barrier to make the acceleration structure available to the ray tracing pipeline
-    VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
-    barrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
-    barrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR;
-    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
-                         VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    cmdUpdateTopLevelAS(cmd, rebuild);
   }
 
   void animateGeometry(VkCommandBuffer cmd)
@@ -366,9 +426,20 @@ private:
     // Barrier to make the geometry available to the ray tracing pipeline
     nvvk::accelerationStructureBarrier(cmd, VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR);
 
-    // The Bottom level acceleration needs to be updated
-    m_asBuilder.blasBuildData[eSphere].cmdUpdateAccelerationStructure(cmd, m_asBuilder.blasSet[eSphere].accel,
-                                                                      m_asBuilder.blasScratchBuffer.address);
+    // The Bottom level acceleration needs to be updated, or rebuilt when the refits made it too slow to trace
+    m_blasPolicy.onUpdate();
+    if(m_useRefitPolicy && m_blasPolicy.shouldRebuild())
+    {
+      LOGI("Sphere BLAS rebuilt after %u updates (%s)\n", m_blasPolicy.getUpdateCount(), m_blasPolicy.getReason());
+      m_asBuilder.blasBuildData[eSphere].cmdBuildAccelerationStructure(cmd, m_asBuilder.blasSet[eSphere].accel,
+                                                                       m_asBuilder.blasScratchBuffer.address);
+      m_blasPolicy.onRebuild();
+    }
+    else
+    {
+      m_asBuilder.blasBuildData[eSphere].cmdUpdateAccelerationStructure(cmd, m_asBuilder.blasSet[eSphere].accel,
+                                                                        m_asBuilder.blasScratchBuffer.address);
+    }
 
     VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
     barrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
@@ -386,29 +457,49 @@ private:
     }
     m_asBuilder.blasSubmitBuildAndWait(geoInfos, VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR |  // <<--- For animation
                                                      VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR);
+
+    // The deformation happens on the GPU: only the trace cost tells how much the refits degrade the sphere,
+    // with a rebuild every few thousand updates in any case
+    m_blasPolicy.init({.maxMotion = 0.0f, .maxBoundsGrowth = 0.0f, .maxTraceGrowth = 1.2f, .maxUpdates = 4096});
+    m_blasPolicy.onRebuild();
   }
 
   void createTopLevelAS() override
   {
-    m_tlasInstances.reserve(m_sceneResource.instances.size());
-    const VkGeometryInstanceFlagsKHR flags{VK_GEOMETRY_INSTANCE_TRIANGLE_CULL_DISABLE_BIT_NV};  // Makes the instance visible to all rays (double sided)
-    for(const shaderio::GltfInstance& instance : m_sceneResource.instances)
+    std::vector<VkAccelerationStructureInstanceKHR> tlasInstances(m_sceneResource.instances.size());
+    nvsamples::convertInstances(m_sceneResource.instances, {.blasSet = m_asBuilder.blasSet}, tlasInstances);
+    const VkBuildAccelerationStructureFlagsKHR buildFlags = VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR |  // <<--- For animation
+                                                            VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+    m_asBuilder.tlasSubmitBuildAndWait(tlasInstances, buildFlags);
+    m_tlasInstances.assign(tlasInstances, buildFlags);  // Only the moved instances are uploaded, see cmdUpdateTopLevelAS
+
+    // The instances move on the host: their displacement and spread tell how much the refits degrade the TLAS
+    m_tlasPolicy.init({.maxMotion = 0.25f, .maxBoundsGrowth = 1.5f, .maxTraceGrowth = 0.0f});
+    m_tlasPolicy.onRebuild(getInstancePositions());
+  }
+
+  // Positions of the instances, valid until the next call
+  std::span<const glm::vec3> getInstancePositions()
+  {
+    m_instancePositions.resize(m_sceneResource.instances.size());
+    for(size_t i = 0; i < m_instancePositions.size(); i++)
     {
-      VkAccelerationStructureInstanceKHR ray_inst{};
-      ray_inst.transform                              = nvvk::toTransformMatrixKHR(instance.transform);
-      ray_inst.instanceCustomIndex                    = instance.meshIndex;
-      ray_inst.accelerationStructureReference         = m_asBuilder.blasSet[instance.meshIndex].address;
-      ray_inst.instanceShaderBindingTableRecordOffset = 0;
-      ray_inst.flags                                  = flags;
-      ray_inst.mask                                   = 0xFF;
-      m_tlasInstances.emplace_back(ray_inst);
+      m_instancePositions[i] = glm::vec3(m_sceneResource.instances[i].transform[3]);
     }
-    m_asBuilder.tlasSubmitBuildAndWait(m_tlasInstances, VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR |  // <<--- For animation
-                                                            VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR);
+    return m_instancePositions;
   }
 
 private:
-  std::vector<VkAccelerationStructureInstanceKHR> m_tlasInstances;
+  // Refit or rebuild of the animated acceleration structures, see RefitPolicy
+  nvsamples::RefitPolicy m_tlasPolicy;
+  nvsamples::RefitPolicy m_blasPolicy;
+  std::vector<glm::vec3> m_instancePositions;  // Refilled by getInstancePositions, no allocation per frame
+  bool                   m_useRefitPolicy = true;
+  VkQueryPool            m_traceQueries{};  // Timestamps around the ray tracing of each frame in flight
+  std::vector<bool>      m_traceQueriesWritten;
+  float                  m_timestampPeriod = 1.0f;
+  glm::mat4              m_traceViewMatrix{};  // View of the traced frames, a change resets the trace cost reference
+  float                  m_traceFov = 0.0f;
 
   // Animation state
   float m_animationTime           = 0.0f;
@@ -231,20 +231,8 @@ public:
         | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_OPACITY_MICROMAP_UPDATE_EXT;
 
 
-    std::vector<VkAccelerationStructureInstanceKHR> tlasInstances;
-    tlasInstances.reserve(m_sceneResource.instances.size());
-    const VkGeometryInstanceFlagsKHR flags{VK_GEOMETRY_INSTANCE_TRIANGLE_CULL_DISABLE_BIT_NV};  // Makes the instance visible to all rays (double sided)
-    for(const shaderio::GltfInstance& instance : m_sceneResource.instances)
-    {
-      VkAccelerationStructureInstanceKHR ray_inst{};
-      ray_inst.transform                              = nvvk::toTransformMatrixKHR(instance.transform);
-      ray_inst.instanceCustomIndex                    = instance.meshIndex;
-      ray_inst.accelerationStructureReference         = m_asBuilder.blasSet[instance.meshIndex].address;
-      ray_inst.instanceShaderBindingTableRecordOffset = 0;
-      ray_inst.flags                                  = flags;
-      ray_inst.mask                                   = 0xFF;
-      tlasInstances.emplace_back(ray_inst);
-    }
+    std::vector<VkAccelerationStructureInstanceKHR> tlasInstances(m_sceneResource.instances.size());
+    nvsamples::convertInstances(m_sceneResource.instances, {.blasSet = m_asBuilder.blasSet}, tlasInstances);
     m_asBuilder.tlasSubmitBuildAndWait(tlasInstances, buildFlags);
   }
 
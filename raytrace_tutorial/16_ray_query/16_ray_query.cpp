@@ -52,6 +52,7 @@
 
 // Common base class (see 02_basic)
 #include "common/rt_base.hpp"
+#include "common/gltf_cache.hpp"
 
 
 //---------------------------------------------------------------------------------------
@@ -126,11 +127,36 @@ public:
 
     // Load the GLTF resources
     {
-      tinygltf::Model meetMat =
-          nvsamples::loadGltfResources(nvutils::findFile("meet_mat.glb", nvsamples::getResourcesDirs()));  // Load the GLTF resources from the file
-
-      const bool importAllInstances = true;
-      nvsamples::importGltfData(m_sceneResource, meetMat, m_stagingUploader, importAllInstances);  // Import the GLTF resources
+      // By default the .glb is parsed and imported as is. The command line options (see main) enable:
+      // - sceneCache: the import goes through the preprocessed cache, only the first run parses the .glb (memory
+      //   mapped), the following runs read the packed geometry and the instances directly from the cache file
+      // - quantizeVertices, optimizeMeshes and deduplicateMeshes: see GltfImportOptions and vertex_attributes.h.slang
+      // - asyncUpload: the geometry is streamed on the transfer queue while the rest of the scene is uploaded
+      const bool                  importAllInstances = true;
+      const std::filesystem::path scenePath          = nvutils::findFile("meet_mat.glb", nvsamples::getResourcesDirs());
+      nvsamples::AsyncUploader*   asyncUploader      = m_asyncUpload ? &m_asyncUploader : nullptr;
+      bool                        imported           = false;
+      if(m_sceneCache)
+      {
+        imported = nvsamples::importGltfCached(m_sceneResource, scenePath, nvsamples::getCacheDir(), m_stagingUploader,
+                                               importAllInstances, m_importOptions, asyncUploader);
+      }
+      else
+      {
+        const tinygltf::Model                 meetMat = nvsamples::loadGltfResources(scenePath);
+        std::vector<std::span<const uint8_t>> buffersData;
+        for(const tinygltf::Buffer& buffer : meetMat.buffers)
+        {
+          buffersData.emplace_back(buffer.data);
+        }
+        imported = nvsamples::importGltfData(m_sceneResource, meetMat, buffersData, &m_stagingUploader,
+                                             importAllInstances, m_importOptions, nullptr, asyncUploader);
+      }
+      if(!imported)
+      {
+        LOGE("Error loading %s\n", scenePath.string().c_str());
+        exit(1);
+      }
     }
 
     m_sceneResource.materials = {
@@ -232,7 +258,7 @@ public:
     vkCmdPushDescriptorSetKHR(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_rtPipelineLayout, 1, write.size(), write.data());
 
     // Push constant information, see usage later
-    m_pushValues.sceneInfoAddress = (shaderio::GltfSceneInfo*)m_sceneResource.bSceneInfo.address;  // Pass the address of the scene information buffer to the shader
+    m_pushValues.sceneInfoAddress = getSceneInfoAddress();  // Pass the address of the scene information of this frame to the shader
     m_pushValues.metallicRoughnessOverride = m_metallicRoughnessOverride;  // Override the metallic and roughness values
 
     const VkPushConstantsInfo pushInfo{.sType      = VK_STRUCTURE_TYPE_PUSH_CONSTANTS_INFO,
@@ -289,8 +315,19 @@ public:
     RtBase::onResize(cmd, size);
   }
 
+  // How the glTF scene is imported, must be set before onAttach
+  void setSceneImport(const nvsamples::GltfImportOptions& options, bool sceneCache, bool asyncUpload)
+  {
+    m_importOptions = options;
+    m_sceneCache    = sceneCache;
+    m_asyncUpload   = asyncUpload;
+  }
+
 private:
-  uint32_t m_maxFrames = 200;  // Maximum number of frames for accumulation
+  uint32_t                     m_maxFrames = 200;  // Maximum number of frames for accumulation
+  nvsamples::GltfImportOptions m_importOptions{};
+  bool                         m_sceneCache  = false;  // Import through the preprocessed scene cache
+  bool                         m_asyncUpload = false;  // Stream the geometry on the transfer queue
 };
 
 
@@ -299,11 +336,29 @@ private:
 int main(int argc, char** argv)
 {
   nvapp::ApplicationCreateInfo appInfo{};
+  bool                         progressiveBlas = false;
+  bool                         compactBlas     = false;
+  bool                         blasCache       = false;
+  bool                         tuneBlas        = false;
+  bool                         blasProfile     = false;
+  bool                         sceneCache      = false;
+  bool                         asyncUpload     = false;
+  nvsamples::GltfImportOptions importOptions{};
 
   // Parsing the command line
   nvutils::ParameterParser   cli(nvutils::getExecutablePath().stem().string());
   nvutils::ParameterRegistry reg;
   reg.add({"headless", "Run in headless mode"}, &appInfo.headless, true);
+  reg.add({"progressiveBlas", "Build the acceleration structures over the first frames"}, &progressiveBlas, true);
+  reg.add({"compactBlas", "Compact the acceleration structures after their build (not with progressiveBlas)"}, &compactBlas, true);
+  reg.add({"blasCache", "Load the acceleration structures from the on-disk cache"}, &blasCache, true);
+  reg.add({"tuneBlas", "Measure the build flags of each acceleration structure and save the profile of the scene"}, &tuneBlas, true);
+  reg.add({"blasProfile", "Build the acceleration structures with the flags of the saved profile"}, &blasProfile, true);
+  reg.add({"sceneCache", "Import the scene through the preprocessed cache"}, &sceneCache, true);
+  reg.add({"quantizeVertices", "Quantize the vertex attributes of the scene"}, &importOptions.quantizeVertices, true);
+  reg.add({"optimizeMeshes", "Optimize the index and vertex order of the meshes"}, &importOptions.optimizeMeshes, true);
+  reg.add({"deduplicateMeshes", "Share the geometry and the BLAS of the identical meshes"}, &importOptions.deduplicateMeshes, true);
+  reg.add({"asyncUpload", "Stream the geometry of the scene on the transfer queue"}, &asyncUpload, true);
   cli.add(reg);
   cli.parse(argc, argv);
 
@@ -353,6 +408,13 @@ int main(int argc, char** argv)
 
   // Elements added to the application
   auto tutorial   = std::make_shared<Rt16RayQuery>();          // Our tutorial element
+  tutorial->setProgressiveBlas(progressiveBlas);
+  tutorial->setCompactBlas(compactBlas);
+  tutorial->setBlasCache(blasCache);
+  tutorial->setSceneImport(importOptions, sceneCache, asyncUpload);
+  tutorial->setBlasTuning(tuneBlas    ? RtBase::BlasTuning::eTune :
+                          blasProfile ? RtBase::BlasTuning::eLoadProfile :
+                                        RtBase::BlasTuning::eOff);
   auto elemCamera = std::make_shared<nvapp::ElementCamera>();  // Element to control the camera movement
   auto windowTitle = std::make_shared<nvapp::ElementDefaultWindowTitle>();  // Element displaying the window title with application name and size
   auto windowMenu = std::make_shared<nvapp::ElementDefaultMenu>();  // Element displaying a menu, File->Exit ...
@@ -279,7 +279,7 @@ public:
 
     // Push constant information for the rasterization shaders
     shaderio::TutoPushConstant pushValues{
-        .sceneInfoAddress = (shaderio::GltfSceneInfo*)m_sceneResource.bSceneInfo.address,  // Scene data buffer address
+        .sceneInfoAddress          = getSceneInfoAddress(),       // Scene information of this frame
         .metallicRoughnessOverride = m_metallicRoughnessOverride,  // Material property overrides
     };
     const VkPushConstantsInfo pushInfo{
@@ -375,11 +375,11 @@ public:
       vkCmdPushConstants2(cmd, &pushInfo);
 
       // Get the buffer using the pre-computed mesh-to-buffer mapping
-      uint32_t            bufferIndex = m_sceneResource.meshToBufferIndex[meshIndex];
-      const nvvk::Buffer& v           = m_sceneResource.bGltfDatas[bufferIndex];
+      const nvvk::Buffer& v = m_sceneResource.getMeshBuffer(meshIndex);
 
       // Bind the index buffer for this mesh
-      vkCmdBindIndexBuffer(cmd, v.buffer, triMesh.indices.offset, VkIndexType(gltfMesh.indexType));
+      vkCmdBindIndexBuffer(cmd, v.buffer, m_sceneResource.getMeshBufferOffset(meshIndex) + triMesh.indices.offset,
+                           VkIndexType(gltfMesh.indexType));
 
       // Draw all triangles in this mesh
       vkCmdDrawIndexed(cmd, triMesh.indices.count, 1, 0, 0, 0);
@@ -448,6 +448,9 @@ public:
   {
     NVVK_DBG_SCOPE(cmd);  // <-- Helps to debug in NSight
 
+    // The scene information of the frame is written to the frame ring
+    m_frameRing.beginFrame(m_app->getFrameCycleIndex());
+
     // Update the scene information buffer (must be done before dynamic rendering)
     updateSceneBuffer(cmd);
 
@@ -459,6 +462,8 @@ public:
 
     // Step 3: Apply post-processing (tonemapping, etc.)
     postProcess(cmd);
+
+    m_frameRing.endFrame();
   }
 
   //---------------------------------------------------------------------------------------------------------------
@@ -507,7 +512,7 @@ public:
     vkCmdPushDescriptorSetKHR(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_rtPipelineLayout, 1, write.size(), write.data());
 
     // Update push constant data for the compute shader
-    m_pushValues.sceneInfoAddress = (shaderio::GltfSceneInfo*)m_sceneResource.bSceneInfo.address;  // Scene data buffer address
+    m_pushValues.sceneInfoAddress = getSceneInfoAddress();  // Scene information of this frame
 
     if(m_enableRandom)
       m_pushValues.frame++;  // Increment frame counter for random number generation
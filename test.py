@@ -12,6 +12,7 @@ EXECUTABLES = [
     ("03_any_hit", ["--headless"]),
     ("04_jitter_camera", ["--headless"]),
     ("05_shadow_miss", ["--headless"]),
+    ("05_shadow_miss", ["--headless", "--cpuRaytracing"]),
     ("06_reflection", ["--headless"]),
     ("07_multi_closest_hit", ["--headless"]),
     ("08_intersection", ["--headless"]),
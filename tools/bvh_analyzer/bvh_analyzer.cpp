@@ -0,0 +1,419 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// BVH Analyzer
+//
+// Builds the SAH BVH of each mesh and of the instances of a glTF scene on the CPU (see SahBvh), and reports the
+// quality of the hierarchies: SAH cost, overlap of the nodes, leaf sizes and bounds of the meshes.
+// It points at what makes a scene expensive to trace whatever the driver builds: meshes made of long thin triangles,
+// whose boxes are mostly empty, and large instances overlapping each other, which rays must all enter.
+//
+// No Vulkan device is created: the scene is imported on the host only.
+//
+// Usage: bvh_analyzer --scene <file.gltf|file.glb> [--leafSize 4] [--bins 16] [--top 10] [--optimize]
+//
+
+
+#define TINYGLTF_IMPLEMENTATION         // Implementation of the GLTF loader library
+#define STB_IMAGE_IMPLEMENTATION        // Implementation of the image loading library
+#define STB_IMAGE_WRITE_IMPLEMENTATION  // Implementation of the image writing library
+#define VMA_DYNAMIC_VULKAN_FUNCTIONS 1  // Use dynamic Vulkan functions for VMA (Vulkan Memory Allocator)
+#define VMA_IMPLEMENTATION              // Implementation of the Vulkan Memory Allocator
+
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <numeric>
+#include <string>
+
+#include <glm/glm.hpp>
+
+#include <nvutils/file_operations.hpp>    // Finding the scene
+#include <nvutils/logger.hpp>             // Logger for the report
+#include <nvutils/parameter_parser.hpp>   // Parameter parser
+
+#include "common/gltf_utils.hpp"  // Host-only import of the scene
+#include "common/path_utils.hpp"  // Path utilities for resources
+#include "common/sah_bvh.hpp"     // CPU BVH builder
+
+
+namespace {
+
+// A triangle whose bounding box has this many times its area is long, thin and not aligned with the axes:
+// its box is mostly empty, and the rays going through it are tested for nothing
+constexpr float kThinTriangleRatio = 64.0f;
+// Meshes with more thin triangles than this fraction are flagged
+constexpr float kThinMeshFraction = 0.1f;
+// Instances whose overlap with the others costs more than this many BLAS entries per ray are flagged
+constexpr double kOverlapInstanceCost = 0.5;
+
+struct MeshReport
+{
+  uint32_t                 meshIndex           = 0;
+  uint32_t                 triangleCount       = 0;
+  uint32_t                 thinTriangles       = 0;
+  uint32_t                 degenerateTriangles = 0;
+  uint32_t                 instanceCount       = 0;  // Instances of the geometry, including the aliased meshes
+  nvsamples::BvhBounds     bounds;
+  nvsamples::SahBvh::Stats stats;
+  double                   buildTime = 0;  // Milliseconds
+};
+
+struct InstanceReport
+{
+  uint32_t instanceIndex = 0;
+  uint32_t overlapCount  = 0;  // Other instances whose bounds intersect this one
+  double   overlapCost   = 0;  // Intersection areas with the other instances over the scene area
+  double   areaRatio     = 0;  // Area of the instance bounds over the scene area
+};
+
+// Reads the vertices and triangles of a mesh imported on the host
+class MeshReader
+{
+public:
+  MeshReader(const shaderio::GltfMesh& mesh, const nvsamples::GltfPackedGeometry& geometry)
+      : m_mesh(mesh)
+      , m_positions(geometry.getData(mesh.triMesh.positions.offset))
+      , m_indices(geometry.getData(mesh.triMesh.indices.offset))
+  {
+    assert(mesh.triMesh.positions.format == shaderio::eVertexFormatFloat32);
+    m_positionStride = mesh.triMesh.positions.byteStride ? mesh.triMesh.positions.byteStride : uint32_t(sizeof(glm::vec3));
+    m_indexSize      = mesh.indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4;
+    m_indexStride    = mesh.triMesh.indices.byteStride ? mesh.triMesh.indices.byteStride : m_indexSize;
+  }
+
+  uint32_t getTriangleCount() const { return m_mesh.triMesh.indices.count / 3; }
+
+  glm::vec3 getPosition(uint32_t vertex) const
+  {
+    glm::vec3 p;
+    std::memcpy(&p, m_positions + size_t(vertex) * m_positionStride, sizeof(p));
+    return p;
+  }
+
+  uint32_t getIndex(uint32_t i) const
+  {
+    const uint8_t* data = m_indices + size_t(i) * m_indexStride;
+    if(m_indexSize == 2)
+    {
+      uint16_t index;
+      std::memcpy(&index, data, sizeof(index));
+      return index;
+    }
+    uint32_t index;
+    std::memcpy(&index, data, sizeof(index));
+    return index;
+  }
+
+private:
+  const shaderio::GltfMesh& m_mesh;
+  const uint8_t*            m_positions;
+  const uint8_t*            m_indices;
+  uint32_t                  m_positionStride = 0;
+  uint32_t                  m_indexSize      = 0;
+  uint32_t                  m_indexStride    = 0;
+};
+
+// Bounds and shape of the triangles of the mesh, and quality of its BVH
+MeshReport analyzeMesh(const nvsamples::GltfSceneResource&  scene,
+                       const nvsamples::GltfPackedGeometry& geometry,
+                       uint32_t                             meshIndex,
+                       const nvsamples::SahBvh::Settings&   settings)
+{
+  const MeshReader reader(scene.meshes[meshIndex], geometry);
+
+  MeshReport report;
+  report.meshIndex     = meshIndex;
+  report.triangleCount = reader.getTriangleCount();
+
+  std::vector<nvsamples::BvhBounds> triangleBounds(report.triangleCount);
+  for(uint32_t t = 0; t < report.triangleCount; t++)
+  {
+    const glm::vec3 v0 = reader.getPosition(reader.getIndex(3 * t + 0));
+    const glm::vec3 v1 = reader.getPosition(reader.getIndex(3 * t + 1));
+    const glm::vec3 v2 = reader.getPosition(reader.getIndex(3 * t + 2));
+
+    nvsamples::BvhBounds& bounds = triangleBounds[t];
+    bounds.grow(v0);
+    bounds.grow(v1);
+    bounds.grow(v2);
+    report.bounds.grow(bounds);
+
+    // The surface area of the box of an axis-aligned right triangle is 4 times its area
+    const float area = 0.5f * glm::length(glm::cross(v1 - v0, v2 - v0));
+    if(area <= 0.0f)
+      report.degenerateTriangles++;
+    else if(bounds.getArea() > kThinTriangleRatio * area)
+      report.thinTriangles++;
+  }
+
+  const auto        start = std::chrono::steady_clock::now();
+  nvsamples::SahBvh bvh;
+  bvh.build(triangleBounds, settings);
+  report.buildTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  report.stats     = bvh.getStats();
+  return report;
+}
+
+// World bounds of the box transformed by the matrix
+nvsamples::BvhBounds transformBounds(const glm::mat4& transform, const nvsamples::BvhBounds& bounds)
+{
+  nvsamples::BvhBounds result;
+  if(bounds.isEmpty())
+    return result;
+  for(int corner = 0; corner < 8; corner++)
+  {
+    const glm::vec3 p((corner & 1) ? bounds.max.x : bounds.min.x, (corner & 2) ? bounds.max.y : bounds.min.y,
+                      (corner & 4) ? bounds.max.z : bounds.min.z);
+    result.grow(glm::vec3(transform * glm::vec4(p, 1.0f)));
+  }
+  return result;
+}
+
+void logStats(const char* indent, const nvsamples::SahBvh::Stats& stats)
+{
+  LOGI("%sSAH cost: %.2f, overlap cost: %.2f, average overlap: %.1f%%\n", indent, stats.sahCost, stats.overlapCost,
+       100.0 * stats.averageOverlap);
+  LOGI("%sNodes: %u, leaves: %u, max depth: %u, average leaf depth: %.1f\n", indent, stats.nodeCount, stats.leafCount,
+       stats.maxDepth, stats.averageLeafDepth);
+}
+
+void logLeafSizeHistogram(const std::vector<uint32_t>& histogram, uint32_t leafCount)
+{
+  LOGI("Leaf size histogram (all meshes):\n");
+  for(size_t size = 1; size < histogram.size(); size++)
+  {
+    if(histogram[size] == 0)
+      continue;
+    const double fraction = leafCount ? double(histogram[size]) / leafCount : 0.0;
+    LOGI("  %3zu: %9u %5.1f%% %s\n", size, histogram[size], 100.0 * fraction,
+         std::string(size_t(fraction * 50.0 + 0.5), '#').c_str());
+  }
+}
+
+}  // namespace
+
+
+int main(int argc, char** argv)
+{
+  std::filesystem::path       scenePath;
+  nvsamples::SahBvh::Settings settings;
+  uint32_t                    top      = 10;
+  bool                        optimize = false;
+
+  // Parsing the command line
+  nvutils::ParameterParser   cli(nvutils::getExecutablePath().stem().string());
+  nvutils::ParameterRegistry reg;
+  reg.add({"scene", "glTF scene to analyze (.gltf or .glb), wuson.glb by default"}, &scenePath);
+  reg.add({"leafSize", "Maximum number of primitives in a leaf"}, &settings.maxLeafSize);
+  reg.add({"bins", "Number of bins of the SAH splits"}, &settings.numBins);
+  reg.add({"top", "Number of meshes and instances listed"}, &top);
+  reg.add({"optimize", "Analyze the meshes as imported with the mesh optimizer"}, &optimize, true);
+  cli.add(reg);
+  cli.parse(argc, argv);
+
+  if(scenePath.empty())
+  {
+    scenePath = nvutils::findFile("wuson.glb", nvsamples::getResourcesDirs());
+  }
+  if(scenePath.empty() || !std::filesystem::exists(scenePath))
+  {
+    LOGE("Scene not found: %s\n", scenePath.string().c_str());
+    return 1;
+  }
+  settings.numBins     = std::max(settings.numBins, 2U);
+  settings.maxLeafSize = std::max(settings.maxLeafSize, 1U);
+
+  // Import the scene on the host, the geometry is read from the packed glTF buffers without uploading it
+  nvsamples::GltfMappedModel            mappedModel;
+  std::vector<std::span<const uint8_t>> buffersData;
+  if(scenePath.extension() == ".glb")
+  {
+    if(!nvsamples::loadGltfMapped(scenePath, mappedModel))
+      return 1;
+  }
+  else
+  {
+    mappedModel.model = nvsamples::loadGltfResources(scenePath);
+  }
+  for(const tinygltf::Buffer& buffer : mappedModel.model.buffers)
+  {
+    buffersData.emplace_back(buffer.data);
+  }
+  if(!buffersData.empty() && !mappedModel.binChunk.empty())
+  {
+    buffersData[0] = mappedModel.binChunk;
+  }
+
+  nvsamples::GltfSceneResource  scene;
+  nvsamples::GltfPackedGeometry geometry;
+  const nvsamples::GltfImportOptions options{.quantizeVertices = false, .optimizeMeshes = optimize, .deduplicateMeshes = true};
+  if(!nvsamples::importGltfData(scene, mappedModel.model, buffersData, nullptr, true, options, &geometry))
+  {
+    return 1;
+  }
+  if(scene.meshes.empty())
+  {
+    LOGE("No triangle mesh in %s\n", scenePath.string().c_str());
+    return 1;
+  }
+
+  LOGI("Scene: %s\n", scenePath.string().c_str());
+  LOGI("Meshes: %zu, instances: %zu, leaf size: %u, bins: %u\n\n", scene.meshes.size(), scene.instances.size(),
+       settings.maxLeafSize, settings.numBins);
+
+  //--------------------------------------------------------------------------------------------------
+  // Bottom level: one BVH per geometry, the aliased meshes share the BVH of their geometry like they share the BLAS
+  std::vector<uint32_t>   meshReportIndex(scene.meshes.size(), ~0U);
+  std::vector<MeshReport> meshReports;
+  for(uint32_t i = 0; i < uint32_t(scene.meshes.size()); i++)
+  {
+    if(scene.getGeometryMesh(i) != i)
+      continue;
+    meshReportIndex[i] = uint32_t(meshReports.size());
+    meshReports.push_back(analyzeMesh(scene, geometry, i, settings));
+  }
+  for(const shaderio::GltfInstance& instance : scene.instances)
+  {
+    meshReports[meshReportIndex[scene.getGeometryMesh(instance.meshIndex)]].instanceCount++;
+  }
+
+  // Totals over the geometries
+  uint64_t              triangleCount = 0, thinTriangles = 0, degenerateTriangles = 0;
+  uint32_t              leafCount     = 0;
+  double                buildTime     = 0;
+  std::vector<uint32_t> leafSizeHistogram;
+  for(const MeshReport& report : meshReports)
+  {
+    triangleCount += report.triangleCount;
+    thinTriangles += report.thinTriangles;
+    degenerateTriangles += report.degenerateTriangles;
+    leafCount += report.stats.leafCount;
+    buildTime += report.buildTime;
+    leafSizeHistogram.resize(std::max(leafSizeHistogram.size(), report.stats.leafSizeHistogram.size()), 0);
+    for(size_t size = 0; size < report.stats.leafSizeHistogram.size(); size++)
+      leafSizeHistogram[size] += report.stats.leafSizeHistogram[size];
+  }
+  LOGI("Bottom level: %zu BVHs, %llu triangles, %llu thin, %llu degenerate, built in %.1f ms\n", meshReports.size(),
+       static_cast<unsigned long long>(triangleCount), static_cast<unsigned long long>(thinTriangles),
+       static_cast<unsigned long long>(degenerateTriangles), buildTime);
+  logLeafSizeHistogram(leafSizeHistogram, leafCount);
+
+  // The meshes ordered by SAH cost, the cost of tracing a ray through their BLAS
+  std::vector<uint32_t> order(meshReports.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [&](uint32_t a, uint32_t b) { return meshReports[a].stats.sahCost > meshReports[b].stats.sahCost; });
+  LOGI("\nMost expensive meshes:\n");
+  LOGI("  %6s %9s %6s %9s %9s %7s %6s %5s  %s\n", "Mesh", "Triangles", "Thin", "SAH cost", "Overlap", "Leaves",
+       "Depth", "Inst", "Bounds");
+  for(uint32_t i = 0; i < std::min(top, uint32_t(order.size())); i++)
+  {
+    const MeshReport& r = meshReports[order[i]];
+    LOGI("  %6u %9u %5.1f%% %9.2f %9.2f %7u %6u %5u  (%.3g %.3g %.3g) - (%.3g %.3g %.3g)\n", r.meshIndex,
+         r.triangleCount, r.triangleCount ? 100.0 * r.thinTriangles / r.triangleCount : 0.0, r.stats.sahCost,
+         r.stats.overlapCost, r.stats.leafCount, r.stats.maxDepth, r.instanceCount, r.bounds.min.x, r.bounds.min.y,
+         r.bounds.min.z, r.bounds.max.x, r.bounds.max.y, r.bounds.max.z);
+  }
+
+  //--------------------------------------------------------------------------------------------------
+  // Top level: the BVH of the world bounds of the instances
+  std::vector<nvsamples::BvhBounds> instanceBounds(scene.instances.size());
+  nvsamples::BvhBounds              sceneBounds;
+  for(size_t i = 0; i < scene.instances.size(); i++)
+  {
+    const shaderio::GltfInstance& instance = scene.instances[i];
+    const MeshReport&             mesh     = meshReports[meshReportIndex[scene.getGeometryMesh(instance.meshIndex)]];
+    instanceBounds[i]                      = transformBounds(instance.transform, mesh.bounds);
+    sceneBounds.grow(instanceBounds[i]);
+  }
+
+  std::vector<InstanceReport> instanceReports(scene.instances.size());
+  if(!scene.instances.empty())
+  {
+    nvsamples::SahBvh tlas;
+    tlas.build(instanceBounds, settings);
+    LOGI("\nTop level: %zu instances\n", scene.instances.size());
+    logStats("  ", tlas.getStats());
+
+    // Overlapping instances: a ray entering their common region traverses all their BLAS
+    const double          sceneArea = std::max(double(sceneBounds.getArea()), double(FLT_MIN));
+    std::vector<uint32_t> overlapping;
+    for(uint32_t i = 0; i < uint32_t(scene.instances.size()); i++)
+    {
+      InstanceReport& report = instanceReports[i];
+      report.instanceIndex   = i;
+      report.areaRatio       = instanceBounds[i].getArea() / sceneArea;
+      overlapping.clear();
+      tlas.query(instanceBounds[i], instanceBounds, overlapping);
+      for(uint32_t j : overlapping)
+      {
+        if(j == i)
+          continue;
+        report.overlapCount++;
+        report.overlapCost += instanceBounds[i].intersect(instanceBounds[j]).getArea() / sceneArea;
+      }
+    }
+
+    std::sort(instanceReports.begin(), instanceReports.end(),
+              [](const InstanceReport& a, const InstanceReport& b) { return a.overlapCost > b.overlapCost; });
+    LOGI("\nMost overlapping instances:\n");
+    LOGI("  %8s %6s %10s %10s %10s\n", "Instance", "Mesh", "Area", "Overlaps", "Cost");
+    for(uint32_t i = 0; i < std::min(top, uint32_t(instanceReports.size())); i++)
+    {
+      const InstanceReport& r = instanceReports[i];
+      LOGI("  %8u %6u %9.1f%% %10u %10.2f\n", r.instanceIndex, scene.instances[r.instanceIndex].meshIndex,
+           100.0 * r.areaRatio, r.overlapCount, r.overlapCost);
+    }
+  }
+
+  //--------------------------------------------------------------------------------------------------
+  // Warnings
+  LOGI("\n");
+  uint32_t numWarnings = 0;
+  for(const MeshReport& r : meshReports)
+  {
+    if(r.triangleCount && r.thinTriangles > kThinMeshFraction * r.triangleCount)
+    {
+      LOGW("Mesh %u: %.1f%% of its %u triangles are long and thin, consider tessellating them\n", r.meshIndex,
+           100.0 * r.thinTriangles / r.triangleCount, r.triangleCount);
+      numWarnings++;
+    }
+    if(r.degenerateTriangles)
+    {
+      LOGW("Mesh %u: %u degenerate triangles, see --optimize\n", r.meshIndex, r.degenerateTriangles);
+      numWarnings++;
+    }
+  }
+  for(const InstanceReport& r : instanceReports)
+  {
+    if(r.overlapCost > kOverlapInstanceCost)
+    {
+      LOGW("Instance %u: covers %.1f%% of the scene and overlaps %u instances (cost %.2f), consider splitting its mesh\n",
+           r.instanceIndex, 100.0 * r.areaRatio, r.overlapCount, r.overlapCost);
+      numWarnings++;
+    }
+  }
+  LOGI("%u warnings\n", numWarnings);
+
+  return 0;
+}